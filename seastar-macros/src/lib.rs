@@ -1,3 +1,50 @@
+use syn::parse::Parser;
+use syn::punctuated::Punctuated;
+use syn::{Lit, Meta, NestedMeta, Token};
+
+/// Where a test runs, as given by the arguments of `#[seastar::test]`.
+enum Runtime {
+    /// A runtime of its own, with the given number of shards (or the default).
+    Fresh { smp: Option<syn::LitInt> },
+    /// The runtime shared by the tests of the binary.
+    Shared { parallel: bool },
+}
+
+fn parse_args(args: proc_macro2::TokenStream) -> syn::Result<Runtime> {
+    let args = Punctuated::<NestedMeta, Token![,]>::parse_terminated.parse2(args)?;
+    let mut smp = None;
+    let mut shared = None;
+    let mut parallel = false;
+    for arg in &args {
+        match arg {
+            NestedMeta::Meta(Meta::NameValue(nv)) if nv.path.is_ident("smp") => match &nv.lit {
+                Lit::Int(n) => smp = Some(n.clone()),
+                lit => return Err(syn::Error::new_spanned(lit, "smp must be an integer")),
+            },
+            NestedMeta::Meta(Meta::Path(path)) if path.is_ident("shared") => {
+                shared = Some(path.clone())
+            }
+            NestedMeta::Meta(Meta::Path(path)) if path.is_ident("parallel") => parallel = true,
+            arg => {
+                let msg = "unknown argument, expected `smp = N`, `shared` or `parallel`";
+                return Err(syn::Error::new_spanned(arg, msg));
+            }
+        }
+    }
+    match (smp, shared, parallel) {
+        (Some(smp), Some(_), _) => {
+            let msg = "`smp` cannot be set for tests in the shared runtime";
+            Err(syn::Error::new_spanned(smp, msg))
+        }
+        (smp, None, false) => Ok(Runtime::Fresh { smp }),
+        (None, _, parallel) => Ok(Runtime::Shared { parallel }),
+        (Some(smp), None, true) => {
+            let msg = "`parallel` only applies to tests in the shared runtime";
+            Err(syn::Error::new_spanned(smp, msg))
+        }
+    }
+}
+
 #[proc_macro_attribute]
 pub fn test(
     args: proc_macro::TokenStream,
@@ -17,27 +64,45 @@ pub fn test(
             .into();
     }
 
-    if !args.is_empty() {
-        let msg = "arguments for #[seastar::test] are not supported yet";
-        return syn::Error::new_spanned(args, msg).to_compile_error().into();
-    }
+    let runtime = match parse_args(args) {
+        Ok(runtime) => runtime,
+        Err(err) => return err.to_compile_error().into(),
+    };
 
-    let output = quote::quote! {
-        #[test]
-        #(#attrs)*
-        fn #name() {
-            std::thread::spawn(|| {
-                let _guard = seastar::acquire_guard_for_seastar_test();
-                let mut app = seastar::AppTemplate::default();
-                let fut = async {
-                    #body
-                    Ok(())
-                };
-                app.run_void(std::env::args().take(1), fut);
-            })
-            .join()
-            .unwrap();
+    let output = match runtime {
+        Runtime::Fresh { smp } => {
+            let set_smp = smp.map(|smp| quote::quote! { opts.set_smp(#smp); });
+            quote::quote! {
+                #[test]
+                #(#attrs)*
+                fn #name() {
+                    std::thread::spawn(|| {
+                        let _guard = seastar::acquire_guard_for_seastar_test();
+                        let mut opts = seastar::Options::default();
+                        #set_smp
+                        let mut app = seastar::AppTemplate::new_from_options(opts);
+                        let fut = async {
+                            #body
+                            Ok(())
+                        };
+                        app.run_void(std::env::args().take(1), fut);
+                    })
+                    .join()
+                    .unwrap();
+                }
+            }
         }
+        Runtime::Shared { parallel } => quote::quote! {
+            #[test]
+            #(#attrs)*
+            fn #name() {
+                seastar::run_test_in_shared_runtime(#parallel, || {
+                    Box::pin(async {
+                        #body
+                    })
+                });
+            }
+        },
     };
 
     output.into()
@@ -0,0 +1,166 @@
+//! Measures what the Rust layer adds on top of Seastar for the basic
+//! operations, comparing each of them with the equivalent C++ code.
+//!
+//! Run with `cargo bench --features bench --bench ffi_overhead [FILTER...]`. The number of
+//! iterations can be set with the `SEASTAR_BENCH_ITERATIONS` environment
+//! variable.
+
+use seastar::{bench_baseline, spawn, spawn_detached, submit_to, this_shard_id, yield_now};
+use seastar::{AppTemplate, Gate, Options};
+use std::cell::Cell;
+use std::future::Future;
+use std::rc::Rc;
+use std::time::Instant;
+
+const DEFAULT_ITERATIONS: usize = 100_000;
+
+struct Measurement {
+    ns_per_op: f64,
+    allocs_per_op: f64,
+}
+
+/// Runs `bench` once to warm up, then once more measuring it.
+async fn measure<F, Fut>(iterations: usize, bench: F) -> Measurement
+where
+    F: Fn(usize) -> Fut,
+    Fut: Future<Output = ()>,
+{
+    bench(iterations / 10 + 1).await;
+    let mallocs = bench_baseline::mallocs();
+    let start = Instant::now();
+    bench(iterations).await;
+    let elapsed = start.elapsed();
+    let mallocs = bench_baseline::mallocs() - mallocs;
+    Measurement {
+        ns_per_op: elapsed.as_nanos() as f64 / iterations as f64,
+        allocs_per_op: mallocs as f64 / iterations as f64,
+    }
+}
+
+fn report(name: &str, rust: Measurement, cpp: Measurement) {
+    println!(
+        "{:<24} {:>10.1} {:>10.1} {:>+9.1} {:>10.2} {:>10.2}",
+        name,
+        rust.ns_per_op,
+        cpp.ns_per_op,
+        rust.ns_per_op - cpp.ns_per_op,
+        rust.allocs_per_op,
+        cpp.allocs_per_op,
+    );
+}
+
+async fn bench_spawn(iterations: usize) {
+    for _ in 0..iterations {
+        spawn(async {}).await;
+    }
+}
+
+async fn bench_spawn_detached(iterations: usize) {
+    let done = Rc::new(Cell::new(0));
+    for _ in 0..iterations {
+        let done = done.clone();
+        spawn_detached(async move { done.set(done.get() + 1) });
+    }
+    while done.get() < iterations {
+        yield_now().await;
+    }
+}
+
+async fn bench_submit_to(shard: u32, iterations: usize) {
+    for _ in 0..iterations {
+        submit_to(shard, || async {}).await;
+    }
+}
+
+async fn bench_submit_to_nested(shard: u32, iterations: usize) {
+    let home = this_shard_id();
+    for _ in 0..iterations {
+        submit_to(
+            shard,
+            move || async move { submit_to(home, || async {}).await },
+        )
+        .await;
+    }
+}
+
+async fn bench_gate(iterations: usize) {
+    let gate = Gate::new();
+    for _ in 0..iterations {
+        drop(gate.try_enter().unwrap());
+    }
+    gate.close().await;
+}
+
+async fn run_benches(iterations: usize, filters: &[String]) {
+    let enabled =
+        |name: &str| filters.is_empty() || filters.iter().any(|f| name.contains(f.as_str()));
+    let here = this_shard_id();
+    let other = (here + 1) % seastar::smp_count();
+
+    println!(
+        "{:<24} {:>10} {:>10} {:>9} {:>10} {:>10}",
+        "benchmark", "rust ns", "c++ ns", "overhead", "rust allocs", "c++ allocs"
+    );
+    if enabled("spawn") {
+        report(
+            "spawn",
+            measure(iterations, bench_spawn).await,
+            measure(iterations, bench_baseline::spawn).await,
+        );
+    }
+    if enabled("spawn_detached") {
+        report(
+            "spawn_detached",
+            measure(iterations, bench_spawn_detached).await,
+            measure(iterations, bench_baseline::spawn_detached).await,
+        );
+    }
+    if enabled("submit_to_same_shard") {
+        report(
+            "submit_to_same_shard",
+            measure(iterations, |n| bench_submit_to(here, n)).await,
+            measure(iterations, |n| bench_baseline::submit_to(here, n)).await,
+        );
+    }
+    if enabled("submit_to_cross_shard") {
+        report(
+            "submit_to_cross_shard",
+            measure(iterations, |n| bench_submit_to(other, n)).await,
+            measure(iterations, |n| bench_baseline::submit_to(other, n)).await,
+        );
+    }
+    if enabled("submit_to_nested") {
+        report(
+            "submit_to_nested",
+            measure(iterations, |n| bench_submit_to_nested(other, n)).await,
+            measure(iterations, |n| bench_baseline::submit_to_nested(other, n)).await,
+        );
+    }
+    if enabled("gate") {
+        report(
+            "gate_enter_leave",
+            measure(iterations, bench_gate).await,
+            measure(iterations, bench_baseline::gate_enter_leave).await,
+        );
+    }
+}
+
+fn main() {
+    let iterations = std::env::var("SEASTAR_BENCH_ITERATIONS")
+        .ok()
+        .and_then(|n| n.parse().ok())
+        .unwrap_or(DEFAULT_ITERATIONS);
+    // The arguments meant for Seastar are not passed on, the rest are filters.
+    let filters: Vec<String> = std::env::args()
+        .skip(1)
+        .filter(|arg| !arg.starts_with("--"))
+        .collect();
+
+    let mut opts = Options::default();
+    opts.set_smp(2);
+    let mut app = AppTemplate::new_from_options(opts);
+    app.run_void(std::env::args().take(1), async move {
+        run_benches(iterations, &filters).await;
+        Ok(())
+    });
+}
@@ -8,6 +8,18 @@ static CXX_BRIDGES: &[&str] = &[
     "src/spawn.rs",
     "src/submit_to.rs",
     "src/gate.rs",
+    "src/smp.rs",
+    "src/scheduling.rs",
+    "src/timer.rs",
+    "src/semaphore.rs",
+    "src/temporary_buffer.rs",
+    "src/file.rs",
+    "src/packet.rs",
+    "src/net.rs",
+    "src/metrics.rs",
+    "src/stall_detector.rs",
+    "src/poller.rs",
+    "src/reclaimer.rs",
 ];
 
 static CXX_CPP_SOURCES: &[&str] = &[
@@ -16,9 +28,31 @@ static CXX_CPP_SOURCES: &[&str] = &[
     "src/spawn.cc",
     "src/submit_to.cc",
     "src/gate.cc",
+    "src/smp.cc",
+    "src/scheduling.cc",
+    "src/timer.cc",
+    "src/semaphore.cc",
+    "src/temporary_buffer.cc",
+    "src/file.cc",
+    "src/packet.cc",
+    "src/net.cc",
+    "src/metrics.cc",
+    "src/stall_detector.cc",
+    "src/poller.cc",
+    "src/reclaimer.cc",
 ];
 
+// The C++ baselines of the benchmarks, built with the `bench` feature.
+static BENCH_CXX_BRIDGES: &[&str] = &["src/bench_baseline.rs"];
+static BENCH_CXX_CPP_SOURCES: &[&str] = &["src/bench_baseline.cc"];
+
 fn main() {
+    let bench = std::env::var_os("CARGO_FEATURE_BENCH").is_some();
+    let (bench_bridges, bench_sources) = match bench {
+        true => (BENCH_CXX_BRIDGES, BENCH_CXX_CPP_SOURCES),
+        false => (&[][..], &[][..]),
+    };
+
     let seastar = pkg_config::Config::new()
         .statik(true)
         .probe("seastar")
@@ -40,8 +74,13 @@ fn main() {
 
     let cxx_bridges = CXX_BRIDGES
         .iter()
+        .chain(bench_bridges)
         .map(|p| PathBuf::try_from(p).unwrap())
         .collect::<Vec<_>>();
+    let cpp_sources = CXX_CPP_SOURCES
+        .iter()
+        .chain(bench_sources)
+        .collect::<Vec<_>>();
 
     let mut build = cxx_build::bridges(&cxx_bridges);
     for (var, value) in &seastar.defines {
@@ -56,14 +95,14 @@ fn main() {
         .flag_if_supported("-fcoroutines")
         .includes(&seastar.include_paths)
         .cpp_link_stdlib("stdc++")
-        .files(CXX_CPP_SOURCES)
+        .files(&cpp_sources)
         .compile("seastar-rs");
 
     println!("cargo:rerun-if-changed=build.rs");
     for bridge_file in cxx_bridges.iter() {
         println!("cargo:rerun-if-changed={}", bridge_file.to_str().unwrap());
     }
-    for cpp_file in CXX_CPP_SOURCES.iter() {
+    for cpp_file in cpp_sources.iter() {
         println!("cargo:rerun-if-changed={}", cpp_file);
     }
 }
@@ -0,0 +1,321 @@
+//! Shard-local cancellation (`seastar::abort_source`).
+//!
+//! An [`AbortSource`] is the one place through which a piece of work is
+//! cancelled: the work subscribes to it, or runs its futures through
+//! [`abortable`](AbortSource::abortable), and whoever owns the work calls
+//! [`request_abort`](AbortSource::request_abort). Aborted futures are
+//! dropped, so the resources they hold, e.g. timers, are released at once.
+//!
+//! Call sites that cross shards or tasks take one too: see
+//! [`submit_to_abortable`](crate::submit_to_abortable),
+//! [`spawn_abortable`](crate::spawn_abortable) and
+//! [`sleep_abortable`](crate::sleep_abortable).
+
+use crate::{sleep_lowres, spawn_detached};
+use pin_project::pin_project;
+use std::cell::{Cell, RefCell};
+use std::collections::BTreeMap;
+use std::future::Future;
+use std::pin::Pin;
+use std::rc::Rc;
+use std::task::{Context, Poll, Waker};
+use std::time::Duration;
+use thiserror::Error;
+
+/// Error returned by abortable operations when an abort was requested
+/// (`seastar::abort_requested_exception`).
+#[derive(Error, Debug, Clone, Copy, PartialEq, Eq)]
+#[error("AbortRequested: abort requested")]
+pub struct AbortRequested;
+
+enum Subscriber {
+    Callback(Box<dyn FnOnce()>),
+    Waker(Waker),
+}
+
+struct Inner {
+    aborted: Cell<bool>,
+    next_id: Cell<u64>,
+    // Ordered by id, so that subscribers are notified in subscription order.
+    subscribers: RefCell<BTreeMap<u64, Subscriber>>,
+}
+
+/// Lets a task request that the work it started be cancelled.
+///
+/// Clones share the same state: an abort requested through any of them is
+/// seen by all. Like the other shard-local primitives, it is neither `Send`
+/// nor `Sync`.
+///
+/// # Example
+///
+/// ```rust
+/// #[seastar::test]
+/// async fn abort_source_example() {
+///     let abort = AbortSource::new();
+///     let sleeper = spawn(sleep_abortable(Duration::from_secs(3600), &abort));
+///     abort.request_abort();
+///     assert_eq!(sleeper.await, Err(AbortRequested));
+/// }
+/// ```
+#[derive(Clone)]
+pub struct AbortSource {
+    inner: Rc<Inner>,
+}
+
+impl Default for AbortSource {
+    fn default() -> Self {
+        Self::new()
+    }
+}
+
+impl AbortSource {
+    /// Creates an abort source on which no abort was requested.
+    pub fn new() -> Self {
+        AbortSource {
+            inner: Rc::new(Inner {
+                aborted: Cell::new(false),
+                next_id: Cell::new(0),
+                subscribers: RefCell::new(BTreeMap::new()),
+            }),
+        }
+    }
+
+    /// Requests an abort, running the subscribed callbacks and waking the
+    /// [`abortable`](AbortSource::abortable) futures. Does nothing if an
+    /// abort was already requested.
+    pub fn request_abort(&self) {
+        if self.inner.aborted.replace(true) {
+            return;
+        }
+        let subscribers = std::mem::take(&mut *self.inner.subscribers.borrow_mut());
+        for subscriber in subscribers.into_values() {
+            match subscriber {
+                Subscriber::Callback(callback) => callback(),
+                Subscriber::Waker(waker) => waker.wake(),
+            }
+        }
+    }
+
+    /// Checks whether an abort was requested.
+    pub fn abort_requested(&self) -> bool {
+        self.inner.aborted.get()
+    }
+
+    /// Returns [`AbortRequested`] if an abort was requested.
+    pub fn check(&self) -> Result<(), AbortRequested> {
+        match self.abort_requested() {
+            true => Err(AbortRequested),
+            false => Ok(()),
+        }
+    }
+
+    /// Runs `callback` when an abort is requested, unless the returned
+    /// subscription is dropped first.
+    ///
+    /// Returns `None`, without running `callback`, if an abort was already
+    /// requested.
+    pub fn subscribe(&self, callback: impl FnOnce() + 'static) -> Option<AbortSubscription> {
+        self.add(Subscriber::Callback(Box::new(callback)))
+    }
+
+    fn add(&self, subscriber: Subscriber) -> Option<AbortSubscription> {
+        if self.abort_requested() {
+            return None;
+        }
+        let id = self.inner.next_id.get();
+        self.inner.next_id.set(id + 1);
+        self.inner.subscribers.borrow_mut().insert(id, subscriber);
+        Some(AbortSubscription {
+            inner: self.inner.clone(),
+            id,
+        })
+    }
+
+    /// Wraps `future` so that it is no longer polled once an abort is
+    /// requested, and completes with [`AbortRequested`] instead.
+    pub fn abortable<F: Future>(&self, future: F) -> Abortable<F> {
+        Abortable {
+            future,
+            source: self.clone(),
+            subscription: None,
+        }
+    }
+}
+
+/// A subscription to an [`AbortSource`], returned by
+/// [`subscribe`](AbortSource::subscribe).
+///
+/// Dropping it unsubscribes.
+pub struct AbortSubscription {
+    inner: Rc<Inner>,
+    id: u64,
+}
+
+impl AbortSubscription {
+    fn set_waker(&self, waker: &Waker) {
+        let mut subscribers = self.inner.subscribers.borrow_mut();
+        if let Some(Subscriber::Waker(old)) = subscribers.get_mut(&self.id) {
+            if !old.will_wake(waker) {
+                *old = waker.clone();
+            }
+        }
+    }
+}
+
+impl Drop for AbortSubscription {
+    fn drop(&mut self) {
+        // The subscribers are taken out all at once when the abort is
+        // requested, so this never races with running them.
+        self.inner.subscribers.borrow_mut().remove(&self.id);
+    }
+}
+
+/// Future returned by [`AbortSource::abortable`].
+#[pin_project]
+pub struct Abortable<F> {
+    #[pin]
+    future: F,
+    source: AbortSource,
+    subscription: Option<AbortSubscription>,
+}
+
+impl<F: Future> Future for Abortable<F> {
+    type Output = Result<F::Output, AbortRequested>;
+
+    fn poll(self: Pin<&mut Self>, cx: &mut Context<'_>) -> Poll<Self::Output> {
+        let this = self.project();
+        if this.source.abort_requested() {
+            return Poll::Ready(Err(AbortRequested));
+        }
+        if let Poll::Ready(output) = this.future.poll(cx) {
+            return Poll::Ready(Ok(output));
+        }
+        match this.subscription {
+            Some(subscription) => subscription.set_waker(cx.waker()),
+            None => *this.subscription = this.source.add(Subscriber::Waker(cx.waker().clone())),
+        }
+        // The future may have requested the abort itself.
+        if this.source.abort_requested() {
+            return Poll::Ready(Err(AbortRequested));
+        }
+        Poll::Pending
+    }
+}
+
+/// An [`AbortSource`] on which an abort is requested after a delay
+/// (`seastar::abort_on_expiry`).
+///
+/// The delay is measured with `lowres_clock`, like the timeouts it is
+/// meant for (see [`sleep_lowres`]). Dropping it before then disarms it.
+///
+/// # Example
+///
+/// ```rust
+/// #[seastar::test]
+/// async fn abort_on_expiry_example() {
+///     let expiry = AbortOnExpiry::new(Duration::from_millis(10));
+///     let slept = sleep_abortable(Duration::from_secs(3600), expiry.abort_source()).await;
+///     assert_eq!(slept, Err(AbortRequested));
+/// }
+/// ```
+pub struct AbortOnExpiry {
+    abort: AbortSource,
+    // Stops the task waiting for the expiry.
+    disarm: AbortSource,
+}
+
+impl AbortOnExpiry {
+    /// Requests an abort `after` from now.
+    pub fn new(after: Duration) -> Self {
+        crate::assert_runtime_is_running();
+        let (abort, disarm) = (AbortSource::new(), AbortSource::new());
+        let (a, expiry) = (abort.clone(), disarm.abortable(sleep_lowres(after)));
+        spawn_detached(async move {
+            if expiry.await.is_ok() {
+                a.request_abort();
+            }
+        });
+        AbortOnExpiry { abort, disarm }
+    }
+
+    /// Returns the abort source on which the abort is requested.
+    pub fn abort_source(&self) -> &AbortSource {
+        &self.abort
+    }
+}
+
+impl Drop for AbortOnExpiry {
+    fn drop(&mut self) {
+        self.disarm.request_abort();
+    }
+}
+
+#[cfg(test)]
+mod tests {
+    use super::*;
+    use crate as seastar;
+    use crate::{sleep, sleep_abortable, spawn, yield_now};
+
+    #[seastar::test(shared)]
+    async fn test_subscriptions() {
+        let abort = AbortSource::new();
+        let calls = Rc::new(RefCell::new(Vec::new()));
+        let subscribe = |i| {
+            let calls = calls.clone();
+            abort.subscribe(move || calls.borrow_mut().push(i))
+        };
+        let (_first, dropped, _third) = (subscribe(1), subscribe(2), subscribe(3));
+        drop(dropped);
+        assert_eq!(abort.check(), Ok(()));
+
+        abort.request_abort();
+        abort.request_abort();
+        assert_eq!(*calls.borrow(), vec![1, 3]);
+        assert!(abort.abort_requested());
+        assert_eq!(abort.check(), Err(AbortRequested));
+        assert!(subscribe(4).is_none());
+    }
+
+    #[seastar::test(shared)]
+    async fn test_abortable_drops_future() {
+        struct SetOnDrop(Rc<Cell<bool>>);
+        impl Drop for SetOnDrop {
+            fn drop(&mut self) {
+                self.0.set(true);
+            }
+        }
+
+        let abort = AbortSource::new();
+        let dropped = Rc::new(Cell::new(false));
+        let guard = SetOnDrop(dropped.clone());
+        let task = spawn(abort.abortable(async move {
+            let _guard = guard;
+            futures::future::pending::<()>().await
+        }));
+        yield_now().await;
+        assert!(!dropped.get());
+        abort.request_abort();
+        assert_eq!(task.await, Err(AbortRequested));
+        assert!(dropped.get());
+
+        // Already aborted: the future is never polled.
+        let polled = Cell::new(false);
+        let ret = abort.abortable(async { polled.set(true) }).await;
+        assert_eq!(ret, Err(AbortRequested));
+        assert!(!polled.get());
+    }
+
+    #[seastar::test(shared)]
+    async fn test_abort_on_expiry() {
+        let expiry = AbortOnExpiry::new(Duration::from_millis(10));
+        assert!(!expiry.abort_source().abort_requested());
+        let slept = sleep_abortable(Duration::from_secs(3600), expiry.abort_source()).await;
+        assert_eq!(slept, Err(AbortRequested));
+
+        let disarmed = AbortOnExpiry::new(Duration::from_millis(1));
+        let abort = disarmed.abort_source().clone();
+        drop(disarmed);
+        sleep(Duration::from_millis(20)).await;
+        assert!(!abort.abort_requested());
+    }
+}
@@ -0,0 +1,173 @@
+//! Routing of Rust heap allocations to Seastar's allocator.
+//!
+//! Seastar replaces the C allocation functions with a per-shard allocator:
+//! every shard allocates from its own memory, and a block freed on another
+//! shard is handed back to the shard that allocated it. [`SeastarAllocator`]
+//! calls those functions directly, so that `Box`, `Vec` etc. get the same
+//! treatment as C++ allocations.
+
+use std::alloc::{GlobalAlloc, Layout};
+use std::ffi::c_void;
+
+extern "C" {
+    fn malloc(size: usize) -> *mut c_void;
+    fn calloc(nmemb: usize, size: usize) -> *mut c_void;
+    fn realloc(ptr: *mut c_void, size: usize) -> *mut c_void;
+    fn aligned_alloc(alignment: usize, size: usize) -> *mut c_void;
+    fn free(ptr: *mut c_void);
+}
+
+/// Alignment guaranteed by `malloc` for any size.
+const MALLOC_ALIGN: usize = 8;
+
+/// A [`GlobalAlloc`] backed by Seastar's per-shard allocator.
+///
+/// Memory allocated on a shard comes from that shard's memory, and may be
+/// freed on any shard (or outside of the runtime). Outside of the runtime,
+/// Seastar's allocator serves allocations from a fallback pool.
+///
+/// It is used as the global allocator when the `global-allocator` feature is
+/// enabled. Otherwise, it can be installed by the application:
+///
+/// ```rust
+/// #[global_allocator]
+/// static GLOBAL: seastar::SeastarAllocator = seastar::SeastarAllocator;
+/// ```
+pub struct SeastarAllocator;
+
+unsafe impl GlobalAlloc for SeastarAllocator {
+    unsafe fn alloc(&self, layout: Layout) -> *mut u8 {
+        if layout.align() <= MALLOC_ALIGN {
+            malloc(layout.size()) as *mut u8
+        } else {
+            // `aligned_alloc` requires the size to be a multiple of the alignment.
+            let size = layout.pad_to_align().size();
+            aligned_alloc(layout.align(), size) as *mut u8
+        }
+    }
+
+    unsafe fn alloc_zeroed(&self, layout: Layout) -> *mut u8 {
+        if layout.align() <= MALLOC_ALIGN {
+            calloc(1, layout.size()) as *mut u8
+        } else {
+            let ptr = self.alloc(layout);
+            if !ptr.is_null() {
+                std::ptr::write_bytes(ptr, 0, layout.size());
+            }
+            ptr
+        }
+    }
+
+    unsafe fn dealloc(&self, ptr: *mut u8, _layout: Layout) {
+        free(ptr as *mut c_void);
+    }
+
+    unsafe fn realloc(&self, ptr: *mut u8, layout: Layout, new_size: usize) -> *mut u8 {
+        if layout.align() <= MALLOC_ALIGN {
+            return realloc(ptr as *mut c_void, new_size) as *mut u8;
+        }
+        let new_layout = Layout::from_size_align_unchecked(new_size, layout.align());
+        let new_ptr = self.alloc(new_layout);
+        if !new_ptr.is_null() {
+            std::ptr::copy_nonoverlapping(ptr, new_ptr, layout.size().min(new_size));
+            self.dealloc(ptr, layout);
+        }
+        new_ptr
+    }
+}
+
+// The tests count allocations instead, see `counting`.
+#[cfg(all(feature = "global-allocator", not(test)))]
+#[global_allocator]
+static GLOBAL: SeastarAllocator = SeastarAllocator;
+
+/// Counts the Rust allocations of each thread, for the tests checking that
+/// some code does not allocate.
+#[cfg(test)]
+pub(crate) mod counting {
+    #[cfg(feature = "global-allocator")]
+    use super::SeastarAllocator as Inner;
+    #[cfg(not(feature = "global-allocator"))]
+    use std::alloc::System as Inner;
+    use std::alloc::{GlobalAlloc, Layout};
+    use std::cell::Cell;
+
+    thread_local! {
+        static ALLOCATIONS: Cell<u64> = const { Cell::new(0) };
+    }
+
+    fn count() {
+        // Fails only while the thread is being torn down.
+        let _ = ALLOCATIONS.try_with(|n| n.set(n.get() + 1));
+    }
+
+    /// Returns the number of allocations made on the current thread so far.
+    pub(crate) fn allocations() -> u64 {
+        ALLOCATIONS.with(Cell::get)
+    }
+
+    struct CountingAllocator;
+
+    unsafe impl GlobalAlloc for CountingAllocator {
+        unsafe fn alloc(&self, layout: Layout) -> *mut u8 {
+            count();
+            Inner.alloc(layout)
+        }
+
+        unsafe fn alloc_zeroed(&self, layout: Layout) -> *mut u8 {
+            count();
+            Inner.alloc_zeroed(layout)
+        }
+
+        unsafe fn dealloc(&self, ptr: *mut u8, layout: Layout) {
+            Inner.dealloc(ptr, layout)
+        }
+
+        unsafe fn realloc(&self, ptr: *mut u8, layout: Layout, new_size: usize) -> *mut u8 {
+            count();
+            Inner.realloc(ptr, layout, new_size)
+        }
+    }
+
+    #[global_allocator]
+    static GLOBAL: CountingAllocator = CountingAllocator;
+}
+
+#[cfg(test)]
+mod tests {
+    use super::*;
+    use crate as seastar;
+    use crate::submit_to;
+
+    #[seastar::test]
+    async fn test_allocator_layouts() {
+        for (size, align) in [(1, 1), (24, 8), (100, 64), (4096, 4096)] {
+            let layout = Layout::from_size_align(size, align).unwrap();
+            unsafe {
+                let ptr = SeastarAllocator.alloc_zeroed(layout);
+                assert!(!ptr.is_null());
+                assert_eq!(ptr as usize % align, 0);
+                assert!(std::slice::from_raw_parts(ptr, size)
+                    .iter()
+                    .all(|&b| b == 0));
+                let ptr = SeastarAllocator.realloc(ptr, layout, size * 2);
+                assert_eq!(ptr as usize % align, 0);
+                SeastarAllocator.dealloc(ptr, Layout::from_size_align(size * 2, align).unwrap());
+            }
+        }
+    }
+
+    #[seastar::test]
+    async fn test_allocator_cross_shard_free() {
+        struct Block(*mut u8);
+        unsafe impl Send for Block {}
+
+        let layout = Layout::from_size_align(256, 16).unwrap();
+        let block = submit_to(1, move || async move {
+            Block(unsafe { SeastarAllocator.alloc(layout) })
+        })
+        .await;
+        // Handed back to shard 1 by Seastar.
+        unsafe { SeastarAllocator.dealloc(block.0, layout) };
+    }
+}
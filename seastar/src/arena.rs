@@ -0,0 +1,322 @@
+//! Bump allocation of short-lived, per-request memory.
+
+use std::alloc::{self, Layout};
+use std::cell::{Cell, RefCell};
+use std::marker::PhantomData;
+use std::mem;
+use std::ptr::NonNull;
+
+/// Size of the chunks an [`Arena`] allocates from.
+pub const ARENA_CHUNK_SIZE: usize = 32 * 1024;
+const CHUNK_ALIGN: usize = 16;
+const MAX_CACHED_CHUNKS: usize = 64;
+
+struct FreeChunks(Vec<NonNull<u8>>);
+
+impl Drop for FreeChunks {
+    fn drop(&mut self) {
+        for chunk in self.0.drain(..) {
+            unsafe { alloc::dealloc(chunk.as_ptr(), chunk_layout(ARENA_CHUNK_SIZE)) };
+        }
+    }
+}
+
+thread_local! {
+    // Standard-size chunks released by arenas on this shard.
+    static FREE_CHUNKS: RefCell<FreeChunks> = RefCell::new(FreeChunks(Vec::new()));
+}
+
+fn chunk_layout(size: usize) -> Layout {
+    Layout::from_size_align(size, CHUNK_ALIGN).unwrap()
+}
+
+fn new_chunk(size: usize) -> NonNull<u8> {
+    if size == ARENA_CHUNK_SIZE {
+        let cached = FREE_CHUNKS
+            .try_with(|chunks| chunks.borrow_mut().0.pop())
+            .ok()
+            .flatten();
+        if let Some(chunk) = cached {
+            return chunk;
+        }
+    }
+    let layout = chunk_layout(size);
+    NonNull::new(unsafe { alloc::alloc(layout) })
+        .unwrap_or_else(|| alloc::handle_alloc_error(layout))
+}
+
+fn free_chunk(chunk: NonNull<u8>, size: usize) {
+    let chunk = if size == ARENA_CHUNK_SIZE {
+        FREE_CHUNKS
+            .try_with(|chunks| {
+                let mut chunks = chunks.borrow_mut();
+                if chunks.0.len() < MAX_CACHED_CHUNKS {
+                    chunks.0.push(chunk);
+                    None
+                } else {
+                    Some(chunk)
+                }
+            })
+            .unwrap_or(Some(chunk))
+    } else {
+        Some(chunk)
+    };
+    if let Some(chunk) = chunk {
+        unsafe { alloc::dealloc(chunk.as_ptr(), chunk_layout(size)) };
+    }
+}
+
+struct Chunk {
+    start: NonNull<u8>,
+    size: usize,
+}
+
+/// A value allocated in an arena that needs to be dropped.
+struct PendingDrop {
+    ptr: *mut u8,
+    drop: unsafe fn(*mut u8),
+}
+
+unsafe fn drop_in_place<T>(ptr: *mut u8) {
+    std::ptr::drop_in_place(ptr as *mut T);
+}
+
+/// A bump allocator for memory that lives as long as a request.
+///
+/// Allocating only advances a pointer within the current chunk, and the
+/// memory is not released piece by piece: it is all released at once when
+/// the arena is dropped or [`reset`](Arena::reset). Values that need to be
+/// dropped are dropped at that point, in reverse order of allocation; only
+/// `'static` values are, since values that borrow may outlive their data in
+/// the arena (see [`alloc_no_drop`](Arena::alloc_no_drop)).
+///
+/// Chunks come from the current shard. Released chunks are cached on the
+/// shard for the next arenas, so a new arena usually costs no allocation
+/// at all. The arena cannot be moved to another shard.
+///
+/// # Example
+///
+/// ```rust
+/// async fn handle_request(request: &[u8]) -> usize {
+///     let arena = Arena::new();
+///     let words: Vec<&str> = arena
+///         .alloc_str(std::str::from_utf8(request).unwrap())
+///         .split_whitespace()
+///         .collect();
+///     words.len()
+///     // Everything allocated in `arena` is released here.
+/// }
+/// ```
+pub struct Arena {
+    chunks: RefCell<Vec<Chunk>>,
+    // Free space of the last chunk.
+    next: Cell<usize>,
+    end: Cell<usize>,
+    drops: RefCell<Vec<PendingDrop>>,
+    allocated: Cell<usize>,
+    _not_send: PhantomData<*const ()>,
+}
+
+impl Default for Arena {
+    fn default() -> Self {
+        Self::new()
+    }
+}
+
+impl Arena {
+    /// Creates an empty arena. Its first chunk is allocated on first use.
+    pub fn new() -> Self {
+        Arena {
+            chunks: RefCell::new(Vec::new()),
+            next: Cell::new(0),
+            end: Cell::new(0),
+            drops: RefCell::new(Vec::new()),
+            allocated: Cell::new(0),
+            _not_send: PhantomData,
+        }
+    }
+
+    /// Allocates uninitialized memory for `layout`.
+    ///
+    /// The memory is valid until the arena is dropped or reset.
+    pub fn alloc_layout(&self, layout: Layout) -> NonNull<u8> {
+        if layout.size() == 0 {
+            return unsafe { NonNull::new_unchecked(layout.align() as *mut u8) };
+        }
+        let start = match self.next.get().checked_next_multiple_of(layout.align()) {
+            Some(start) if start.saturating_add(layout.size()) <= self.end.get() => start,
+            _ => self.grow(layout),
+        };
+        self.next.set(start + layout.size());
+        self.allocated.set(self.allocated.get() + layout.size());
+        unsafe { NonNull::new_unchecked(start as *mut u8) }
+    }
+
+    /// Starts a new chunk with room for `layout`, returning the address for it.
+    #[cold]
+    fn grow(&self, layout: Layout) -> usize {
+        let size = if layout.size() + layout.align() <= ARENA_CHUNK_SIZE {
+            ARENA_CHUNK_SIZE
+        } else {
+            layout.size() + layout.align()
+        };
+        let start = new_chunk(size);
+        self.chunks.borrow_mut().push(Chunk { start, size });
+        let start = start.as_ptr() as usize;
+        self.end.set(start + size);
+        start.next_multiple_of(layout.align())
+    }
+
+    /// Moves `value` into the arena. It is dropped when the arena is dropped
+    /// or reset.
+    ///
+    /// `T` must be `'static`: its destructor runs when the arena goes
+    /// away, which may be after the data it borrows. For values that borrow,
+    /// see [`alloc_no_drop`](Arena::alloc_no_drop).
+    pub fn alloc<T: 'static>(&self, value: T) -> &mut T {
+        let ptr = self.alloc_no_drop(value) as *mut T;
+        if mem::needs_drop::<T>() {
+            self.drops.borrow_mut().push(PendingDrop {
+                ptr: ptr as *mut u8,
+                drop: drop_in_place::<T>,
+            });
+        }
+        unsafe { &mut *ptr }
+    }
+
+    /// Moves `value` into the arena, without ever dropping it: its memory is
+    /// released with the arena, but its destructor does not run, like with
+    /// `bumpalo`. Leaking is safe, so `T` may borrow anything.
+    pub fn alloc_no_drop<T>(&self, value: T) -> &mut T {
+        let ptr = self.alloc_layout(Layout::new::<T>()).cast::<T>().as_ptr();
+        unsafe {
+            ptr.write(value);
+            &mut *ptr
+        }
+    }
+
+    /// Copies `slice` into the arena.
+    pub fn alloc_slice_copy<T: Copy>(&self, slice: &[T]) -> &mut [T] {
+        let ptr = self
+            .alloc_layout(Layout::for_value(slice))
+            .cast::<T>()
+            .as_ptr();
+        unsafe {
+            std::ptr::copy_nonoverlapping(slice.as_ptr(), ptr, slice.len());
+            std::slice::from_raw_parts_mut(ptr, slice.len())
+        }
+    }
+
+    /// Copies `s` into the arena.
+    pub fn alloc_str(&self, s: &str) -> &mut str {
+        let bytes = self.alloc_slice_copy(s.as_bytes());
+        unsafe { std::str::from_utf8_unchecked_mut(bytes) }
+    }
+
+    /// Returns the number of bytes allocated since the arena was created or reset.
+    pub fn allocated_bytes(&self) -> usize {
+        self.allocated.get()
+    }
+
+    /// Drops the values in the arena and releases its memory,
+    /// except for one chunk that is kept for further allocations.
+    pub fn reset(&mut self) {
+        self.run_drops();
+        let chunks = self.chunks.get_mut();
+        let kept = chunks
+            .iter()
+            .position(|chunk| chunk.size == ARENA_CHUNK_SIZE);
+        let kept = kept.map(|index| chunks.swap_remove(index));
+        for chunk in chunks.drain(..) {
+            free_chunk(chunk.start, chunk.size);
+        }
+        match kept {
+            Some(chunk) => {
+                let start = chunk.start.as_ptr() as usize;
+                self.next.set(start);
+                self.end.set(start + chunk.size);
+                chunks.push(chunk);
+            }
+            None => {
+                self.next.set(0);
+                self.end.set(0);
+            }
+        }
+        self.allocated.set(0);
+    }
+
+    fn run_drops(&mut self) {
+        while let Some(pending) = self.drops.get_mut().pop() {
+            unsafe { (pending.drop)(pending.ptr) };
+        }
+    }
+}
+
+impl Drop for Arena {
+    fn drop(&mut self) {
+        self.run_drops();
+        for chunk in self.chunks.get_mut().drain(..) {
+            free_chunk(chunk.start, chunk.size);
+        }
+    }
+}
+
+#[cfg(test)]
+mod tests {
+    use super::*;
+    use crate as seastar;
+    use std::rc::Rc;
+
+    #[seastar::test(shared)]
+    async fn test_arena_alloc() {
+        let arena = Arena::new();
+        let x = arena.alloc(42u64);
+        let s = arena.alloc_str("hello");
+        let big = arena.alloc_slice_copy(&[7u8; 2 * ARENA_CHUNK_SIZE]);
+        #[repr(align(64))]
+        struct Aligned(u8);
+        let aligned = arena.alloc(Aligned(1));
+        assert_eq!(*x, 42);
+        assert_eq!(s, "hello");
+        assert!(big.iter().all(|&b| b == 7));
+        assert_eq!(aligned as *mut Aligned as usize % 64, 0);
+        assert_eq!(arena.allocated_bytes(), 8 + 5 + 2 * ARENA_CHUNK_SIZE + 64);
+    }
+
+    #[seastar::test(shared)]
+    async fn test_arena_drops_values() {
+        let counter = Rc::new(());
+        let mut arena = Arena::new();
+        for _ in 0..10 {
+            arena.alloc(counter.clone());
+        }
+        assert_eq!(Rc::strong_count(&counter), 11);
+        arena.reset();
+        assert_eq!(Rc::strong_count(&counter), 1);
+        assert_eq!(arena.allocated_bytes(), 0);
+        arena.alloc(counter.clone());
+        drop(arena);
+        assert_eq!(Rc::strong_count(&counter), 1);
+    }
+
+    #[seastar::test(shared)]
+    async fn test_arena_alloc_no_drop() {
+        let counter = Rc::new(());
+        let arena = Arena::new();
+        let borrowed = arena.alloc_no_drop(vec![&counter]);
+        assert_eq!(Rc::strong_count(borrowed[0]), 1);
+        arena.alloc_no_drop(counter.clone());
+        drop(arena);
+        // Leaked, not dropped.
+        assert_eq!(Rc::strong_count(&counter), 2);
+    }
+
+    #[seastar::test(shared)]
+    async fn test_arena_reuses_chunks() {
+        let arena = Arena::new();
+        let first = arena.alloc(0u8) as *mut u8;
+        drop(arena);
+        let arena = Arena::new();
+        assert_eq!(arena.alloc(0u8) as *mut u8, first);
+    }
+}
@@ -0,0 +1,60 @@
+#include <seastar/core/gate.hh>
+#include <seastar/core/later.hh>
+#include <seastar/core/memory.hh>
+#include <seastar/core/smp.hh>
+#include <seastar/core/task.hh>
+
+#include "bench_baseline.hh"
+
+namespace seastar_ffi {
+namespace bench_baseline {
+
+VoidFuture spawn(size_t iterations) {
+    for (size_t i = 0; i < iterations; ++i) {
+        seastar::promise<> pr;
+        auto f = pr.get_future();
+        seastar::schedule(seastar::make_task([&pr] { pr.set_value(); }));
+        co_await std::move(f);
+    }
+}
+
+VoidFuture spawn_detached(size_t iterations) {
+    size_t done = 0;
+    for (size_t i = 0; i < iterations; ++i) {
+        seastar::schedule(seastar::make_task([&done] { ++done; }));
+    }
+    while (done < iterations) {
+        co_await seastar::yield();
+    }
+}
+
+VoidFuture submit_to(uint32_t shard, size_t iterations) {
+    for (size_t i = 0; i < iterations; ++i) {
+        co_await seastar::smp::submit_to(shard, [] {});
+    }
+}
+
+VoidFuture submit_to_nested(uint32_t shard, size_t iterations) {
+    auto home = seastar::this_shard_id();
+    for (size_t i = 0; i < iterations; ++i) {
+        co_await seastar::smp::submit_to(shard, [home] {
+            return seastar::smp::submit_to(home, [] {});
+        });
+    }
+}
+
+VoidFuture gate_enter_leave(size_t iterations) {
+    seastar::gate g;
+    for (size_t i = 0; i < iterations; ++i) {
+        g.enter();
+        g.leave();
+    }
+    co_await g.close();
+}
+
+uint64_t get_mallocs() {
+    return seastar::memory::stats().mallocs();
+}
+
+} // namespace bench_baseline
+} // namespace seastar_ffi
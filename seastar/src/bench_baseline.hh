@@ -0,0 +1,24 @@
+#pragma once
+
+#include "cxx_async_futures.hh"
+
+namespace seastar_ffi {
+namespace bench_baseline {
+
+// Pure Seastar equivalents of the operations measured by benches/ffi_overhead.rs.
+// Each one runs the operation `iterations` times.
+
+VoidFuture spawn(size_t iterations);
+
+VoidFuture spawn_detached(size_t iterations);
+
+VoidFuture submit_to(uint32_t shard, size_t iterations);
+
+VoidFuture submit_to_nested(uint32_t shard, size_t iterations);
+
+VoidFuture gate_enter_leave(size_t iterations);
+
+uint64_t get_mallocs();
+
+} // namespace bench_baseline
+} // namespace seastar_ffi
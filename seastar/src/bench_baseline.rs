@@ -0,0 +1,54 @@
+//! Pure Seastar baselines for the benchmarks in benches/ffi_overhead.rs.
+//!
+//! Not part of the public API.
+
+#[cxx::bridge]
+mod ffi {
+    #[namespace = "seastar_ffi"]
+    unsafe extern "C++" {
+        type VoidFuture = crate::cxx_async_futures::VoidFuture;
+    }
+
+    #[namespace = "seastar_ffi::bench_baseline"]
+    unsafe extern "C++" {
+        include!("seastar/src/bench_baseline.hh");
+
+        fn spawn(iterations: usize) -> VoidFuture;
+        fn spawn_detached(iterations: usize) -> VoidFuture;
+        fn submit_to(shard: u32, iterations: usize) -> VoidFuture;
+        fn submit_to_nested(shard: u32, iterations: usize) -> VoidFuture;
+        fn gate_enter_leave(iterations: usize) -> VoidFuture;
+        fn get_mallocs() -> u64;
+    }
+}
+
+/// Schedules a task completing a promise, and waits for it.
+pub async fn spawn(iterations: usize) {
+    let _ = ffi::spawn(iterations).await;
+}
+
+/// Schedules tasks, and waits until all of them have run.
+pub async fn spawn_detached(iterations: usize) {
+    let _ = ffi::spawn_detached(iterations).await;
+}
+
+/// Runs an empty function on `shard` with `smp::submit_to`.
+pub async fn submit_to(shard: u32, iterations: usize) {
+    let _ = ffi::submit_to(shard, iterations).await;
+}
+
+/// Runs a function on `shard` which runs an empty function back on the current shard.
+pub async fn submit_to_nested(shard: u32, iterations: usize) {
+    let _ = ffi::submit_to_nested(shard, iterations).await;
+}
+
+/// Enters and leaves a gate.
+pub async fn gate_enter_leave(iterations: usize) {
+    let _ = ffi::gate_enter_leave(iterations).await;
+}
+
+/// Returns the number of allocations made on the current shard so far,
+/// by C++ and Rust code alike.
+pub fn mallocs() -> u64 {
+    ffi::get_mallocs()
+}
@@ -0,0 +1,789 @@
+//! Shard-local channels.
+//!
+//! These channels connect tasks running on the same shard. They are neither
+//! `Send` nor `Sync`, and use plain `Cell`s where `futures::channel` uses
+//! atomics, so sending a message costs no atomic read-modify-write.
+//! Waking up the other side reschedules its Seastar task directly.
+//!
+//! To move values to another shard, see [`shard_channel`](crate::shard_channel).
+
+use std::cell::{Cell, RefCell};
+use std::collections::VecDeque;
+use std::rc::Rc;
+use std::task::Waker;
+
+fn register(slot: &Cell<Option<Waker>>, waker: &Waker) {
+    match slot.take() {
+        Some(old) if old.will_wake(waker) => slot.set(Some(old)),
+        _ => slot.set(Some(waker.clone())),
+    }
+}
+
+fn wake(slot: &Cell<Option<Waker>>) {
+    if let Some(waker) = slot.take() {
+        waker.wake();
+    }
+}
+
+struct Waiter {
+    waker: Cell<Option<Waker>>,
+    notified: Cell<bool>,
+}
+
+fn notify(waiter: &Waiter) {
+    waiter.notified.set(true);
+    wake(&waiter.waker);
+}
+
+/// Tasks waiting on a channel, in FIFO order.
+#[derive(Default)]
+struct WaitQueue {
+    waiters: RefCell<VecDeque<Rc<Waiter>>>,
+}
+
+impl WaitQueue {
+    fn wake_one(&self) {
+        let waiter = self.waiters.borrow_mut().pop_front();
+        if let Some(waiter) = waiter {
+            notify(&waiter);
+        }
+    }
+
+    fn wake_all(&self) {
+        let waiters = std::mem::take(&mut *self.waiters.borrow_mut());
+        for waiter in &waiters {
+            notify(waiter);
+        }
+    }
+
+    #[cfg(test)]
+    fn len(&self) -> usize {
+        self.waiters.borrow().len()
+    }
+
+    fn remove(&self, waiter: &Rc<Waiter>) {
+        let mut waiters = self.waiters.borrow_mut();
+        if let Some(i) = waiters.iter().position(|w| Rc::ptr_eq(w, waiter)) {
+            waiters.remove(i);
+        }
+    }
+}
+
+/// The place of a waiting future in a [`WaitQueue`].
+///
+/// The future registers once, and only updates its waker when polled again.
+/// It leaves the queue when it completes or is dropped; if it is dropped
+/// after being woken up, it passes the wakeup on, so that it is not lost.
+struct Wait<'a> {
+    queue: &'a WaitQueue,
+    waiter: Option<Rc<Waiter>>,
+}
+
+impl<'a> Wait<'a> {
+    fn new(queue: &'a WaitQueue) -> Self {
+        Wait {
+            queue,
+            waiter: None,
+        }
+    }
+
+    fn register(&mut self, waker: &Waker) {
+        match &self.waiter {
+            Some(waiter) if !waiter.notified.get() => register(&waiter.waker, waker),
+            _ => {
+                let waiter = Rc::new(Waiter {
+                    waker: Cell::new(Some(waker.clone())),
+                    notified: Cell::new(false),
+                });
+                self.queue.waiters.borrow_mut().push_back(waiter.clone());
+                self.waiter = Some(waiter);
+            }
+        }
+    }
+
+    /// Leaves the queue, once the future no longer waits.
+    fn finish(&mut self) {
+        if let Some(waiter) = self.waiter.take() {
+            if !waiter.notified.get() {
+                self.queue.remove(&waiter);
+            }
+        }
+    }
+}
+
+impl Drop for Wait<'_> {
+    fn drop(&mut self) {
+        if let Some(waiter) = self.waiter.take() {
+            if waiter.notified.get() {
+                self.queue.wake_one();
+            } else {
+                self.queue.remove(&waiter);
+            }
+        }
+    }
+}
+
+/// A channel for sending a single value between tasks on the same shard.
+pub mod oneshot {
+    use super::{register, wake};
+    use std::cell::Cell;
+    use std::future::Future;
+    use std::pin::Pin;
+    use std::rc::Rc;
+    use std::task::{Context, Poll, Waker};
+    use thiserror::Error;
+
+    /// Error returned by [`Receiver`] when the [`Sender`] is dropped without sending.
+    #[derive(Error, Debug, PartialEq, Eq)]
+    #[error("Canceled: oneshot sender dropped")]
+    pub struct Canceled;
+
+    struct Inner<T> {
+        value: Cell<Option<T>>,
+        waker: Cell<Option<Waker>>,
+        sender_dropped: Cell<bool>,
+        receiver_dropped: Cell<bool>,
+    }
+
+    /// Creates a channel for sending a single value.
+    ///
+    /// # Example
+    ///
+    /// ```rust
+    /// #[seastar::test]
+    /// async fn oneshot_example() {
+    ///     let (tx, rx) = oneshot::channel();
+    ///     spawn_detached(async move { tx.send(42).unwrap() });
+    ///     assert_eq!(rx.await, Ok(42));
+    /// }
+    /// ```
+    pub fn channel<T>() -> (Sender<T>, Receiver<T>) {
+        let inner = Rc::new(Inner {
+            value: Cell::new(None),
+            waker: Cell::new(None),
+            sender_dropped: Cell::new(false),
+            receiver_dropped: Cell::new(false),
+        });
+        (
+            Sender {
+                inner: inner.clone(),
+            },
+            Receiver { inner },
+        )
+    }
+
+    /// The sending half of a [`channel`].
+    pub struct Sender<T> {
+        inner: Rc<Inner<T>>,
+    }
+
+    impl<T> Sender<T> {
+        /// Sends `value`, or returns it back if the receiver has been dropped.
+        pub fn send(self, value: T) -> Result<(), T> {
+            if self.inner.receiver_dropped.get() {
+                return Err(value);
+            }
+            self.inner.value.set(Some(value));
+            Ok(())
+        }
+
+        /// Checks whether the receiver has been dropped.
+        pub fn is_canceled(&self) -> bool {
+            self.inner.receiver_dropped.get()
+        }
+    }
+
+    impl<T> Drop for Sender<T> {
+        fn drop(&mut self) {
+            // Also wakes the receiver after a successful send.
+            self.inner.sender_dropped.set(true);
+            wake(&self.inner.waker);
+        }
+    }
+
+    /// The receiving half of a [`channel`], a future resolving to the sent value.
+    pub struct Receiver<T> {
+        inner: Rc<Inner<T>>,
+    }
+
+    impl<T> Receiver<T> {
+        /// Returns the value if it has been sent already.
+        pub fn try_recv(&mut self) -> Result<Option<T>, Canceled> {
+            match self.inner.value.take() {
+                Some(value) => Ok(Some(value)),
+                None if self.inner.sender_dropped.get() => Err(Canceled),
+                None => Ok(None),
+            }
+        }
+    }
+
+    impl<T> Future for Receiver<T> {
+        type Output = Result<T, Canceled>;
+
+        fn poll(self: Pin<&mut Self>, cx: &mut Context<'_>) -> Poll<Self::Output> {
+            let this = self.get_mut();
+            match this.try_recv() {
+                Ok(Some(value)) => Poll::Ready(Ok(value)),
+                Ok(None) => {
+                    register(&this.inner.waker, cx.waker());
+                    Poll::Pending
+                }
+                Err(canceled) => Poll::Ready(Err(canceled)),
+            }
+        }
+    }
+
+    impl<T> Drop for Receiver<T> {
+        fn drop(&mut self) {
+            self.inner.receiver_dropped.set(true);
+        }
+    }
+}
+
+/// A bounded multi-producer, single-consumer channel between tasks on the same shard.
+pub mod mpsc {
+    use super::{register, wake, Wait, WaitQueue};
+    use futures::Stream;
+    use std::cell::{Cell, RefCell};
+    use std::collections::VecDeque;
+    use std::future::poll_fn;
+    use std::pin::Pin;
+    use std::rc::Rc;
+    use std::task::{Context, Poll, Waker};
+    use thiserror::Error;
+
+    /// Error returned by [`Sender::send`] when the receiver has been dropped.
+    /// Contains the value that was not sent.
+    #[derive(Error, Debug, PartialEq, Eq)]
+    #[error("SendError: mpsc receiver dropped")]
+    pub struct SendError<T>(pub T);
+
+    /// Error returned by [`Sender::try_send`]. Contains the value that was not sent.
+    #[derive(Error, Debug, PartialEq, Eq)]
+    pub enum TrySendError<T> {
+        /// The channel is full.
+        #[error("TrySendError: mpsc channel full")]
+        Full(T),
+        /// The receiver has been dropped.
+        #[error("TrySendError: mpsc receiver dropped")]
+        Closed(T),
+    }
+
+    struct Shared<T> {
+        queue: RefCell<VecDeque<T>>,
+        capacity: usize,
+        receiver_waker: Cell<Option<Waker>>,
+        /// Senders waiting for space.
+        sender_waiters: WaitQueue,
+        senders: Cell<usize>,
+        receiver_dropped: Cell<bool>,
+    }
+
+    /// Creates a channel holding up to `capacity` values.
+    ///
+    /// When it is full, [`send`](Sender::send) waits until the receiver
+    /// makes space, which propagates backpressure to the producers.
+    ///
+    /// # Example
+    ///
+    /// ```rust
+    /// #[seastar::test]
+    /// async fn mpsc_example() {
+    ///     let (tx, mut rx) = mpsc::channel(16);
+    ///     spawn_detached(async move {
+    ///         for i in 0..100 {
+    ///             tx.send(i).await.unwrap();
+    ///         }
+    ///     });
+    ///     let mut sum = 0;
+    ///     while let Some(i) = rx.recv().await {
+    ///         sum += i;
+    ///     }
+    ///     assert_eq!(sum, 4950);
+    /// }
+    /// ```
+    pub fn channel<T>(capacity: usize) -> (Sender<T>, Receiver<T>) {
+        assert!(capacity > 0, "Capacity must be positive");
+        let shared = Rc::new(Shared {
+            queue: RefCell::new(VecDeque::with_capacity(capacity)),
+            capacity,
+            receiver_waker: Cell::new(None),
+            sender_waiters: WaitQueue::default(),
+            senders: Cell::new(1),
+            receiver_dropped: Cell::new(false),
+        });
+        (
+            Sender {
+                shared: shared.clone(),
+            },
+            Receiver { shared },
+        )
+    }
+
+    /// The sending half of a [`channel`]. Can be cloned to create more senders.
+    pub struct Sender<T> {
+        shared: Rc<Shared<T>>,
+    }
+
+    impl<T> Sender<T> {
+        /// Sends `value`, waiting for space if the channel is full.
+        pub async fn send(&self, value: T) -> Result<(), SendError<T>> {
+            let mut value = Some(value);
+            let mut wait = Wait::new(&self.shared.sender_waiters);
+            poll_fn(|cx| match self.try_send(value.take().unwrap()) {
+                Ok(()) => {
+                    wait.finish();
+                    Poll::Ready(Ok(()))
+                }
+                Err(TrySendError::Closed(v)) => {
+                    wait.finish();
+                    Poll::Ready(Err(SendError(v)))
+                }
+                Err(TrySendError::Full(v)) => {
+                    value = Some(v);
+                    wait.register(cx.waker());
+                    Poll::Pending
+                }
+            })
+            .await
+        }
+
+        /// Sends `value` if there is space in the channel.
+        pub fn try_send(&self, value: T) -> Result<(), TrySendError<T>> {
+            if self.shared.receiver_dropped.get() {
+                return Err(TrySendError::Closed(value));
+            }
+            let mut queue = self.shared.queue.borrow_mut();
+            if queue.len() >= self.shared.capacity {
+                return Err(TrySendError::Full(value));
+            }
+            queue.push_back(value);
+            drop(queue);
+            wake(&self.shared.receiver_waker);
+            Ok(())
+        }
+
+        /// Checks whether the receiver has been dropped.
+        pub fn is_closed(&self) -> bool {
+            self.shared.receiver_dropped.get()
+        }
+
+        #[cfg(test)]
+        pub(super) fn waiting_senders(&self) -> usize {
+            self.shared.sender_waiters.len()
+        }
+    }
+
+    impl<T> Clone for Sender<T> {
+        fn clone(&self) -> Self {
+            self.shared.senders.set(self.shared.senders.get() + 1);
+            Sender {
+                shared: self.shared.clone(),
+            }
+        }
+    }
+
+    impl<T> Drop for Sender<T> {
+        fn drop(&mut self) {
+            let senders = self.shared.senders.get() - 1;
+            self.shared.senders.set(senders);
+            if senders == 0 {
+                wake(&self.shared.receiver_waker);
+            }
+        }
+    }
+
+    /// The receiving half of a [`channel`], also usable as a [`Stream`].
+    pub struct Receiver<T> {
+        shared: Rc<Shared<T>>,
+    }
+
+    impl<T> Receiver<T> {
+        /// Returns the next value if there is one.
+        pub fn try_recv(&mut self) -> Option<T> {
+            let value = self.shared.queue.borrow_mut().pop_front();
+            if value.is_some() {
+                // One slot is free, for one sender.
+                self.shared.sender_waiters.wake_one();
+            }
+            value
+        }
+
+        /// Waits for the next value.
+        ///
+        /// Returns `None` once all senders have been dropped and the channel is empty.
+        pub async fn recv(&mut self) -> Option<T> {
+            poll_fn(|cx| self.poll_recv(cx)).await
+        }
+
+        fn poll_recv(&mut self, cx: &mut Context<'_>) -> Poll<Option<T>> {
+            if let Some(value) = self.try_recv() {
+                return Poll::Ready(Some(value));
+            }
+            if self.shared.senders.get() == 0 {
+                return Poll::Ready(None);
+            }
+            register(&self.shared.receiver_waker, cx.waker());
+            Poll::Pending
+        }
+
+        /// Returns the number of values in the channel.
+        pub fn len(&self) -> usize {
+            self.shared.queue.borrow().len()
+        }
+
+        /// Checks whether the channel is empty.
+        pub fn is_empty(&self) -> bool {
+            self.len() == 0
+        }
+    }
+
+    impl<T> Stream for Receiver<T> {
+        type Item = T;
+
+        fn poll_next(self: Pin<&mut Self>, cx: &mut Context<'_>) -> Poll<Option<T>> {
+            self.get_mut().poll_recv(cx)
+        }
+    }
+
+    impl<T> Drop for Receiver<T> {
+        fn drop(&mut self) {
+            self.shared.receiver_dropped.set(true);
+            self.shared.queue.borrow_mut().clear();
+            self.shared.sender_waiters.wake_all();
+        }
+    }
+}
+
+/// A bounded broadcast channel between tasks on the same shard:
+/// every receiver gets a clone of every value.
+pub mod broadcast {
+    use super::{Wait, WaitQueue};
+    use std::cell::{Cell, RefCell};
+    use std::collections::VecDeque;
+    use std::future::poll_fn;
+    use std::rc::Rc;
+    use std::task::Poll;
+    use thiserror::Error;
+
+    /// Error returned by [`Sender::send`] when there are no receivers.
+    /// Contains the value that was not sent.
+    #[derive(Error, Debug, PartialEq, Eq)]
+    #[error("SendError: no broadcast receivers")]
+    pub struct SendError<T>(pub T);
+
+    /// Error returned by [`Receiver::recv`].
+    #[derive(Error, Debug, PartialEq, Eq)]
+    pub enum RecvError {
+        /// All senders have been dropped and every value has been received.
+        #[error("RecvError: broadcast channel closed")]
+        Closed,
+        /// The receiver fell behind and the given number of the oldest values
+        /// it has not received yet were dropped. The next call returns the
+        /// oldest value still in the channel.
+        #[error("RecvError: broadcast receiver lagged by {0} values")]
+        Lagged(u64),
+    }
+
+    struct Shared<T> {
+        /// The last `capacity` values; `values[0]` has sequence number `first`.
+        values: RefCell<VecDeque<T>>,
+        first: Cell<u64>,
+        capacity: usize,
+        waiters: WaitQueue,
+        senders: Cell<usize>,
+        receivers: Cell<usize>,
+    }
+
+    impl<T> Shared<T> {
+        fn end(&self) -> u64 {
+            self.first.get() + self.values.borrow().len() as u64
+        }
+    }
+
+    /// Creates a channel keeping the last `capacity` values for receivers that fall behind.
+    ///
+    /// Sending never waits: when a receiver is more than `capacity` values behind,
+    /// it misses the oldest ones (see [`RecvError::Lagged`]).
+    ///
+    /// # Example
+    ///
+    /// ```rust
+    /// #[seastar::test]
+    /// async fn broadcast_example() {
+    ///     let (tx, mut rx1) = broadcast::channel(16);
+    ///     let mut rx2 = tx.subscribe();
+    ///     tx.send("config changed").unwrap();
+    ///     assert_eq!(rx1.recv().await, Ok("config changed"));
+    ///     assert_eq!(rx2.recv().await, Ok("config changed"));
+    /// }
+    /// ```
+    pub fn channel<T: Clone>(capacity: usize) -> (Sender<T>, Receiver<T>) {
+        assert!(capacity > 0, "Capacity must be positive");
+        let shared = Rc::new(Shared {
+            values: RefCell::new(VecDeque::with_capacity(capacity)),
+            first: Cell::new(0),
+            capacity,
+            waiters: WaitQueue::default(),
+            senders: Cell::new(1),
+            receivers: Cell::new(1),
+        });
+        (
+            Sender {
+                shared: shared.clone(),
+            },
+            Receiver { shared, next: 0 },
+        )
+    }
+
+    /// The sending half of a [`channel`]. Can be cloned to create more senders.
+    pub struct Sender<T: Clone> {
+        shared: Rc<Shared<T>>,
+    }
+
+    impl<T: Clone> Sender<T> {
+        /// Sends `value` to all receivers. Never waits.
+        ///
+        /// Returns the number of receivers, or the value back if there are none.
+        pub fn send(&self, value: T) -> Result<usize, SendError<T>> {
+            let receivers = self.shared.receivers.get();
+            if receivers == 0 {
+                return Err(SendError(value));
+            }
+            let mut values = self.shared.values.borrow_mut();
+            if values.len() == self.shared.capacity {
+                values.pop_front();
+                self.shared.first.set(self.shared.first.get() + 1);
+            }
+            values.push_back(value);
+            drop(values);
+            self.shared.waiters.wake_all();
+            Ok(receivers)
+        }
+
+        /// Creates a receiver of the values sent from now on.
+        pub fn subscribe(&self) -> Receiver<T> {
+            self.shared.receivers.set(self.shared.receivers.get() + 1);
+            Receiver {
+                next: self.shared.end(),
+                shared: self.shared.clone(),
+            }
+        }
+
+        /// Returns the number of receivers.
+        pub fn receiver_count(&self) -> usize {
+            self.shared.receivers.get()
+        }
+
+        #[cfg(test)]
+        pub(super) fn waiting_receivers(&self) -> usize {
+            self.shared.waiters.len()
+        }
+    }
+
+    impl<T: Clone> Clone for Sender<T> {
+        fn clone(&self) -> Self {
+            self.shared.senders.set(self.shared.senders.get() + 1);
+            Sender {
+                shared: self.shared.clone(),
+            }
+        }
+    }
+
+    impl<T: Clone> Drop for Sender<T> {
+        fn drop(&mut self) {
+            let senders = self.shared.senders.get() - 1;
+            self.shared.senders.set(senders);
+            if senders == 0 {
+                self.shared.waiters.wake_all();
+            }
+        }
+    }
+
+    /// The receiving half of a [`channel`].
+    pub struct Receiver<T: Clone> {
+        shared: Rc<Shared<T>>,
+        /// Sequence number of the next value to receive.
+        next: u64,
+    }
+
+    impl<T: Clone> Receiver<T> {
+        /// Returns the next value if there is one.
+        pub fn try_recv(&mut self) -> Result<Option<T>, RecvError> {
+            let first = self.shared.first.get();
+            if self.next < first {
+                let lagged = first - self.next;
+                self.next = first;
+                return Err(RecvError::Lagged(lagged));
+            }
+            let values = self.shared.values.borrow();
+            match values.get((self.next - first) as usize) {
+                Some(value) => {
+                    self.next += 1;
+                    Ok(Some(value.clone()))
+                }
+                None if self.shared.senders.get() == 0 => Err(RecvError::Closed),
+                None => Ok(None),
+            }
+        }
+
+        /// Waits for the next value.
+        pub async fn recv(&mut self) -> Result<T, RecvError> {
+            let shared = self.shared.clone();
+            let mut wait = Wait::new(&shared.waiters);
+            poll_fn(|cx| match self.try_recv() {
+                Ok(None) => {
+                    wait.register(cx.waker());
+                    Poll::Pending
+                }
+                ret => {
+                    wait.finish();
+                    Poll::Ready(ret.map(Option::unwrap))
+                }
+            })
+            .await
+        }
+    }
+
+    impl<T: Clone> Clone for Receiver<T> {
+        /// Creates a receiver at the same position.
+        fn clone(&self) -> Self {
+            self.shared.receivers.set(self.shared.receivers.get() + 1);
+            Receiver {
+                shared: self.shared.clone(),
+                next: self.next,
+            }
+        }
+    }
+
+    impl<T: Clone> Drop for Receiver<T> {
+        fn drop(&mut self) {
+            self.shared.receivers.set(self.shared.receivers.get() - 1);
+        }
+    }
+}
+
+#[cfg(test)]
+mod tests {
+    use super::*;
+    use crate as seastar;
+    use crate::spawn_detached;
+    use futures::join;
+
+    #[seastar::test(shared)]
+    async fn test_oneshot() {
+        let (tx, rx) = oneshot::channel();
+        spawn_detached(async move {
+            tx.send(42).unwrap();
+        });
+        assert_eq!(rx.await, Ok(42));
+
+        let (tx, rx) = oneshot::channel::<i32>();
+        drop(tx);
+        assert_eq!(rx.await, Err(oneshot::Canceled));
+
+        let (tx, rx) = oneshot::channel();
+        drop(rx);
+        assert_eq!(tx.send(42), Err(42));
+    }
+
+    #[seastar::test(shared)]
+    async fn test_mpsc_backpressure() {
+        let (tx, mut rx) = mpsc::channel(2);
+        tx.try_send(1).unwrap();
+        tx.try_send(2).unwrap();
+        assert_eq!(tx.try_send(3), Err(mpsc::TrySendError::Full(3)));
+
+        let sender = async {
+            tx.send(3).await.unwrap();
+            drop(tx);
+        };
+        let receiver = async {
+            let mut received = Vec::new();
+            while let Some(value) = rx.recv().await {
+                received.push(value);
+            }
+            received
+        };
+        let ((), received) = join!(sender, receiver);
+        assert_eq!(received, [1, 2, 3]);
+    }
+
+    #[seastar::test(shared)]
+    async fn test_mpsc_receiver_dropped() {
+        let (tx, rx) = mpsc::channel(1);
+        let tx2 = tx.clone();
+        tx.try_send(1).unwrap();
+        drop(rx);
+        assert!(tx2.is_closed());
+        assert_eq!(tx.send(2).await, Err(mpsc::SendError(2)));
+    }
+
+    #[seastar::test(shared)]
+    async fn test_mpsc_senders_wait_once_and_one_at_a_time() {
+        let (tx, mut rx) = mpsc::channel(1);
+        tx.try_send(0).unwrap();
+        let mut first = Box::pin(tx.send(1));
+        let mut second = Box::pin(tx.send(2));
+        for _ in 0..3 {
+            assert!(futures::poll!(&mut first).is_pending());
+            assert!(futures::poll!(&mut second).is_pending());
+        }
+        assert_eq!(tx.waiting_senders(), 2);
+
+        // One free slot wakes up one sender.
+        assert_eq!(rx.try_recv(), Some(0));
+        assert_eq!(tx.waiting_senders(), 1);
+        assert!(futures::poll!(&mut first).is_ready());
+        assert!(futures::poll!(&mut second).is_pending());
+
+        // A sender that gives up leaves the queue.
+        drop(second);
+        assert_eq!(tx.waiting_senders(), 0);
+    }
+
+    #[seastar::test(shared)]
+    async fn test_mpsc_dropped_sender_passes_wakeup_on() {
+        let (tx, mut rx) = mpsc::channel(1);
+        tx.try_send(0).unwrap();
+        let mut first = Box::pin(tx.send(1));
+        let mut second = Box::pin(tx.send(2));
+        assert!(futures::poll!(&mut first).is_pending());
+        assert!(futures::poll!(&mut second).is_pending());
+        assert_eq!(rx.try_recv(), Some(0));
+        drop(first);
+        assert!(futures::poll!(&mut second).is_ready());
+        assert_eq!(rx.try_recv(), Some(2));
+    }
+
+    #[seastar::test(shared)]
+    async fn test_broadcast_receiver_waits_once() {
+        let (tx, mut rx) = broadcast::channel(2);
+        {
+            let mut recv = Box::pin(rx.recv());
+            for _ in 0..3 {
+                assert!(futures::poll!(&mut recv).is_pending());
+            }
+            assert_eq!(tx.waiting_receivers(), 1);
+        }
+        assert_eq!(tx.waiting_receivers(), 0);
+        tx.send(1).unwrap();
+        assert_eq!(rx.recv().await, Ok(1));
+    }
+
+    #[seastar::test(shared)]
+    async fn test_broadcast() {
+        let (tx, mut rx1) = broadcast::channel(2);
+        let mut rx2 = tx.subscribe();
+        assert_eq!(tx.send(1), Ok(2));
+        assert_eq!(rx1.recv().await, Ok(1));
+        tx.send(2).unwrap();
+        tx.send(3).unwrap();
+        assert_eq!(rx2.recv().await, Err(broadcast::RecvError::Lagged(1)));
+        assert_eq!(rx2.recv().await, Ok(2));
+        drop(tx);
+        assert_eq!(rx1.recv().await, Ok(2));
+        assert_eq!(rx1.recv().await, Ok(3));
+        assert_eq!(rx1.recv().await, Err(broadcast::RecvError::Closed));
+    }
+}
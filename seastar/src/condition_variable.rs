@@ -0,0 +1,249 @@
+//! A shard-local condition variable.
+//!
+//! Like the [shard-local channels](crate::oneshot), it is neither `Send` nor
+//! `Sync`, and waking up a waiter reschedules its Seastar task directly.
+
+use std::cell::{Cell, RefCell};
+use std::collections::VecDeque;
+use std::future::Future;
+use std::pin::Pin;
+use std::rc::Rc;
+use std::task::{Context, Poll, Waker};
+
+struct Waiter {
+    waker: Cell<Option<Waker>>,
+    notified: Cell<bool>,
+}
+
+/// Conditional variable.
+///
+/// This is a standard computer science condition variable sans locking,
+/// since in Seastar access to variables is atomic anyway, adapted for futures.
+/// Tasks can wait on it until it is signaled, either one at a time
+/// ([`signal`](ConditionVariable::signal)), in FIFO order, or all at once
+/// ([`broadcast`](ConditionVariable::broadcast)).
+///
+/// Signals are not remembered: signaling a condition variable nobody waits
+/// on does nothing. A task starts waiting when it calls
+/// [`wait`](ConditionVariable::wait), not when it first polls the returned
+/// future.
+///
+/// # Example
+///
+/// ```rust
+/// #[seastar::test]
+/// async fn condition_variable_example() {
+///     let ready = Rc::new(Cell::new(false));
+///     let cv = Rc::new(ConditionVariable::new());
+///     let waiter = {
+///         let (ready, cv) = (ready.clone(), cv.clone());
+///         spawn(async move { cv.when(|| ready.get()).await })
+///     };
+///     ready.set(true);
+///     cv.broadcast();
+///     waiter.await;
+/// }
+/// ```
+#[derive(Default)]
+pub struct ConditionVariable {
+    waiters: RefCell<VecDeque<Rc<Waiter>>>,
+}
+
+impl ConditionVariable {
+    /// Creates a condition variable with no waiters.
+    pub fn new() -> Self {
+        ConditionVariable {
+            waiters: RefCell::new(VecDeque::new()),
+        }
+    }
+
+    /// Waits until the condition variable is signaled.
+    pub fn wait(&self) -> Wait<'_> {
+        let waiter = Rc::new(Waiter {
+            waker: Cell::new(None),
+            notified: Cell::new(false),
+        });
+        self.waiters.borrow_mut().push_back(waiter.clone());
+        Wait {
+            cv: self,
+            waiter: Some(waiter),
+        }
+    }
+
+    /// Waits until `pred` returns true.
+    ///
+    /// `pred` is checked right away, then every time the waiter is signaled.
+    pub async fn when<P>(&self, mut pred: P)
+    where
+        P: FnMut() -> bool,
+    {
+        while !pred() {
+            self.wait().await;
+        }
+    }
+
+    /// Wakes up the longest-waiting waiter, if any.
+    pub fn signal(&self) {
+        let waiter = self.waiters.borrow_mut().pop_front();
+        if let Some(waiter) = waiter {
+            notify(&waiter);
+        }
+    }
+
+    /// Wakes up all waiters.
+    pub fn broadcast(&self) {
+        let waiters = std::mem::take(&mut *self.waiters.borrow_mut());
+        for waiter in &waiters {
+            notify(waiter);
+        }
+    }
+
+    /// Returns whether any task is waiting.
+    pub fn has_waiters(&self) -> bool {
+        !self.waiters.borrow().is_empty()
+    }
+}
+
+fn notify(waiter: &Waiter) {
+    waiter.notified.set(true);
+    if let Some(waker) = waiter.waker.take() {
+        waker.wake();
+    }
+}
+
+/// Future returned by [`ConditionVariable::wait`].
+pub struct Wait<'a> {
+    cv: &'a ConditionVariable,
+    waiter: Option<Rc<Waiter>>,
+}
+
+impl Future for Wait<'_> {
+    type Output = ();
+
+    fn poll(mut self: Pin<&mut Self>, cx: &mut Context<'_>) -> Poll<()> {
+        let waiter = self.waiter.as_ref().expect("Wait polled after completion");
+        if waiter.notified.get() {
+            self.waiter = None;
+            return Poll::Ready(());
+        }
+        match waiter.waker.take() {
+            Some(old) if old.will_wake(cx.waker()) => waiter.waker.set(Some(old)),
+            _ => waiter.waker.set(Some(cx.waker().clone())),
+        }
+        Poll::Pending
+    }
+}
+
+impl Drop for Wait<'_> {
+    fn drop(&mut self) {
+        if let Some(waiter) = self.waiter.take() {
+            if waiter.notified.get() {
+                // The signal was meant for a waiter, pass it on.
+                self.cv.signal();
+            } else {
+                let mut waiters = self.cv.waiters.borrow_mut();
+                if let Some(i) = waiters.iter().position(|w| Rc::ptr_eq(w, &waiter)) {
+                    waiters.remove(i);
+                }
+            }
+        }
+    }
+}
+
+#[cfg(test)]
+mod tests {
+    use super::*;
+    use crate as seastar;
+    use crate::{spawn, yield_now};
+
+    #[seastar::test(shared)]
+    async fn test_signal_wakes_one_in_fifo_order() {
+        let cv = Rc::new(ConditionVariable::new());
+        let order = Rc::new(RefCell::new(Vec::new()));
+        let waiters: Vec<_> = (0..3)
+            .map(|i| {
+                let (cv, order) = (cv.clone(), order.clone());
+                let wait = cv.wait();
+                drop(wait);
+                spawn(async move {
+                    cv.wait().await;
+                    order.borrow_mut().push(i);
+                })
+            })
+            .collect();
+        yield_now().await;
+        assert!(cv.has_waiters());
+
+        cv.signal();
+        yield_now().await;
+        assert_eq!(*order.borrow(), vec![0]);
+        cv.signal();
+        cv.signal();
+        for waiter in waiters {
+            waiter.await;
+        }
+        assert_eq!(*order.borrow(), vec![0, 1, 2]);
+        assert!(!cv.has_waiters());
+    }
+
+    #[seastar::test(shared)]
+    async fn test_broadcast_wakes_all() {
+        let cv = Rc::new(ConditionVariable::new());
+        let waiters: Vec<_> = (0..10)
+            .map(|_| {
+                let cv = cv.clone();
+                spawn(async move { cv.wait().await })
+            })
+            .collect();
+        yield_now().await;
+        cv.broadcast();
+        for waiter in waiters {
+            waiter.await;
+        }
+    }
+
+    #[seastar::test(shared)]
+    async fn test_wait_registers_before_poll() {
+        let cv = ConditionVariable::new();
+        let wait = cv.wait();
+        cv.signal();
+        wait.await;
+    }
+
+    #[seastar::test(shared)]
+    async fn test_dropped_waiter_passes_signal_on() {
+        let cv = ConditionVariable::new();
+        let first = cv.wait();
+        let second = cv.wait();
+        cv.signal();
+        drop(first);
+        second.await;
+    }
+
+    #[seastar::test(shared)]
+    async fn test_dropped_waiters_are_removed() {
+        let cv = ConditionVariable::new();
+        let waits: Vec<_> = (0..3).map(|_| cv.wait()).collect();
+        let last = cv.wait();
+        drop(waits);
+        assert_eq!(cv.waiters.borrow().len(), 1);
+        drop(last);
+        assert!(!cv.has_waiters());
+    }
+
+    #[seastar::test(shared)]
+    async fn test_when() {
+        let cv = Rc::new(ConditionVariable::new());
+        let value = Rc::new(Cell::new(0));
+        let waiter = {
+            let (cv, value) = (cv.clone(), value.clone());
+            spawn(async move { cv.when(|| value.get() == 3).await })
+        };
+        for i in 1..=3 {
+            yield_now().await;
+            value.set(i);
+            cv.signal();
+        }
+        waiter.await;
+    }
+}
@@ -1,4 +1,6 @@
 #include "config_and_start_seastar.hh"
+#include <seastar/core/resource.hh>
+#include <seastar/util/conversions.hh>
 
 namespace seastar_ffi {
 namespace config_and_start_seastar {
@@ -35,20 +37,151 @@ void set_smp(seastar_options& opts, const uint32_t smp) {
     opts.smp_opts.smp.set_value((unsigned)smp);
 }
 
+bool get_memory(const seastar_options& opts, uint64_t& memory) {
+    if (!opts.smp_opts.memory) {
+        return false;
+    }
+    memory = seastar::parse_memory_size(opts.smp_opts.memory.get_value());
+    return true;
+}
+
+bool get_reserve_memory(const seastar_options& opts, uint64_t& reserve_memory) {
+    if (!opts.smp_opts.reserve_memory) {
+        return false;
+    }
+    reserve_memory = seastar::parse_memory_size(opts.smp_opts.reserve_memory.get_value());
+    return true;
+}
+
+double get_task_quota_ms(const seastar_options& opts) {
+    return opts.reactor_opts.task_quota_ms.get_value();
+}
+
+rust::String get_reactor_backend(const seastar_options& opts) {
+    return rust::String(opts.reactor_opts.reactor_backend.get_selected_candidate_name());
+}
+
+bool get_poll_mode(const seastar_options& opts) {
+    return bool(opts.reactor_opts.poll_mode);
+}
+
+uint32_t get_idle_poll_time_us(const seastar_options& opts) {
+    return (uint32_t)opts.reactor_opts.idle_poll_time_us.get_value();
+}
+
+rust::Vec<uint32_t> get_cpuset(const seastar_options& opts) {
+    rust::Vec<uint32_t> cpus;
+    if (opts.smp_opts.cpuset) {
+        for (auto cpu : opts.smp_opts.cpuset.get_value()) {
+            cpus.push_back((uint32_t)cpu);
+        }
+    }
+    return cpus;
+}
+
+bool get_thread_affinity(const seastar_options& opts) {
+    return opts.smp_opts.thread_affinity.get_value();
+}
+
+bool get_overprovisioned(const seastar_options& opts) {
+    return bool(opts.reactor_opts.overprovisioned);
+}
+
+static rust::Str get_string_value(const seastar::program_options::value<std::string>& value) {
+    if (!value) {
+        return rust::Str();
+    }
+    const auto& str = value.get_value();
+    return rust::Str(str.data(), str.size());
+}
+
+rust::Str get_hugepages(const seastar_options& opts) {
+    return get_string_value(opts.smp_opts.hugepages);
+}
+
+rust::Str get_io_properties(const seastar_options& opts) {
+    return get_string_value(opts.smp_opts.io_properties);
+}
+
+rust::Str get_io_properties_file(const seastar_options& opts) {
+    return get_string_value(opts.smp_opts.io_properties_file);
+}
+
+void set_memory(seastar_options& opts, const uint64_t memory) {
+    opts.smp_opts.memory.set_value(std::to_string(memory));
+}
+
+void set_reserve_memory(seastar_options& opts, const uint64_t reserve_memory) {
+    opts.smp_opts.reserve_memory.set_value(std::to_string(reserve_memory));
+}
+
+void set_task_quota_ms(seastar_options& opts, const double task_quota_ms) {
+    opts.reactor_opts.task_quota_ms.set_value(task_quota_ms);
+}
+
+void set_reactor_backend(seastar_options& opts, const rust::Str backend) {
+    opts.reactor_opts.reactor_backend.select_candidate(std::string(backend));
+}
+
+void set_poll_mode(seastar_options& opts, const bool poll_mode) {
+    if (poll_mode) {
+        opts.reactor_opts.poll_mode.set_value();
+    } else {
+        opts.reactor_opts.poll_mode.unset_value();
+    }
+}
+
+void set_idle_poll_time_us(seastar_options& opts, const uint32_t idle_poll_time_us) {
+    opts.reactor_opts.idle_poll_time_us.set_value((unsigned)idle_poll_time_us);
+}
+
+void set_cpuset(seastar_options& opts, const rust::Slice<const uint32_t> cpuset) {
+    seastar::resource::cpuset cpus;
+    for (auto cpu : cpuset) {
+        cpus.insert((unsigned)cpu);
+    }
+    opts.smp_opts.cpuset.set_value(std::move(cpus));
+}
+
+void set_thread_affinity(seastar_options& opts, const bool thread_affinity) {
+    opts.smp_opts.thread_affinity.set_value(thread_affinity);
+}
+
+void set_overprovisioned(seastar_options& opts, const bool overprovisioned) {
+    if (overprovisioned) {
+        opts.reactor_opts.overprovisioned.set_value();
+    } else {
+        opts.reactor_opts.overprovisioned.unset_value();
+    }
+}
+
+void set_hugepages(seastar_options& opts, const rust::Str path) {
+    opts.smp_opts.hugepages.set_value(std::string(path));
+}
+
+void set_io_properties(seastar_options& opts, const rust::Str io_properties) {
+    opts.smp_opts.io_properties.set_value(std::string(io_properties));
+}
+
+void set_io_properties_file(seastar_options& opts, const rust::Str path) {
+    opts.smp_opts.io_properties_file.set_value(std::string(path));
+}
+
 std::unique_ptr<app_template> new_app_template_from_options(seastar_options& opts) {
     return std::make_unique<app_template>(std::move(opts));
 }
 
-int32_t run_void(app_template& app, int32_t argc, char** argv, VoidFuture fut) {
+int32_t run_void(app_template& app, int32_t argc, char** argv, uint8_t* fut, rust::Fn<VoidFuture(uint8_t*)> starter) {
+    // The Rust future is shard-local, so it is only started inside the runtime.
     int32_t exit_value = app.run((int)argc, argv, [&]() -> seastar::future<> {
-        co_await std::move(fut);
+        co_await starter(fut);
     });
     return exit_value;
 }
 
-int32_t run_int(app_template& app, int32_t argc, char** argv, IntFuture fut) {
+int32_t run_int(app_template& app, int32_t argc, char** argv, uint8_t* fut, rust::Fn<IntFuture(uint8_t*)> starter) {
     int32_t exit_value = app.run((int)argc, argv, [&]() -> seastar::future<int> {
-        co_return co_await std::move(fut);
+        co_return co_await starter(fut);
     });
     return exit_value;
 }
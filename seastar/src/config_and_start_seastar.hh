@@ -26,11 +26,59 @@ void set_description(seastar_options& opts, const rust::Str description);
 
 void set_smp(seastar_options& opts, const uint32_t smp);
 
+bool get_memory(const seastar_options& opts, uint64_t& memory);
+
+bool get_reserve_memory(const seastar_options& opts, uint64_t& reserve_memory);
+
+double get_task_quota_ms(const seastar_options& opts);
+
+rust::String get_reactor_backend(const seastar_options& opts);
+
+bool get_poll_mode(const seastar_options& opts);
+
+uint32_t get_idle_poll_time_us(const seastar_options& opts);
+
+rust::Vec<uint32_t> get_cpuset(const seastar_options& opts);
+
+bool get_thread_affinity(const seastar_options& opts);
+
+bool get_overprovisioned(const seastar_options& opts);
+
+rust::Str get_hugepages(const seastar_options& opts);
+
+rust::Str get_io_properties(const seastar_options& opts);
+
+rust::Str get_io_properties_file(const seastar_options& opts);
+
+void set_memory(seastar_options& opts, const uint64_t memory);
+
+void set_reserve_memory(seastar_options& opts, const uint64_t reserve_memory);
+
+void set_task_quota_ms(seastar_options& opts, const double task_quota_ms);
+
+void set_reactor_backend(seastar_options& opts, const rust::Str backend);
+
+void set_poll_mode(seastar_options& opts, const bool poll_mode);
+
+void set_idle_poll_time_us(seastar_options& opts, const uint32_t idle_poll_time_us);
+
+void set_cpuset(seastar_options& opts, const rust::Slice<const uint32_t> cpuset);
+
+void set_thread_affinity(seastar_options& opts, const bool thread_affinity);
+
+void set_overprovisioned(seastar_options& opts, const bool overprovisioned);
+
+void set_hugepages(seastar_options& opts, const rust::Str path);
+
+void set_io_properties(seastar_options& opts, const rust::Str io_properties);
+
+void set_io_properties_file(seastar_options& opts, const rust::Str path);
+
 std::unique_ptr<app_template> new_app_template_from_options(seastar_options& opts);
 
-int32_t run_void(app_template& app, int argc, char** args, VoidFuture fut);
+int32_t run_void(app_template& app, int argc, char** args, uint8_t* fut, rust::Fn<VoidFuture(uint8_t*)> starter);
 
-int32_t run_int(app_template& app, int argc, char** args, IntFuture fut);
+int32_t run_int(app_template& app, int argc, char** args, uint8_t* fut, rust::Fn<IntFuture(uint8_t*)> starter);
 
 } // namespace config_and_start_seastar
 } // namespace seastar
\ No newline at end of file
@@ -1,10 +1,14 @@
 use std::{
+    cell::Cell,
     ffi::{c_char, CString, OsString},
     future::Future,
+    rc::Rc,
+    time::{Duration, Instant},
 };
 
 use cxx::UniquePtr;
 use ffi::*;
+use thiserror::Error;
 
 use crate::cxx_async_local_future::IntoCxxAsyncLocalFuture;
 
@@ -33,6 +37,31 @@ mod ffi {
         fn set_name(opts: Pin<&mut seastar_options>, name: &str);
         fn set_description(opts: Pin<&mut seastar_options>, description: &str);
         fn set_smp(opts: Pin<&mut seastar_options>, smp: u32);
+        // Reactor and smp options
+        fn get_memory(opts: &seastar_options, memory: &mut u64) -> bool;
+        fn get_reserve_memory(opts: &seastar_options, reserve_memory: &mut u64) -> bool;
+        fn get_task_quota_ms(opts: &seastar_options) -> f64;
+        fn get_reactor_backend(opts: &seastar_options) -> String;
+        fn get_poll_mode(opts: &seastar_options) -> bool;
+        fn get_idle_poll_time_us(opts: &seastar_options) -> u32;
+        fn get_cpuset(opts: &seastar_options) -> Vec<u32>;
+        fn get_thread_affinity(opts: &seastar_options) -> bool;
+        fn get_overprovisioned(opts: &seastar_options) -> bool;
+        fn get_hugepages(opts: &seastar_options) -> &str;
+        fn get_io_properties(opts: &seastar_options) -> &str;
+        fn get_io_properties_file(opts: &seastar_options) -> &str;
+        fn set_memory(opts: Pin<&mut seastar_options>, memory: u64);
+        fn set_reserve_memory(opts: Pin<&mut seastar_options>, reserve_memory: u64);
+        fn set_task_quota_ms(opts: Pin<&mut seastar_options>, task_quota_ms: f64);
+        fn set_reactor_backend(opts: Pin<&mut seastar_options>, backend: &str) -> Result<()>;
+        fn set_poll_mode(opts: Pin<&mut seastar_options>, poll_mode: bool);
+        fn set_idle_poll_time_us(opts: Pin<&mut seastar_options>, idle_poll_time_us: u32);
+        fn set_cpuset(opts: Pin<&mut seastar_options>, cpuset: &[u32]);
+        fn set_thread_affinity(opts: Pin<&mut seastar_options>, thread_affinity: bool);
+        fn set_overprovisioned(opts: Pin<&mut seastar_options>, overprovisioned: bool);
+        fn set_hugepages(opts: Pin<&mut seastar_options>, path: &str);
+        fn set_io_properties(opts: Pin<&mut seastar_options>, io_properties: &str);
+        fn set_io_properties_file(opts: Pin<&mut seastar_options>, path: &str);
 
         // Returns a pointer to an `app_template` instance
         fn new_app_template_from_options(
@@ -43,17 +72,57 @@ mod ffi {
             app: Pin<&mut app_template>,
             argc: i32,
             args: *mut *mut c_char,
-            fut: VoidFuture,
+            fut: *mut u8,
+            starter: unsafe fn(*mut u8) -> VoidFuture,
         ) -> i32;
         unsafe fn run_int(
             app: Pin<&mut app_template>,
             argc: i32,
             args: *mut *mut c_char,
-            fut: IntFuture,
+            fut: *mut u8,
+            starter: unsafe fn(*mut u8) -> IntFuture,
         ) -> i32;
     }
 }
 
+/// Error returned when an option is given a value it does not accept.
+#[derive(Error, Debug)]
+#[error("OptionsError: {0}")]
+pub struct OptionsError(String);
+
+/// The reactor's internal polling and I/O mechanism.
+#[derive(Clone, Debug, PartialEq, Eq)]
+pub enum ReactorBackend {
+    /// `epoll`, with `linux-aio` for disk I/O.
+    Epoll,
+    /// `linux-aio` for both network and disk I/O.
+    LinuxAio,
+    /// `io_uring`.
+    IoUring,
+    /// A backend this crate does not know about, by its Seastar name.
+    Unknown(String),
+}
+
+impl ReactorBackend {
+    fn name(&self) -> &str {
+        match self {
+            ReactorBackend::Epoll => "epoll",
+            ReactorBackend::LinuxAio => "linux-aio",
+            ReactorBackend::IoUring => "io_uring",
+            ReactorBackend::Unknown(name) => name,
+        }
+    }
+
+    fn from_name(name: String) -> Self {
+        match name.as_str() {
+            "epoll" => ReactorBackend::Epoll,
+            "linux-aio" => ReactorBackend::LinuxAio,
+            "io_uring" => ReactorBackend::IoUring,
+            _ => ReactorBackend::Unknown(name),
+        }
+    }
+}
+
 /// The configuration of an [`AppTemplate`] instance.
 /// Some of the options are just metadata, others affect the app's performance.
 pub struct Options {
@@ -83,6 +152,37 @@ impl Options {
         }
     }
 
+    /// Creates `Options` for short-lived processes, such as CLI tools and
+    /// batch jobs, which care more about launch time than throughput.
+    ///
+    /// Compared to [`new`](Options::new), the app is overprovisioned and its
+    /// shards are not pinned to CPUs, and the reactors sleep when idle instead
+    /// of polling. No I/O properties are set, so none are parsed.
+    ///
+    /// Seastar sets up each shard's share of the memory at startup, so setting
+    /// the memory (see [`set_memory`](Options::set_memory)) to what the job
+    /// needs shortens the start further.
+    ///
+    /// # Examples
+    ///
+    /// ```rust
+    /// use seastar::{AppTemplate, Options};
+    ///
+    /// let mut opts = Options::fast_startup();
+    /// opts.set_smp(1);
+    /// opts.set_memory(256 << 20);
+    /// let mut app = AppTemplate::new_from_options(opts);
+    ///
+    /// assert_eq!(app.launch_int(async { Ok(7) }), 7);
+    /// ```
+    pub fn fast_startup() -> Self {
+        let mut opts = Options::new();
+        opts.set_overprovisioned(true);
+        opts.set_thread_affinity(false);
+        opts.set_poll_mode(false);
+        opts
+    }
+
     /// Gets the `Options`' name.
     ///
     /// # Examples
@@ -178,6 +278,189 @@ impl Options {
     pub fn set_smp(&mut self, smp: u32) {
         set_smp(self.opts.pin_mut(), smp);
     }
+
+    /// Gets the memory to use, in bytes (`--memory`).
+    ///
+    /// Returns `None` if it is not set, in which case all available memory is used.
+    pub fn get_memory(&self) -> Option<u64> {
+        let mut memory = 0;
+        get_memory(&self.opts, &mut memory).then_some(memory)
+    }
+
+    /// Sets the memory to use, in bytes (`--memory`).
+    ///
+    /// # Examples
+    ///
+    /// ```rust
+    /// use seastar::Options;
+    ///
+    /// let mut opts = Options::new();
+    /// opts.set_memory(4 << 30);
+    ///
+    /// assert_eq!(opts.get_memory(), Some(4 << 30));
+    /// ```
+    pub fn set_memory(&mut self, memory: u64) {
+        set_memory(self.opts.pin_mut(), memory);
+    }
+
+    /// Gets the memory reserved to the OS, in bytes (`--reserve-memory`).
+    ///
+    /// Returns `None` if it is not set.
+    pub fn get_reserve_memory(&self) -> Option<u64> {
+        let mut reserve_memory = 0;
+        get_reserve_memory(&self.opts, &mut reserve_memory).then_some(reserve_memory)
+    }
+
+    /// Sets the memory reserved to the OS, in bytes (`--reserve-memory`).
+    pub fn set_reserve_memory(&mut self, reserve_memory: u64) {
+        set_reserve_memory(self.opts.pin_mut(), reserve_memory);
+    }
+
+    /// Gets the max time (ms) between polls (`--task-quota-ms`).
+    pub fn get_task_quota_ms(&self) -> f64 {
+        get_task_quota_ms(&self.opts)
+    }
+
+    /// Sets the max time (ms) between polls (`--task-quota-ms`).
+    ///
+    /// # Examples
+    ///
+    /// ```rust
+    /// use seastar::Options;
+    ///
+    /// let mut opts = Options::new();
+    /// opts.set_task_quota_ms(0.1);
+    ///
+    /// assert_eq!(opts.get_task_quota_ms(), 0.1);
+    /// ```
+    pub fn set_task_quota_ms(&mut self, task_quota_ms: f64) {
+        set_task_quota_ms(self.opts.pin_mut(), task_quota_ms);
+    }
+
+    /// Gets the internal reactor implementation (`--reactor-backend`).
+    ///
+    /// Backends this crate does not know about are returned as
+    /// [`ReactorBackend::Unknown`].
+    pub fn get_reactor_backend(&self) -> ReactorBackend {
+        ReactorBackend::from_name(get_reactor_backend(&self.opts))
+    }
+
+    /// Sets the internal reactor implementation (`--reactor-backend`).
+    ///
+    /// Fails if `backend` is not available on this system or in this build
+    /// of Seastar.
+    ///
+    /// # Examples
+    ///
+    /// ```rust
+    /// use seastar::{Options, ReactorBackend};
+    ///
+    /// let mut opts = Options::new();
+    /// opts.set_reactor_backend(ReactorBackend::Epoll).unwrap();
+    ///
+    /// assert_eq!(opts.get_reactor_backend(), ReactorBackend::Epoll);
+    /// ```
+    pub fn set_reactor_backend(&mut self, backend: ReactorBackend) -> Result<(), OptionsError> {
+        set_reactor_backend(self.opts.pin_mut(), backend.name())
+            .map_err(|err| OptionsError(err.what().to_string()))
+    }
+
+    /// Gets whether the reactor polls continuously instead of sleeping when idle (`--poll-mode`).
+    pub fn get_poll_mode(&self) -> bool {
+        get_poll_mode(&self.opts)
+    }
+
+    /// Sets whether the reactor polls continuously instead of sleeping when idle (`--poll-mode`).
+    pub fn set_poll_mode(&mut self, poll_mode: bool) {
+        set_poll_mode(self.opts.pin_mut(), poll_mode);
+    }
+
+    /// Gets the idle polling time in microseconds before going to sleep (`--idle-poll-time-us`).
+    pub fn get_idle_poll_time_us(&self) -> u32 {
+        get_idle_poll_time_us(&self.opts)
+    }
+
+    /// Sets the idle polling time in microseconds before going to sleep (`--idle-poll-time-us`).
+    pub fn set_idle_poll_time_us(&mut self, idle_poll_time_us: u32) {
+        set_idle_poll_time_us(self.opts.pin_mut(), idle_poll_time_us);
+    }
+
+    /// Gets the CPUs to use (`--cpuset`).
+    ///
+    /// An empty set means that all available CPUs are used.
+    pub fn get_cpuset(&self) -> Vec<u32> {
+        get_cpuset(&self.opts)
+    }
+
+    /// Sets the CPUs to use (`--cpuset`).
+    ///
+    /// # Examples
+    ///
+    /// ```rust
+    /// use seastar::Options;
+    ///
+    /// let mut opts = Options::new();
+    /// opts.set_cpuset(&[2, 0]);
+    ///
+    /// assert_eq!(opts.get_cpuset(), vec![0, 2]);
+    /// ```
+    pub fn set_cpuset(&mut self, cpuset: &[u32]) {
+        set_cpuset(self.opts.pin_mut(), cpuset);
+    }
+
+    /// Gets whether shard threads are pinned to their CPUs (`--thread-affinity`).
+    pub fn get_thread_affinity(&self) -> bool {
+        get_thread_affinity(&self.opts)
+    }
+
+    /// Sets whether shard threads are pinned to their CPUs (`--thread-affinity`).
+    pub fn set_thread_affinity(&mut self, thread_affinity: bool) {
+        set_thread_affinity(self.opts.pin_mut(), thread_affinity);
+    }
+
+    /// Gets whether the machine is overprovisioned (`--overprovisioned`).
+    pub fn get_overprovisioned(&self) -> bool {
+        get_overprovisioned(&self.opts)
+    }
+
+    /// Sets whether the machine is overprovisioned (`--overprovisioned`).
+    ///
+    /// Overprovisioned mode reduces busy polling and disables thread affinity.
+    pub fn set_overprovisioned(&mut self, overprovisioned: bool) {
+        set_overprovisioned(self.opts.pin_mut(), overprovisioned);
+    }
+
+    /// Gets the path to the hugetlbfs mount (`--hugepages`).
+    ///
+    /// An empty path means that hugepages are not used.
+    pub fn get_hugepages(&self) -> &str {
+        get_hugepages(&self.opts)
+    }
+
+    /// Sets the path to the hugetlbfs mount to use hugepages (`--hugepages`).
+    pub fn set_hugepages(&mut self, path: &str) {
+        set_hugepages(self.opts.pin_mut(), path);
+    }
+
+    /// Gets the I/O properties, in YAML (`--io-properties`).
+    pub fn get_io_properties(&self) -> &str {
+        get_io_properties(&self.opts)
+    }
+
+    /// Sets the I/O properties, in YAML (`--io-properties`).
+    pub fn set_io_properties(&mut self, io_properties: &str) {
+        set_io_properties(self.opts.pin_mut(), io_properties);
+    }
+
+    /// Gets the path to the YAML file with I/O properties (`--io-properties-file`).
+    pub fn get_io_properties_file(&self) -> &str {
+        get_io_properties_file(&self.opts)
+    }
+
+    /// Sets the path to the YAML file with I/O properties (`--io-properties-file`).
+    pub fn set_io_properties_file(&mut self, path: &str) {
+        set_io_properties_file(self.opts.pin_mut(), path);
+    }
 }
 
 impl Default for Options {
@@ -186,10 +469,35 @@ impl Default for Options {
     }
 }
 
+/// How long the phases of the last run of an [`AppTemplate`] took
+/// (see [`AppTemplate::startup_timings`]).
+#[derive(Clone, Copy, Debug, Default, PartialEq, Eq)]
+pub struct StartupTimings {
+    /// Creating the app from its [`Options`].
+    pub app_creation: Duration,
+    /// From the call to `run_*` to the start of the app's future:
+    /// parsing the command line, setting up memory and starting the shards.
+    pub reactor_start: Duration,
+    /// Running the app's future.
+    pub main: Duration,
+    /// From the completion of the app's future to the return of `run_*`:
+    /// stopping the shards.
+    pub shutdown: Duration,
+}
+
+impl StartupTimings {
+    /// Returns the total time, from the creation of the app to the return of `run_*`.
+    pub fn total(&self) -> Duration {
+        self.app_creation + self.reactor_start + self.main + self.shutdown
+    }
+}
+
 /// The object through which the contents of a `main` function would be ran in a Seastar app.
 /// Configurable through [`Options`].
 pub struct AppTemplate {
     app: UniquePtr<app_template>,
+    app_creation: Duration,
+    timings: Option<StartupTimings>,
 }
 
 impl AppTemplate {
@@ -203,11 +511,33 @@ impl AppTemplate {
     /// let app = AppTemplate::new_from_options(Options::default());
     /// ```
     pub fn new_from_options(mut opts: Options) -> Self {
+        let start = Instant::now();
+        let app = new_app_template_from_options(opts.opts.pin_mut());
         AppTemplate {
-            app: new_app_template_from_options(opts.opts.pin_mut()),
+            app,
+            app_creation: start.elapsed(),
+            timings: None,
         }
     }
 
+    /// Returns how long the phases of the last run took, or `None` if the app
+    /// has not been run.
+    ///
+    /// # Examples
+    ///
+    /// ```rust
+    /// use seastar::AppTemplate;
+    ///
+    /// let mut app = AppTemplate::default();
+    /// app.launch_void(async { Ok(()) });
+    ///
+    /// let timings = app.startup_timings().unwrap();
+    /// eprintln!("reactor started in {:?}", timings.reactor_start);
+    /// ```
+    pub fn startup_timings(&self) -> Option<StartupTimings> {
+        self.timings
+    }
+
     /// Runs an app with a void callback (the output of which is always 0) and program arguments (argv).
     ///
     /// Currently, this function can only be called once in a single thread.
@@ -224,27 +554,48 @@ impl AppTemplate {
     ///
     /// assert_eq!(app.run_void(&args[..], fut), 0);
     /// ```
-    pub fn run_void<I, Arg>(
-        &mut self,
-        args: I,
-        fut: impl Future<Output = cxx_async::CxxAsyncResult<()>> + 'static,
-    ) -> i32
+    pub fn run_void<I, Arg, F>(&mut self, args: I, fut: F) -> i32
     where
         I: IntoIterator<Item = Arg>,
         Arg: Into<OsString>,
+        F: Future<Output = cxx_async::CxxAsyncResult<()>> + 'static,
     {
         let args = get_c_args(args);
         let argc = args.len() as i32;
         let mut args: Vec<_> = args.iter().map(|s| s.as_ptr() as *mut c_char).collect();
         args.push(std::ptr::null_mut());
-        unsafe {
+        let mut launch = Launch::new(fut);
+        let called = Instant::now();
+        let exit_value = unsafe {
             run_void(
                 self.app.pin_mut(),
                 argc,
                 args.as_mut_ptr(),
-                VoidFuture::fallible_local(fut),
+                &mut launch as *mut _ as *mut u8,
+                start_void::<F>,
             )
-        }
+        };
+        self.timings = Some(launch.timings(self.app_creation, called));
+        exit_value
+    }
+
+    /// Like [`run_void`](AppTemplate::run_void), without a command line:
+    /// the app is configured by its [`Options`] alone.
+    ///
+    /// # Examples
+    ///
+    /// ```rust
+    /// use seastar::{AppTemplate, Options};
+    ///
+    /// let mut app = AppTemplate::new_from_options(Options::fast_startup());
+    ///
+    /// assert_eq!(app.launch_void(async { Ok(()) }), 0);
+    /// ```
+    pub fn launch_void<F>(&mut self, fut: F) -> i32
+    where
+        F: Future<Output = cxx_async::CxxAsyncResult<()>> + 'static,
+    {
+        self.run_void(program_name(), fut)
     }
 
     /// Runs an app with an int (status code) callback and program arguments (argv).
@@ -263,30 +614,113 @@ impl AppTemplate {
     ///
     /// assert_eq!(app.run_int(&args[..], fut), 42);
     /// ```
-    pub fn run_int<I, Arg>(
-        &mut self,
-        args: I,
-        fut: impl Future<Output = cxx_async::CxxAsyncResult<i32>> + 'static,
-    ) -> i32
+    pub fn run_int<I, Arg, F>(&mut self, args: I, fut: F) -> i32
     where
         I: IntoIterator<Item = Arg>,
         Arg: Into<OsString>,
+        F: Future<Output = cxx_async::CxxAsyncResult<i32>> + 'static,
     {
         let args = get_c_args(args);
         let argc = args.len() as i32;
         let mut args: Vec<_> = args.iter().map(|s| s.as_ptr() as *mut c_char).collect();
         args.push(std::ptr::null_mut());
-        unsafe {
+        let mut launch = Launch::new(fut);
+        let called = Instant::now();
+        let exit_value = unsafe {
             run_int(
                 self.app.pin_mut(),
                 argc,
                 args.as_mut_ptr(),
-                IntFuture::fallible_local(fut),
+                &mut launch as *mut _ as *mut u8,
+                start_int::<F>,
             )
+        };
+        self.timings = Some(launch.timings(self.app_creation, called));
+        exit_value
+    }
+
+    /// Like [`run_int`](AppTemplate::run_int), without a command line:
+    /// the app is configured by its [`Options`] alone.
+    pub fn launch_int<F>(&mut self, fut: F) -> i32
+    where
+        F: Future<Output = cxx_async::CxxAsyncResult<i32>> + 'static,
+    {
+        self.run_int(program_name(), fut)
+    }
+}
+
+/// The app's future, handed to the starter by `run_void` and `run_int`,
+/// with the timestamps of its start and completion.
+struct Launch<F> {
+    fut: Option<F>,
+    started: Option<Instant>,
+    finished: Rc<Cell<Option<Instant>>>,
+}
+
+impl<F: Future + 'static> Launch<F> {
+    fn new(fut: F) -> Self {
+        Launch {
+            fut: Some(fut),
+            started: None,
+            finished: Rc::new(Cell::new(None)),
+        }
+    }
+
+    /// Takes the future out, wrapped to record its completion.
+    ///
+    /// Shard 0 runs on the thread that called `run_*`, so the completion time
+    /// can be shared through an `Rc`.
+    fn start(&mut self) -> impl Future<Output = F::Output> + 'static {
+        self.started = Some(Instant::now());
+        let fut = self.fut.take().unwrap();
+        let finished = self.finished.clone();
+        async move {
+            let output = fut.await;
+            finished.set(Some(Instant::now()));
+            output
+        }
+    }
+
+    /// Called once `run_*` has returned. The phases that did not happen
+    /// (e.g. because the command line was invalid) take no time.
+    fn timings(&self, app_creation: Duration, called: Instant) -> StartupTimings {
+        let returned = Instant::now();
+        let started = self.started.unwrap_or(returned);
+        let finished = self.finished.get().unwrap_or(returned);
+        StartupTimings {
+            app_creation,
+            reactor_start: started - called,
+            main: finished.saturating_duration_since(started),
+            shutdown: returned - finished.max(started),
         }
     }
 }
 
+/// Called by `run_void` once the runtime has started: takes the future
+/// out of `launch`, a [`Launch`] on the caller's stack, and starts it on shard 0.
+unsafe fn start_void<F>(launch: *mut u8) -> VoidFuture
+where
+    F: Future<Output = cxx_async::CxxAsyncResult<()>> + 'static,
+{
+    let fut = (*(launch as *mut Launch<F>)).start();
+    VoidFuture::fallible_local(fut)
+}
+
+/// Like `start_void`, for `run_int`.
+unsafe fn start_int<F>(launch: *mut u8) -> IntFuture
+where
+    F: Future<Output = cxx_async::CxxAsyncResult<i32>> + 'static,
+{
+    let fut = (*(launch as *mut Launch<F>)).start();
+    IntFuture::fallible_local(fut)
+}
+
+/// The command line of `launch_void` and `launch_int`: only the program name,
+/// which Seastar expects in `argv[0]`.
+fn program_name() -> impl Iterator<Item = OsString> {
+    std::env::args_os().take(1)
+}
+
 impl Default for AppTemplate {
     fn default() -> Self {
         AppTemplate::new_from_options(Options::default())
@@ -349,6 +783,57 @@ mod tests {
         assert_eq!(opts.get_smp(), smp);
     }
 
+    #[test]
+    fn test_set_get_memory() {
+        let mut opts = Options::new();
+        assert_eq!(opts.get_memory(), None);
+        opts.set_memory(1 << 30);
+        assert_eq!(opts.get_memory(), Some(1 << 30));
+        assert_eq!(opts.get_reserve_memory(), None);
+        opts.set_reserve_memory(1 << 20);
+        assert_eq!(opts.get_reserve_memory(), Some(1 << 20));
+    }
+
+    #[test]
+    fn test_set_get_reactor_options() {
+        let mut opts = Options::new();
+        opts.set_task_quota_ms(0.25);
+        assert_eq!(opts.get_task_quota_ms(), 0.25);
+        // The default backend is available wherever the tests run.
+        let backend = opts.get_reactor_backend();
+        assert!(!matches!(backend, ReactorBackend::Unknown(_)));
+        opts.set_reactor_backend(backend.clone()).unwrap();
+        assert_eq!(opts.get_reactor_backend(), backend);
+        assert!(opts
+            .set_reactor_backend(ReactorBackend::Unknown("no-such-backend".to_string()))
+            .is_err());
+        assert!(!opts.get_poll_mode());
+        opts.set_poll_mode(true);
+        assert!(opts.get_poll_mode());
+        opts.set_idle_poll_time_us(42);
+        assert_eq!(opts.get_idle_poll_time_us(), 42);
+        assert!(!opts.get_overprovisioned());
+        opts.set_overprovisioned(true);
+        assert!(opts.get_overprovisioned());
+    }
+
+    #[test]
+    fn test_set_get_smp_options() {
+        let mut opts = Options::new();
+        assert!(opts.get_cpuset().is_empty());
+        opts.set_cpuset(&[3, 1]);
+        assert_eq!(opts.get_cpuset(), vec![1, 3]);
+        opts.set_thread_affinity(false);
+        assert!(!opts.get_thread_affinity());
+        assert_eq!(opts.get_hugepages(), "");
+        opts.set_hugepages("/mnt/huge");
+        assert_eq!(opts.get_hugepages(), "/mnt/huge");
+        opts.set_io_properties("disks: []");
+        assert_eq!(opts.get_io_properties(), "disks: []");
+        opts.set_io_properties_file("/etc/io.yaml");
+        assert_eq!(opts.get_io_properties_file(), "/etc/io.yaml");
+    }
+
     #[test]
     fn test_new_app_template_from_options_gets_created() {
         let mut opts = Options::default();
@@ -384,6 +869,37 @@ mod tests {
         .unwrap();
     }
 
+    #[test]
+    fn test_fast_startup_options() {
+        let opts = Options::fast_startup();
+        assert!(opts.get_overprovisioned());
+        assert!(!opts.get_thread_affinity());
+        assert!(!opts.get_poll_mode());
+        assert_eq!(opts.get_io_properties(), "");
+        assert_eq!(opts.get_io_properties_file(), "");
+    }
+
+    #[test]
+    fn test_launch_records_startup_timings() {
+        thread::spawn(|| {
+            let _guard = crate::acquire_guard_for_seastar_test();
+            let mut opts = Options::fast_startup();
+            opts.set_smp(2);
+            let mut app = AppTemplate::new_from_options(opts);
+            assert_eq!(app.startup_timings(), None);
+            let fut = async {
+                crate::sleep(Duration::from_millis(20)).await;
+                Ok(42)
+            };
+            assert_eq!(app.launch_int(fut), 42);
+            let timings = app.startup_timings().unwrap();
+            assert!(timings.main >= Duration::from_millis(20));
+            assert!(timings.total() >= timings.reactor_start + timings.main);
+        })
+        .join()
+        .unwrap();
+    }
+
     // Note: this is not a test case that is supposed to be run. It is only
     // supposed to verify that run_void and run_int work with std::env::args().
     // and std::env::args_os().
@@ -7,3 +7,4 @@
 
 CXXASYNC_DEFINE_FUTURE(void, seastar_ffi, VoidFuture);
 CXXASYNC_DEFINE_FUTURE(int, seastar_ffi, IntFuture);
+CXXASYNC_DEFINE_FUTURE(size_t, seastar_ffi, SizeFuture);
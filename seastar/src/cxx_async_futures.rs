@@ -9,3 +9,8 @@ unsafe impl Future for VoidFuture {
 unsafe impl Future for IntFuture {
     type Output = i32;
 }
+
+#[cxx_async::bridge(namespace = seastar_ffi)]
+unsafe impl Future for SizeFuture {
+    type Output = usize;
+}
@@ -3,38 +3,89 @@ use std::pin::Pin;
 use std::task::{Context, Poll};
 
 use cxx_async::{CxxAsyncResult, IntoCxxAsyncFuture};
-use pin_project::pin_project;
 
-#[pin_project]
-struct LocalFuture<F>(#[pin] F);
+use crate::spawn::{new_task_in, JoinHandle};
 
-impl<F> Future for LocalFuture<F>
-where
-    F: Future,
-{
+/// A task of the current shard, awaited from C++ (see [`spawn_local`]).
+///
+/// Dropping it before the task completes cancels the task.
+struct LocalTask<F: Future> {
+    handle: JoinHandle<F>,
+}
+
+// cxx-async only bridges `Send` futures, but polls and drops them on the
+// thread of the C++ coroutine awaiting them, which is the home shard of the
+// task. The task itself only ever wakes this future from there. Both are
+// checked, so that the handle never leaves its shard.
+unsafe impl<F: Future> Send for LocalTask<F> {}
+
+impl<F: Future> Future for LocalTask<F> {
     type Output = F::Output;
 
-    fn poll(self: Pin<&mut Self>, cx: &mut Context<'_>) -> Poll<Self::Output> {
-        self.project().0.poll(cx)
+    fn poll(self: Pin<&mut Self>, cx: &mut Context<'_>) -> Poll<F::Output> {
+        assert!(
+            self.handle.is_home(),
+            "Local future polled on another shard"
+        );
+        Pin::new(&mut self.get_mut().handle).poll(cx)
     }
 }
 
-unsafe impl<F> Send for LocalFuture<F> {}
+impl<F: Future> Drop for LocalTask<F> {
+    fn drop(&mut self) {
+        assert!(
+            self.handle.is_home(),
+            "Local future dropped on another shard"
+        );
+        self.handle.cancel();
+    }
+}
 
-pub(crate) trait IntoCxxAsyncLocalFuture: IntoCxxAsyncFuture {
+/// Drives `future` in a task of its own on the current shard and returns
+/// a `Send` future resolving to its output.
+///
+/// The task is polled by the Seastar scheduler and woken by the shard-local
+/// waker from spawn.rs, which reschedules the task in place. Only the final
+/// completion goes through the thread-safe waker of cxx-async, instead of
+/// every wakeup of the future. The output is handed over in the task block,
+/// without another allocation.
+fn spawn_local<Fut>(future: Fut) -> impl Future<Output = Fut::Output> + Send
+where
+    Fut: Future + 'static,
+    Fut::Output: Send + 'static,
+{
+    LocalTask {
+        handle: JoinHandle::new(new_task_in(future, true, None, None)),
+    }
+}
+
+/// Conversion of shard-local (not `Send`) Rust futures into futures
+/// awaitable from C++.
+///
+/// Must be called on a shard of a running Seastar runtime; the future runs
+/// on that shard.
+pub(crate) trait IntoCxxAsyncLocalFuture: IntoCxxAsyncFuture
+where
+    Self::Output: Send + 'static,
+{
     fn infallible_local<Fut>(future: Fut) -> Self
     where
         Fut: Future<Output = Self::Output> + 'static,
     {
-        Self::infallible(LocalFuture(future))
+        Self::infallible(spawn_local(future))
     }
 
     fn fallible_local<Fut>(future: Fut) -> Self
     where
         Fut: Future<Output = CxxAsyncResult<Self::Output>> + 'static,
     {
-        Self::fallible(LocalFuture(future))
+        Self::fallible(spawn_local(future))
     }
 }
 
-impl<F> IntoCxxAsyncLocalFuture for F where F: IntoCxxAsyncFuture {}
+impl<F> IntoCxxAsyncLocalFuture for F
+where
+    F: IntoCxxAsyncFuture,
+    F::Output: Send + 'static,
+{
+}
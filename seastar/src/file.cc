@@ -0,0 +1,79 @@
+#include "file.hh"
+#include <seastar/core/seastar.hh>
+
+namespace seastar_ffi {
+namespace file {
+
+static seastar::open_flags to_open_flags(uint32_t flags) {
+    using seastar::open_flags;
+    auto ret = open_flags{};
+    if (flags & flag_ro) { ret = ret | open_flags::ro; }
+    if (flags & flag_wo) { ret = ret | open_flags::wo; }
+    if (flags & flag_rw) { ret = ret | open_flags::rw; }
+    if (flags & flag_create) { ret = ret | open_flags::create; }
+    if (flags & flag_truncate) { ret = ret | open_flags::truncate; }
+    if (flags & flag_exclusive) { ret = ret | open_flags::exclusive; }
+    if (flags & flag_dsync) { ret = ret | open_flags::dsync; }
+    return ret;
+}
+
+std::shared_ptr<file> new_file() {
+    return std::make_shared<file>();
+}
+
+VoidFuture open_file_dma(const std::shared_ptr<file>& dst, rust::Str name, uint32_t flags) {
+    auto d = dst;
+    *d = co_await seastar::open_file_dma(std::string_view(name.data(), name.size()), to_open_flags(flags));
+}
+
+SizeFuture dma_read(const std::shared_ptr<file>& f, uint64_t pos, const std::unique_ptr<buffer>& buf) {
+    auto fc = *f;
+    auto held = buf->share();
+    co_return co_await fc.dma_read(pos, held.get_write(), held.size());
+}
+
+SizeFuture dma_write(const std::shared_ptr<file>& f, uint64_t pos, const std::unique_ptr<buffer>& buf) {
+    auto fc = *f;
+    auto held = buf->share();
+    co_return co_await fc.dma_write(pos, held.get(), held.size());
+}
+
+VoidFuture flush(const std::shared_ptr<file>& f) {
+    auto fc = *f;
+    co_await fc.flush();
+}
+
+VoidFuture truncate(const std::shared_ptr<file>& f, uint64_t length) {
+    auto fc = *f;
+    co_await fc.truncate(length);
+}
+
+VoidFuture allocate(const std::shared_ptr<file>& f, uint64_t position, uint64_t length) {
+    auto fc = *f;
+    co_await fc.allocate(position, length);
+}
+
+SizeFuture size(const std::shared_ptr<file>& f) {
+    auto fc = *f;
+    co_return co_await fc.size();
+}
+
+VoidFuture close(const std::shared_ptr<file>& f) {
+    auto fc = *f;
+    co_await fc.close();
+}
+
+uint64_t memory_dma_alignment(const std::shared_ptr<file>& f) {
+    return f->memory_dma_alignment();
+}
+
+uint64_t disk_read_dma_alignment(const std::shared_ptr<file>& f) {
+    return f->disk_read_dma_alignment();
+}
+
+uint64_t disk_write_dma_alignment(const std::shared_ptr<file>& f) {
+    return f->disk_write_dma_alignment();
+}
+
+} // namespace file
+} // namespace seastar_ffi
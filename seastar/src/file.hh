@@ -0,0 +1,50 @@
+#pragma once
+
+#include "cxx_async_futures.hh"
+#include "temporary_buffer.hh"
+#include <seastar/core/file.hh>
+
+namespace seastar_ffi {
+namespace file {
+
+using file = seastar::file;
+using buffer = seastar_ffi::temporary_buffer::buffer;
+
+// Must match the flags in file.rs.
+constexpr uint32_t flag_ro = 1 << 0;
+constexpr uint32_t flag_wo = 1 << 1;
+constexpr uint32_t flag_rw = 1 << 2;
+constexpr uint32_t flag_create = 1 << 3;
+constexpr uint32_t flag_truncate = 1 << 4;
+constexpr uint32_t flag_exclusive = 1 << 5;
+constexpr uint32_t flag_dsync = 1 << 6;
+
+std::shared_ptr<file> new_file();
+
+// All asynchronous functions below copy the file handle (and share the buffer)
+// before suspending, so they are safe to abandon on the Rust side.
+
+VoidFuture open_file_dma(const std::shared_ptr<file>& dst, rust::Str name, uint32_t flags);
+
+SizeFuture dma_read(const std::shared_ptr<file>& f, uint64_t pos, const std::unique_ptr<buffer>& buf);
+
+SizeFuture dma_write(const std::shared_ptr<file>& f, uint64_t pos, const std::unique_ptr<buffer>& buf);
+
+VoidFuture flush(const std::shared_ptr<file>& f);
+
+VoidFuture truncate(const std::shared_ptr<file>& f, uint64_t length);
+
+VoidFuture allocate(const std::shared_ptr<file>& f, uint64_t position, uint64_t length);
+
+SizeFuture size(const std::shared_ptr<file>& f);
+
+VoidFuture close(const std::shared_ptr<file>& f);
+
+uint64_t memory_dma_alignment(const std::shared_ptr<file>& f);
+
+uint64_t disk_read_dma_alignment(const std::shared_ptr<file>& f);
+
+uint64_t disk_write_dma_alignment(const std::shared_ptr<file>& f);
+
+} // namespace file
+} // namespace seastar_ffi
@@ -0,0 +1,255 @@
+use crate::TemporaryBuffer;
+use cxx::SharedPtr;
+use std::ops::BitOr;
+use thiserror::Error;
+
+#[cxx::bridge]
+mod ffi {
+    #[namespace = "seastar_ffi"]
+    unsafe extern "C++" {
+        type VoidFuture = crate::cxx_async_futures::VoidFuture;
+        type SizeFuture = crate::cxx_async_futures::SizeFuture;
+    }
+
+    #[namespace = "seastar_ffi::temporary_buffer"]
+    unsafe extern "C++" {
+        type buffer = crate::temporary_buffer::buffer;
+    }
+
+    #[namespace = "seastar_ffi::file"]
+    unsafe extern "C++" {
+        include!("seastar/src/file.hh");
+
+        type file;
+
+        fn new_file() -> SharedPtr<file>;
+        fn open_file_dma(dst: &SharedPtr<file>, name: &str, flags: u32) -> VoidFuture;
+        fn dma_read(f: &SharedPtr<file>, pos: u64, buf: &UniquePtr<buffer>) -> SizeFuture;
+        fn dma_write(f: &SharedPtr<file>, pos: u64, buf: &UniquePtr<buffer>) -> SizeFuture;
+        fn flush(f: &SharedPtr<file>) -> VoidFuture;
+        fn truncate(f: &SharedPtr<file>, length: u64) -> VoidFuture;
+        fn allocate(f: &SharedPtr<file>, position: u64, length: u64) -> VoidFuture;
+        fn size(f: &SharedPtr<file>) -> SizeFuture;
+        fn close(f: &SharedPtr<file>) -> VoidFuture;
+        fn memory_dma_alignment(f: &SharedPtr<file>) -> u64;
+        fn disk_read_dma_alignment(f: &SharedPtr<file>) -> u64;
+        fn disk_write_dma_alignment(f: &SharedPtr<file>) -> u64;
+    }
+}
+
+/// Error returned when a file operation fails.
+#[derive(Error, Debug)]
+#[error("FileError: {0}")]
+pub struct FileError(String);
+
+fn file_error(err: cxx_async::CxxAsyncException) -> FileError {
+    FileError(err.what().to_string())
+}
+
+/// Flags for [`open_file_dma`], combined with `|`.
+#[derive(Clone, Copy, Debug, PartialEq, Eq)]
+pub struct OpenFlags(u32);
+
+// Must match the flags in file.hh.
+impl OpenFlags {
+    /// Open for reading only.
+    pub const RO: OpenFlags = OpenFlags(1 << 0);
+    /// Open for writing only.
+    pub const WO: OpenFlags = OpenFlags(1 << 1);
+    /// Open for reading and writing.
+    pub const RW: OpenFlags = OpenFlags(1 << 2);
+    /// Create the file if it does not exist.
+    pub const CREATE: OpenFlags = OpenFlags(1 << 3);
+    /// Truncate the file to zero length.
+    pub const TRUNCATE: OpenFlags = OpenFlags(1 << 4);
+    /// Fail if the file already exists (together with [`CREATE`](OpenFlags::CREATE)).
+    pub const EXCLUSIVE: OpenFlags = OpenFlags(1 << 5);
+    /// Complete writes only once the data is on stable storage.
+    pub const DSYNC: OpenFlags = OpenFlags(1 << 6);
+}
+
+impl BitOr for OpenFlags {
+    type Output = OpenFlags;
+
+    fn bitor(self, rhs: OpenFlags) -> OpenFlags {
+        OpenFlags(self.0 | rhs.0)
+    }
+}
+
+/// A data file on persistent storage, opened for direct I/O (`O_DIRECT`).
+///
+/// Reads and writes bypass the page cache and go straight between the disk
+/// and a [`TemporaryBuffer`], without copying the data across the FFI.
+/// Positions, lengths and buffer addresses must be aligned, see
+/// [`disk_read_dma_alignment`](File::disk_read_dma_alignment),
+/// [`disk_write_dma_alignment`](File::disk_write_dma_alignment) and
+/// [`memory_dma_alignment`](File::memory_dma_alignment).
+///
+/// Buffers are passed by value and handed back together with the result,
+/// so they cannot be touched while the disk is working on them.
+///
+/// I/O is accounted to the scheduling group of the task issuing it
+/// (see [`spawn_in`](crate::spawn_in)), which selects its I/O priority class.
+///
+/// A file should be [`close`](File::close)d before it is dropped.
+///
+/// # Example
+///
+/// ```rust
+/// #[seastar::test]
+/// async fn file_example() {
+///     let file = open_file_dma("data", OpenFlags::RW | OpenFlags::CREATE).await.unwrap();
+///     let mut buf = allocate_aligned_buffer(4096, file.memory_dma_alignment() as usize);
+///     buf.fill(b'x');
+///     let (written, _buf) = file.dma_write(0, buf).await;
+///     assert_eq!(written.unwrap(), 4096);
+///     file.close().await.unwrap();
+/// }
+/// ```
+pub struct File {
+    inner: SharedPtr<ffi::file>,
+}
+
+/// Opens (or creates) the file `name` for direct I/O.
+pub async fn open_file_dma(name: &str, flags: OpenFlags) -> Result<File, FileError> {
+    crate::assert_runtime_is_running();
+    let inner = ffi::new_file();
+    ffi::open_file_dma(&inner, name, flags.0)
+        .await
+        .map_err(file_error)?;
+    Ok(File { inner })
+}
+
+impl File {
+    /// Reads into `buf` from position `pos`, filling it as much as possible.
+    ///
+    /// Returns the number of bytes read, which is smaller than the length
+    /// of the buffer only at the end of the file, together with the buffer.
+    ///
+    /// Panics if `buf` is shared, as the read overwrites its contents.
+    pub async fn dma_read(
+        &self,
+        pos: u64,
+        buf: TemporaryBuffer,
+    ) -> (Result<usize, FileError>, TemporaryBuffer) {
+        assert!(!buf.is_shared(), "Reading into a shared buffer");
+        let ret = ffi::dma_read(&self.inner, pos, buf.as_cpp()).await;
+        (ret.map_err(file_error), buf)
+    }
+
+    /// Writes the contents of `buf` at position `pos`.
+    ///
+    /// Returns the number of bytes written, together with the buffer.
+    pub async fn dma_write(
+        &self,
+        pos: u64,
+        buf: TemporaryBuffer,
+    ) -> (Result<usize, FileError>, TemporaryBuffer) {
+        let ret = ffi::dma_write(&self.inner, pos, buf.as_cpp()).await;
+        (ret.map_err(file_error), buf)
+    }
+
+    /// Makes sure that all completed writes are on stable storage.
+    pub async fn flush(&self) -> Result<(), FileError> {
+        ffi::flush(&self.inner).await.map_err(file_error)
+    }
+
+    /// Changes the size of the file to `length` bytes.
+    pub async fn truncate(&self, length: u64) -> Result<(), FileError> {
+        ffi::truncate(&self.inner, length).await.map_err(file_error)
+    }
+
+    /// Preallocates disk space for `length` bytes at `position` (`fallocate`),
+    /// without changing the size of the file.
+    ///
+    /// Avoids metadata updates while later writes fill the range.
+    pub async fn allocate(&self, position: u64, length: u64) -> Result<(), FileError> {
+        ffi::allocate(&self.inner, position, length)
+            .await
+            .map_err(file_error)
+    }
+
+    /// Returns the size of the file.
+    pub async fn size(&self) -> Result<u64, FileError> {
+        match ffi::size(&self.inner).await {
+            Ok(size) => Ok(size as u64),
+            Err(err) => Err(file_error(err)),
+        }
+    }
+
+    /// Closes the file, waiting for background operations to finish.
+    pub async fn close(self) -> Result<(), FileError> {
+        ffi::close(&self.inner).await.map_err(file_error)
+    }
+
+    /// Alignment required for the addresses of buffers.
+    pub fn memory_dma_alignment(&self) -> u64 {
+        ffi::memory_dma_alignment(&self.inner)
+    }
+
+    /// Alignment required for read positions and lengths.
+    pub fn disk_read_dma_alignment(&self) -> u64 {
+        ffi::disk_read_dma_alignment(&self.inner)
+    }
+
+    /// Alignment required for write positions and lengths.
+    pub fn disk_write_dma_alignment(&self) -> u64 {
+        ffi::disk_write_dma_alignment(&self.inner)
+    }
+}
+
+#[cfg(test)]
+mod tests {
+    use super::*;
+    use crate as seastar;
+    use crate::allocate_aligned_buffer;
+
+    fn test_path(name: &str) -> String {
+        std::env::temp_dir()
+            .join(format!("seastar_rs_{}_{}", name, std::process::id()))
+            .to_str()
+            .unwrap()
+            .to_string()
+    }
+
+    #[seastar::test]
+    async fn test_file_write_read() {
+        let path = test_path("write_read");
+        let flags = OpenFlags::RW | OpenFlags::CREATE | OpenFlags::TRUNCATE;
+        let file = open_file_dma(&path, flags).await.unwrap();
+        let align = file.memory_dma_alignment() as usize;
+
+        let mut buf = allocate_aligned_buffer(4096, align);
+        buf.fill(b'x');
+        let (written, _) = file.dma_write(0, buf).await;
+        assert_eq!(written.unwrap(), 4096);
+        file.flush().await.unwrap();
+        assert_eq!(file.size().await.unwrap(), 4096);
+
+        let (read, buf) = file.dma_read(0, allocate_aligned_buffer(8192, align)).await;
+        assert_eq!(read.unwrap(), 4096);
+        assert!(buf[..4096].iter().all(|&b| b == b'x'));
+
+        file.close().await.unwrap();
+        std::fs::remove_file(&path).unwrap();
+    }
+
+    #[seastar::test]
+    async fn test_file_truncate_allocate() {
+        let path = test_path("truncate_allocate");
+        let flags = OpenFlags::RW | OpenFlags::CREATE | OpenFlags::TRUNCATE;
+        let file = open_file_dma(&path, flags).await.unwrap();
+        file.allocate(0, 1 << 20).await.unwrap();
+        assert_eq!(file.size().await.unwrap(), 0);
+        file.truncate(8192).await.unwrap();
+        assert_eq!(file.size().await.unwrap(), 8192);
+        file.close().await.unwrap();
+        std::fs::remove_file(&path).unwrap();
+    }
+
+    #[seastar::test]
+    async fn test_open_missing_file() {
+        let ret = open_file_dma(&test_path("missing"), OpenFlags::RO).await;
+        assert!(ret.is_err());
+    }
+}
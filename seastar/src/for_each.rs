@@ -0,0 +1,340 @@
+//! Concurrent loops over the items of an iterator
+//! (`seastar::parallel_for_each` and `seastar::max_concurrent_for_each`).
+//!
+//! Both loops poll the future of every item as soon as it is created. The
+//! futures that complete right away, which is the common case (e.g. for cache
+//! hits), are dropped on the spot, and the next item reuses their storage.
+//! Only the futures that are still pending take up a slot, so memory is
+//! allocated in proportion to the number of items in flight at once, not to
+//! the number of items.
+//!
+//! Starting new items yields to the scheduler whenever the time quota has run
+//! out (see [`need_preempt`]).
+
+use crate::spawn::current_thread;
+use crate::{need_preempt, spawn_detached, submit_to, this_shard_id};
+use futures::task::{waker_ref, ArcWake};
+use std::cell::{Cell, RefCell};
+use std::future::Future;
+use std::pin::Pin;
+use std::sync::Arc;
+use std::task::{Context, Poll, Waker};
+
+/// The number of futures stored in a single allocation.
+const CHUNK_SIZE: usize = 32;
+
+/// The slots whose futures have been woken up, and the waker of the loop.
+#[derive(Default)]
+struct ReadyQueue {
+    slots: RefCell<Vec<usize>>,
+    waker: Cell<Option<Waker>>,
+}
+
+/// The waker of the futures in a given slot. It is allocated once per slot,
+/// and reused by all the futures stored there.
+///
+/// Only the reference count is atomic: the ready queue is only touched on
+/// the thread running the loop, and wakes from other threads are forwarded
+/// to its shard.
+struct SlotWaker {
+    slot: usize,
+    queued: Cell<bool>,
+    ready: Arc<ReadyQueue>,
+    home_thread: usize,
+    home_shard: u32,
+}
+
+// The cells are only accessed on the home thread (see `wake_by_ref`).
+unsafe impl Send for SlotWaker {}
+unsafe impl Sync for SlotWaker {}
+
+impl SlotWaker {
+    fn wake_at_home(&self) {
+        if !self.queued.replace(true) {
+            self.ready.slots.borrow_mut().push(self.slot);
+            if let Some(waker) = self.ready.waker.take() {
+                waker.wake();
+            }
+        }
+    }
+}
+
+impl ArcWake for SlotWaker {
+    fn wake_by_ref(arc_self: &Arc<Self>) {
+        if arc_self.home_thread == current_thread() {
+            arc_self.wake_at_home();
+        } else {
+            let waker = arc_self.clone();
+            spawn_detached(submit_to(arc_self.home_shard, move || async move {
+                waker.wake_at_home();
+            }));
+        }
+    }
+}
+
+struct ForEach<I, Func, Fut> {
+    iter: I,
+    exhausted: bool,
+    func: Func,
+    limit: usize,
+    active: usize,
+    // The futures never move: they are polled in place, in boxed chunks.
+    chunks: Vec<Pin<Box<[Option<Fut>]>>>,
+    wakers: Vec<Arc<SlotWaker>>,
+    free: Vec<usize>,
+    ready: Arc<ReadyQueue>,
+    // Swapped with `ready.slots`, to reuse both buffers.
+    woken: Vec<usize>,
+}
+
+// The futures are pinned in their chunks, and nothing else is ever pinned.
+impl<I, Func, Fut> Unpin for ForEach<I, Func, Fut> {}
+
+fn slot_in<Fut>(chunks: &mut [Pin<Box<[Option<Fut>]>>], slot: usize) -> Pin<&mut Option<Fut>> {
+    let chunk = chunks[slot / CHUNK_SIZE].as_mut();
+    // SAFETY: the chunks are never moved out of their boxes, and
+    // neither are their elements.
+    unsafe { chunk.map_unchecked_mut(|chunk| &mut chunk[slot % CHUNK_SIZE]) }
+}
+
+impl<I, Func, Fut> ForEach<I, Func, Fut>
+where
+    I: Iterator,
+    Func: FnMut(I::Item) -> Fut,
+    Fut: Future<Output = ()>,
+{
+    fn new(iter: I, limit: usize, func: Func) -> Self {
+        ForEach {
+            iter,
+            exhausted: false,
+            func,
+            limit,
+            active: 0,
+            chunks: Vec::new(),
+            wakers: Vec::new(),
+            free: Vec::new(),
+            ready: Arc::new(ReadyQueue::default()),
+            woken: Vec::new(),
+        }
+    }
+
+    fn alloc_slot(&mut self) -> usize {
+        if let Some(slot) = self.free.pop() {
+            return slot;
+        }
+        let slot = self.wakers.len();
+        if slot % CHUNK_SIZE == 0 {
+            let chunk: Box<[Option<Fut>]> = (0..CHUNK_SIZE).map(|_| None).collect();
+            self.chunks.push(Box::into_pin(chunk));
+        }
+        self.wakers.push(Arc::new(SlotWaker {
+            slot,
+            queued: Cell::new(false),
+            ready: self.ready.clone(),
+            home_thread: current_thread(),
+            home_shard: this_shard_id(),
+        }));
+        slot
+    }
+
+    /// Polls the future in `slot`, if any, and frees the slot if it completes.
+    fn poll_slot(&mut self, slot: usize) {
+        let waker = waker_ref(&self.wakers[slot]);
+        let mut cx = Context::from_waker(&waker);
+        let mut future = slot_in(&mut self.chunks, slot);
+        let Some(pending) = future.as_mut().as_pin_mut() else {
+            return;
+        };
+        if pending.poll(&mut cx).is_ready() {
+            future.set(None);
+            self.active -= 1;
+            self.free.push(slot);
+        }
+    }
+}
+
+impl<I, Func, Fut> Future for ForEach<I, Func, Fut>
+where
+    I: Iterator,
+    Func: FnMut(I::Item) -> Fut,
+    Fut: Future<Output = ()>,
+{
+    type Output = ();
+
+    fn poll(self: Pin<&mut Self>, cx: &mut Context<'_>) -> Poll<()> {
+        let this = self.get_mut();
+        match this.ready.waker.take() {
+            Some(waker) if waker.will_wake(cx.waker()) => this.ready.waker.set(Some(waker)),
+            _ => this.ready.waker.set(Some(cx.waker().clone())),
+        }
+
+        std::mem::swap(&mut this.woken, &mut *this.ready.slots.borrow_mut());
+        let mut woken = std::mem::take(&mut this.woken);
+        for &slot in &woken {
+            this.wakers[slot].queued.set(false);
+            this.poll_slot(slot);
+        }
+        woken.clear();
+        this.woken = woken;
+
+        let mut started = 0;
+        while !this.exhausted && this.active < this.limit {
+            if started > 0 && need_preempt() {
+                cx.waker().wake_by_ref();
+                return Poll::Pending;
+            }
+            let Some(item) = this.iter.next() else {
+                this.exhausted = true;
+                break;
+            };
+            started += 1;
+            let slot = this.alloc_slot();
+            let future = (this.func)(item);
+            slot_in(&mut this.chunks, slot).set(Some(future));
+            this.active += 1;
+            this.poll_slot(slot);
+        }
+
+        if this.exhausted && this.active == 0 {
+            Poll::Ready(())
+        } else {
+            Poll::Pending
+        }
+    }
+}
+
+/// Runs `func` on all the items of `iter` concurrently, and waits for all of
+/// them to complete.
+///
+/// All the futures are started right away; see
+/// [`max_concurrent_for_each`] to limit how many of them run at once.
+///
+/// # Example
+///
+/// ```rust
+/// #[seastar::test]
+/// async fn parallel_for_each_example() {
+///     let sum = Cell::new(0);
+///     parallel_for_each(1..=3, |i| {
+///         let sum = &sum;
+///         async move {
+///             sleep(Duration::from_millis(i)).await;
+///             sum.set(sum.get() + i);
+///         }
+///     })
+///     .await;
+///     assert_eq!(sum.get(), 6);
+/// }
+/// ```
+pub fn parallel_for_each<I, Func, Fut>(iter: I, func: Func) -> impl Future<Output = ()>
+where
+    I: IntoIterator,
+    Func: FnMut(I::Item) -> Fut,
+    Fut: Future<Output = ()>,
+{
+    ForEach::new(iter.into_iter(), usize::MAX, func)
+}
+
+/// Runs `func` on all the items of `iter`, with at most `limit` of the
+/// resulting futures running at a time, and waits for all of them to complete.
+///
+/// Items are started in order, whenever one of the running futures completes.
+///
+/// Panics if `limit` is 0.
+pub fn max_concurrent_for_each<I, Func, Fut>(
+    iter: I,
+    limit: usize,
+    func: Func,
+) -> impl Future<Output = ()>
+where
+    I: IntoIterator,
+    Func: FnMut(I::Item) -> Fut,
+    Fut: Future<Output = ()>,
+{
+    assert!(limit > 0, "max_concurrent_for_each limit must be positive");
+    ForEach::new(iter.into_iter(), limit, func)
+}
+
+#[cfg(test)]
+mod tests {
+    use super::*;
+    use crate as seastar;
+    use crate::allocator::counting::allocations;
+    use crate::{sleep, yield_now};
+    use std::cell::Cell;
+    use std::time::Duration;
+
+    #[seastar::test(shared)]
+    async fn test_parallel_for_each() {
+        let sum = Cell::new(0);
+        parallel_for_each(0..100u64, |i| {
+            let sum = &sum;
+            async move {
+                if i % 2 == 0 {
+                    yield_now().await;
+                }
+                sum.set(sum.get() + i);
+            }
+        })
+        .await;
+        assert_eq!(sum.get(), 100 * 99 / 2);
+    }
+
+    // Not shared, so that other tests do not allocate in the meantime.
+    #[seastar::test]
+    async fn test_parallel_for_each_ready_futures_do_not_allocate() {
+        let count = Cell::new(0);
+        let mallocs = allocations();
+        parallel_for_each(0..10_000, |_| {
+            count.set(count.get() + 1);
+            async {}
+        })
+        .await;
+        let mallocs = allocations() - mallocs;
+        assert_eq!(count.get(), 10_000);
+        // The loop itself allocates one chunk and one waker; anything else
+        // comes from the reactor running in between, when the loop yields.
+        assert!(mallocs < 100, "{mallocs} allocations");
+    }
+
+    #[seastar::test(shared)]
+    async fn test_max_concurrent_for_each_limits_concurrency() {
+        let running = Cell::new(0);
+        let max_running = Cell::new(0);
+        max_concurrent_for_each(0..50, 4, |_| {
+            let (running, max_running) = (&running, &max_running);
+            async move {
+                running.set(running.get() + 1);
+                max_running.set(max_running.get().max(running.get()));
+                sleep(Duration::from_millis(1)).await;
+                running.set(running.get() - 1);
+            }
+        })
+        .await;
+        assert_eq!(running.get(), 0);
+        assert_eq!(max_running.get(), 4);
+    }
+
+    #[seastar::test]
+    async fn test_parallel_for_each_woken_from_another_shard() {
+        let sum = Cell::new(0);
+        parallel_for_each(0..10u32, |i| {
+            let sum = &sum;
+            async move {
+                let (tx, rx) = futures::channel::oneshot::channel();
+                spawn_detached(submit_to(1, move || async move {
+                    tx.send(i).unwrap();
+                }));
+                sum.set(sum.get() + rx.await.unwrap());
+            }
+        })
+        .await;
+        assert_eq!(sum.get(), 45);
+    }
+
+    #[seastar::test(shared)]
+    async fn test_for_each_empty() {
+        parallel_for_each(std::iter::empty::<u32>(), |_| async {}).await;
+        max_concurrent_for_each(std::iter::empty::<u32>(), 1, |_| async {}).await;
+    }
+}
@@ -0,0 +1,305 @@
+use crate::{engine_is_ready, slab, spawn_detached, submit_to, this_shard_id};
+use std::cell::RefCell;
+use std::marker::PhantomData;
+use std::ops::Deref;
+use std::ptr::NonNull;
+
+/// A value waiting to be destroyed on its owner shard.
+struct Garbage {
+    ptr: *mut u8,
+    destroy: unsafe fn(*mut u8),
+}
+
+// Garbage is only moved to its owner shard, never accessed elsewhere.
+unsafe impl Send for Garbage {}
+
+unsafe fn destroy<T>(ptr: *mut u8) {
+    slab::free(NonNull::new_unchecked(ptr as *mut T));
+}
+
+/// Values dropped on this shard that are owned by another one.
+#[derive(Default)]
+struct OutgoingGarbage {
+    /// One batch per owner shard.
+    batches: Vec<Vec<Garbage>>,
+    /// Whether a task delivering the batch for the shard is running.
+    flushing: Vec<bool>,
+}
+
+thread_local! {
+    static OUTGOING: RefCell<OutgoingGarbage> = RefCell::new(OutgoingGarbage::default());
+}
+
+fn send_home(owner: u32, garbage: Garbage) {
+    let start_flush = OUTGOING.with(|outgoing| {
+        let mut outgoing = outgoing.borrow_mut();
+        let shard = owner as usize;
+        if outgoing.batches.len() <= shard {
+            outgoing.batches.resize_with(shard + 1, Vec::new);
+            outgoing.flushing.resize(shard + 1, false);
+        }
+        outgoing.batches[shard].push(garbage);
+        !std::mem::replace(&mut outgoing.flushing[shard], true)
+    });
+    if start_flush {
+        spawn_detached(flush_garbage(owner));
+    }
+}
+
+/// Delivers batches of garbage to `owner` until none is left.
+///
+/// It starts only after the current task yields, so everything dropped
+/// in the meantime travels in a single message. The emptied batch comes
+/// back, so its memory is reused rather than freed on the owner shard.
+async fn flush_garbage(owner: u32) {
+    let shard = owner as usize;
+    let mut spare = Vec::new();
+    loop {
+        let batch = OUTGOING.with(|outgoing| {
+            let mut outgoing = outgoing.borrow_mut();
+            if outgoing.batches[shard].is_empty() {
+                outgoing.flushing[shard] = false;
+                None
+            } else {
+                Some(std::mem::replace(&mut outgoing.batches[shard], spare))
+            }
+        });
+        let Some(batch) = batch else {
+            return;
+        };
+        spare = submit_to(owner, move || async move {
+            let mut batch = batch;
+            for garbage in batch.drain(..) {
+                unsafe { (garbage.destroy)(garbage.ptr) };
+            }
+            batch
+        })
+        .await;
+    }
+}
+
+/// Smart pointer wrapper which makes it safe to move objects across shards.
+///
+/// Modeled on `seastar::foreign_ptr`. The value is allocated and destroyed
+/// on the shard that creates the `ForeignPtr` (the owner shard), so it needs
+/// neither atomic reference counts nor cross-shard frees. Moving the
+/// `ForeignPtr` itself to another shard, e.g. as the result of
+/// [`submit_to`], is as cheap as moving a pointer.
+///
+/// When dropped on another shard, the value is sent back to the owner shard
+/// to be destroyed. Values dropped close together are sent in a single
+/// batched message, not one [`submit_to`] each. When dropped on a thread
+/// outside of the runtime, where no message can be sent, the value is leaked:
+/// it is never destroyed, rather than destroyed on the wrong thread.
+///
+/// The value can be read from any shard only if it is `Sync`; otherwise
+/// only on the owner shard (see [`local`](ForeignPtr::local)).
+///
+/// # Example
+///
+/// ```rust
+/// #[seastar::test]
+/// async fn foreign_ptr_example() {
+///     let list = submit_to(1, || async { ForeignPtr::new(Rc::new(vec![1, 2, 3])) }).await;
+///     assert_eq!(list.get_owner_shard(), 1);
+///     drop(list); // The `Rc` is destroyed on shard 1.
+/// }
+/// ```
+pub struct ForeignPtr<T: 'static> {
+    ptr: NonNull<T>,
+    owner: u32,
+    _marker: PhantomData<T>,
+}
+
+// The value is only accessed on the owner shard, or through `&T` where `T: Sync`.
+unsafe impl<T: 'static> Send for ForeignPtr<T> {}
+unsafe impl<T: Sync + 'static> Sync for ForeignPtr<T> {}
+
+/// Wraps `value` in a [`ForeignPtr`] owned by the current shard.
+pub fn make_foreign<T: 'static>(value: T) -> ForeignPtr<T> {
+    ForeignPtr::new(value)
+}
+
+impl<T: 'static> ForeignPtr<T> {
+    /// Wraps `value` in a `ForeignPtr` owned by the current shard.
+    pub fn new(value: T) -> Self {
+        crate::assert_runtime_is_running();
+        ForeignPtr {
+            ptr: slab::alloc(value),
+            owner: this_shard_id(),
+            _marker: PhantomData,
+        }
+    }
+
+    /// Returns the shard that owns the value.
+    pub fn get_owner_shard(&self) -> u32 {
+        self.owner
+    }
+
+    /// Checks whether the current shard owns the value.
+    pub fn is_local(&self) -> bool {
+        this_shard_id() == self.owner
+    }
+
+    /// Returns the value if the current shard owns it.
+    pub fn local(&self) -> Option<&T> {
+        self.is_local().then(|| unsafe { self.ptr.as_ref() })
+    }
+
+    /// Returns the value for writing if the current shard owns it.
+    pub fn local_mut(&mut self) -> Option<&mut T> {
+        match self.is_local() {
+            true => Some(unsafe { self.ptr.as_mut() }),
+            false => None,
+        }
+    }
+
+    /// Takes the value out if the current shard owns it,
+    /// otherwise returns the pointer back.
+    pub fn into_inner(self) -> Result<T, Self> {
+        if !self.is_local() {
+            return Err(self);
+        }
+        let ptr = self.ptr;
+        std::mem::forget(self);
+        unsafe {
+            let value = std::ptr::read(ptr.as_ptr());
+            slab::free(NonNull::new_unchecked(
+                ptr.as_ptr() as *mut std::mem::ManuallyDrop<T>
+            ));
+            Ok(value)
+        }
+    }
+
+    /// Creates a copy of the value on the owner shard, wrapped in a new `ForeignPtr`.
+    ///
+    /// Mostly useful for reference-counted values, like `Rc`, which must only be
+    /// cloned on their own shard.
+    pub async fn copy(&self) -> ForeignPtr<T>
+    where
+        T: Clone,
+    {
+        if self.is_local() {
+            return ForeignPtr::new(unsafe { self.ptr.as_ref() }.clone());
+        }
+        let source = SendPtr(self.ptr);
+        // `self` is borrowed until the copy is done, so the value stays alive.
+        submit_to(self.owner, move || async move {
+            let source = source;
+            ForeignPtr::new(unsafe { source.0.as_ref() }.clone())
+        })
+        .await
+    }
+}
+
+struct SendPtr<T>(NonNull<T>);
+
+// Only dereferenced on the owner shard.
+unsafe impl<T> Send for SendPtr<T> {}
+
+impl<T: Sync + 'static> Deref for ForeignPtr<T> {
+    type Target = T;
+
+    fn deref(&self) -> &T {
+        unsafe { self.ptr.as_ref() }
+    }
+}
+
+impl<T: 'static> Drop for ForeignPtr<T> {
+    fn drop(&mut self) {
+        let garbage = Garbage {
+            ptr: self.ptr.as_ptr() as *mut u8,
+            destroy: destroy::<T>,
+        };
+        if !engine_is_ready() {
+            // Neither freeing the value here nor sending it home is possible.
+            std::mem::forget(garbage);
+        } else if this_shard_id() == self.owner {
+            unsafe { (garbage.destroy)(garbage.ptr) };
+        } else {
+            send_home(self.owner, garbage);
+        }
+    }
+}
+
+#[cfg(test)]
+mod tests {
+    use super::*;
+    use crate as seastar;
+    use std::cell::Cell;
+    use std::rc::Rc;
+
+    thread_local! {
+        static DROPPED: Cell<u32> = Cell::new(0);
+    }
+
+    struct DropCounter;
+
+    impl Drop for DropCounter {
+        fn drop(&mut self) {
+            DROPPED.with(|dropped| dropped.set(dropped.get() + 1));
+        }
+    }
+
+    #[seastar::test]
+    async fn test_foreign_ptr_local() {
+        let mut ptr = make_foreign(Rc::new(42));
+        assert!(ptr.is_local());
+        assert_eq!(**ptr.local().unwrap(), 42);
+        *ptr.local_mut().unwrap() = Rc::new(43);
+        let rc = ptr.into_inner().ok().unwrap();
+        assert_eq!(*rc, 43);
+    }
+
+    #[seastar::test]
+    async fn test_foreign_ptr_destroyed_on_owner() {
+        let ptrs = submit_to(1, || async {
+            DROPPED.with(|dropped| dropped.set(0));
+            (0..100)
+                .map(|_| ForeignPtr::new(DropCounter))
+                .collect::<Vec<_>>()
+        })
+        .await;
+        assert!(ptrs.iter().all(|ptr| ptr.get_owner_shard() == 1));
+        assert!(ptrs[0].local().is_none());
+        drop(ptrs);
+
+        // Everything goes in one batch, which is delivered after this task yields.
+        crate::yield_now().await;
+        let dropped = submit_to(1, || async {
+            crate::yield_now().await;
+            DROPPED.with(|dropped| dropped.get())
+        })
+        .await;
+        assert_eq!(dropped, 100);
+        assert_eq!(DROPPED.with(|dropped| dropped.get()), 0);
+    }
+
+    #[seastar::test]
+    async fn test_foreign_ptr_leaked_outside_runtime() {
+        DROPPED.with(|dropped| dropped.set(0));
+        let ptr = ForeignPtr::new(DropCounter);
+        let dropped = std::thread::spawn(move || {
+            drop(ptr);
+            DROPPED.with(|dropped| dropped.get())
+        })
+        .join()
+        .unwrap();
+        assert_eq!(dropped, 0);
+        crate::yield_now().await;
+        assert_eq!(DROPPED.with(|dropped| dropped.get()), 0);
+    }
+
+    #[seastar::test]
+    async fn test_foreign_ptr_copy() {
+        let ptr = submit_to(1, || async { ForeignPtr::new(Rc::new(String::from("42"))) }).await;
+        let copy = ptr.copy().await;
+        assert_eq!(copy.get_owner_shard(), 1);
+        let len = submit_to(1, move || async move {
+            let copy = copy;
+            copy.local().unwrap().len()
+        })
+        .await;
+        assert_eq!(len, 2);
+    }
+}
@@ -7,8 +7,20 @@ std::unique_ptr<gate> new_gate() {
     return std::make_unique<gate>();
 }
 
-std::unique_ptr<gate_holder> new_gate_holder(const std::unique_ptr<gate>& gate) {
-    return std::make_unique<gate_holder>(*gate);
+bool try_enter_gate(gate* gate) {
+    return gate->try_enter();
+}
+
+void leave_gate(gate* gate) {
+    gate->leave();
+}
+
+size_t get_gate_count(const std::unique_ptr<gate>& gate) {
+    return gate->get_count();
+}
+
+bool is_gate_closed(const std::unique_ptr<gate>& gate) {
+    return gate->is_closed();
 }
 
 VoidFuture close_gate(const std::unique_ptr<gate>& gate) {
@@ -7,11 +7,18 @@ namespace seastar_ffi {
 namespace gate {
 
 using gate = seastar::gate;
-using gate_holder = gate::holder;
 
 std::unique_ptr<gate> new_gate();
 
-std::unique_ptr<gate_holder> new_gate_holder(const std::unique_ptr<gate>& gate);
+// Enters and leaves through the gate's counter directly, so that holders
+// need no allocation (unlike `gate::holder`).
+bool try_enter_gate(gate* gate);
+
+void leave_gate(gate* gate);
+
+size_t get_gate_count(const std::unique_ptr<gate>& gate);
+
+bool is_gate_closed(const std::unique_ptr<gate>& gate);
 
 VoidFuture close_gate(const std::unique_ptr<gate>& gate);
 
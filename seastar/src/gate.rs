@@ -1,4 +1,6 @@
+use crate::spawn_detached;
 use cxx::UniquePtr;
+use std::future::Future;
 use std::marker::PhantomData;
 use thiserror::Error;
 
@@ -8,13 +10,15 @@ mod ffi {
         include!("seastar/src/gate.hh");
 
         type gate;
-        type gate_holder;
 
         #[namespace = "seastar_ffi"]
         type VoidFuture = crate::cxx_async_futures::VoidFuture;
 
         fn new_gate() -> UniquePtr<gate>;
-        fn new_gate_holder(gate: &UniquePtr<gate>) -> Result<UniquePtr<gate_holder>>;
+        unsafe fn try_enter_gate(gate: *mut gate) -> bool;
+        unsafe fn leave_gate(gate: *mut gate);
+        fn get_gate_count(gate: &UniquePtr<gate>) -> usize;
+        fn is_gate_closed(gate: &UniquePtr<gate>) -> bool;
         fn close_gate(gate: &UniquePtr<gate>) -> VoidFuture;
     }
 }
@@ -47,13 +51,61 @@ impl Gate {
         Gate { inner: new_gate() }
     }
 
+    fn raw(&self) -> *mut gate {
+        self.inner.as_ref().unwrap() as *const gate as *mut gate
+    }
+
     /// Tries to enter the gate.
     ///
     /// If it succeeds, it returns [`GateHolder`] that will leave the gate when destroyed (RAII).
+    /// Entering and leaving only update the gate's counter and do not allocate.
     ///
     /// If it fails, it returns [`GateClosedError`].
     pub fn try_enter(&self) -> Result<GateHolder, GateClosedError> {
-        GateHolder::new(&self.inner)
+        unsafe { GateHolder::enter(self.raw()) }
+    }
+
+    /// Runs `future` in the background while holding the gate.
+    ///
+    /// The gate is left when the future completes, so [`close`](Gate::close)
+    /// waits for it.
+    ///
+    /// If the gate is closed, `future` is dropped without being polled
+    /// and [`GateClosedError`] is returned.
+    ///
+    /// # Example
+    ///
+    /// ```rust
+    /// #[seastar::test]
+    /// async fn gate_spawn_example() {
+    ///     let gate = Gate::new();
+    ///     gate.spawn(async { /* handle a request */ }).unwrap();
+    ///     gate.close().await;
+    /// }
+    /// ```
+    pub fn spawn<Fut>(&self, future: Fut) -> Result<(), GateClosedError>
+    where
+        Fut: Future<Output = ()> + 'static,
+    {
+        // The holder must not borrow the gate, as the task outlives this call.
+        // The C++ gate stays in place until it is closed, which waits for the task
+        // (see also `Drop for Gate`).
+        let holder: GateHolder<'static> = unsafe { GateHolder::enter(self.raw())? };
+        spawn_detached(async move {
+            let _holder = holder;
+            future.await;
+        });
+        Ok(())
+    }
+
+    /// Returns the number of requests that have entered the gate and not left it yet.
+    pub fn get_count(&self) -> usize {
+        get_gate_count(&self.inner)
+    }
+
+    /// Checks whether the gate has been closed.
+    pub fn is_closed(&self) -> bool {
+        is_gate_closed(&self.inner)
     }
 
     /// Closes the gate.
@@ -67,28 +119,47 @@ impl Gate {
     }
 }
 
+impl Drop for Gate {
+    fn drop(&mut self) {
+        // Tasks started with `Gate::spawn` may still hold the gate if it has
+        // not been closed. They access it until they finish, so it is leaked.
+        if self.get_count() != 0 {
+            std::mem::forget(std::mem::replace(&mut self.inner, UniquePtr::null()));
+        }
+    }
+}
+
 /// Facility to hold a gate opened using RAII.
 ///
 /// A [`GateHolder`] is obtained when [`try_enter`](Gate::try_enter) succeeds.
 ///
 /// The [`Gate`] is left when the [`GateHolder`] is dropped.
 pub struct GateHolder<'a> {
-    _inner: UniquePtr<gate_holder>,
-    _phantom: PhantomData<&'a ()>,
+    gate: *mut gate,
+    _phantom: PhantomData<&'a Gate>,
 }
 
 impl<'a> GateHolder<'a> {
-    fn new(gate: &'a UniquePtr<gate>) -> Result<Self, GateClosedError> {
-        match new_gate_holder(gate) {
-            Ok(holder) => Ok(GateHolder {
-                _inner: holder,
+    /// # Safety
+    ///
+    /// `gate` must stay valid for as long as the holder exists.
+    unsafe fn enter(gate: *mut gate) -> Result<Self, GateClosedError> {
+        match try_enter_gate(gate) {
+            true => Ok(GateHolder {
+                gate,
                 _phantom: PhantomData,
             }),
-            Err(_) => Err(GateClosedError),
+            false => Err(GateClosedError),
         }
     }
 }
 
+impl<'a> Drop for GateHolder<'a> {
+    fn drop(&mut self) {
+        unsafe { leave_gate(self.gate) };
+    }
+}
+
 #[cfg(test)]
 mod tests {
     use super::*;
@@ -96,13 +167,13 @@ mod tests {
     use futures::join;
     use std::{cell::RefCell, rc::Rc};
 
-    #[seastar::test]
+    #[seastar::test(shared)]
     async fn test_gate_only_close() {
         let gate = Gate::new();
         gate.close().await;
     }
 
-    #[seastar::test]
+    #[seastar::test(shared)]
     async fn test_gate_leave_then_close() {
         let gate = Gate::new();
 
@@ -113,7 +184,7 @@ mod tests {
         gate.close().await;
     }
 
-    #[seastar::test]
+    #[seastar::test(shared)]
     async fn test_gate_close_then_leave() {
         let gate = Gate::new();
 
@@ -137,7 +208,7 @@ mod tests {
         assert!(*closing_finished.borrow());
     }
 
-    #[seastar::test]
+    #[seastar::test(shared)]
     async fn test_gate_many_leave() {
         let gate = Gate::new();
 
@@ -170,7 +241,7 @@ mod tests {
         assert!(*closing_finished.borrow());
     }
 
-    #[seastar::test]
+    #[seastar::test(shared)]
     async fn test_gate_close_then_enter() {
         let gate = Gate::new();
 
@@ -181,4 +252,36 @@ mod tests {
             _ => panic!("gate.try_enter() should return Err(GateClosedError)."),
         }
     }
+
+    #[seastar::test(shared)]
+    async fn test_gate_count() {
+        let gate = Gate::new();
+        let holder1 = gate.try_enter().unwrap();
+        let holder2 = gate.try_enter().unwrap();
+        assert_eq!(gate.get_count(), 2);
+        drop(holder1);
+        drop(holder2);
+        assert_eq!(gate.get_count(), 0);
+        assert!(!gate.is_closed());
+        gate.close().await;
+        assert!(gate.is_closed());
+    }
+
+    #[seastar::test(shared)]
+    async fn test_gate_spawn() {
+        let gate = Gate::new();
+        let finished = Rc::new(RefCell::new(false));
+
+        let finished_clone = finished.clone();
+        gate.spawn(async move {
+            crate::yield_now().await;
+            *finished_clone.borrow_mut() = true;
+        })
+        .unwrap();
+        assert_eq!(gate.get_count(), 1);
+
+        gate.close().await;
+        assert!(*finished.borrow());
+        assert!(gate.spawn(async {}).is_err());
+    }
 }
@@ -2,34 +2,107 @@
 //!
 //! Work in progress! Definitely not for use in production yet.
 
+mod abort_source;
+mod allocator;
 mod api_safety;
+mod arena;
+#[cfg(feature = "bench")]
+#[doc(hidden)]
+pub mod bench_baseline;
+mod channel;
+mod condition_variable;
 mod config_and_start_seastar;
 mod cxx_async_futures;
 mod cxx_async_local_future;
-mod ffi_utils;
+mod file;
+mod for_each;
+mod foreign_ptr;
 mod gate;
+mod lru;
+mod metrics;
+mod net;
+mod packet;
+mod poller;
 mod preempt;
-#[cfg(test)]
-pub(crate) mod seastar_test_guard;
+mod reclaimer;
+mod result_slot;
+mod rpc;
+mod scheduling;
+#[cfg(any(test, feature = "test-util"))]
+mod seastar_test_guard;
+mod semaphore;
+mod shard_channel;
+mod sharded;
+mod shared_future;
+mod slab;
+mod smp;
 mod spawn;
+mod stall_detector;
 mod submit_to;
+mod task_trace;
+mod temporary_buffer;
+#[cfg(any(test, feature = "test-util"))]
+mod test_runtime;
+mod timer;
 
-#[cfg(test)]
-pub(crate) use seastar_test_guard::acquire_guard_for_seastar_test;
+// Used by the code generated by `#[seastar::test]`.
+#[cfg(any(test, feature = "test-util"))]
+#[doc(hidden)]
+pub use seastar_test_guard::acquire_guard_for_seastar_test;
+#[cfg(any(test, feature = "test-util"))]
+#[doc(hidden)]
+pub use test_runtime::run_test_in_shared_runtime;
 
+pub use abort_source::*;
+pub use allocator::*;
 pub use api_safety::*;
+pub use arena::*;
+pub use channel::*;
+pub use condition_variable::*;
 pub use config_and_start_seastar::*;
+pub use file::*;
+pub use for_each::*;
+pub use foreign_ptr::*;
 pub use gate::*;
+pub use lru::*;
+pub use metrics::*;
+pub use net::*;
+pub use packet::*;
+pub use poller::*;
 pub use preempt::*;
+pub use reclaimer::*;
+pub use rpc::*;
+pub use scheduling::*;
+pub use semaphore::*;
+pub use shard_channel::*;
+pub use sharded::*;
+pub use shared_future::*;
+pub use smp::*;
 pub use spawn::*;
+pub use stall_detector::*;
 pub use submit_to::*;
+pub use task_trace::*;
+pub use temporary_buffer::*;
+pub use timer::*;
 
 /// A macro intended for running asynchronous tests.
 ///
-/// Tests are spawned in a separate thread.
+/// By default, every test starts a runtime of its own, in a separate thread.
 /// This is done to ensure thread_local cleanup between them
 /// (at the time of writing, Seastar doesn't do it itself).
 ///
+/// Arguments:
+/// - `smp = N`: the test's runtime has `N` shards.
+/// - `shared`: the test runs as a task on shard 0 of a runtime shared with
+///   the other `shared` tests of the binary, which is much faster than
+///   starting a runtime. Such tests run concurrently, so they must not
+///   depend on thread-local state left behind by other tests. The number of
+///   shards of the shared runtime can be set with `SEASTAR_TEST_SMP`.
+/// - `parallel`: same as `shared`, but the test may run on any shard.
+///
+/// Outside of this crate, the macro requires the `test-util` feature, e.g.
+/// with `seastar = { ..., features = ["test-util"] }` in `[dev-dependencies]`.
+///
 /// # Usage
 ///
 /// ```rust
@@ -37,5 +110,15 @@ pub use submit_to::*;
 /// async fn my_test() {
 ///     assert!(true);
 /// }
+///
+/// #[seastar::test(smp = 4)]
+/// async fn my_test_with_4_shards() {
+///     assert_eq!(seastar::smp_count(), 4);
+/// }
+///
+/// #[seastar::test(shared)]
+/// async fn my_quick_test() {
+///     assert!(true);
+/// }
 /// ```
 pub use seastar_macros::test;
@@ -0,0 +1,425 @@
+//! A shard-local LRU cache that gives memory back under memory pressure.
+//!
+//! Seastar gives every shard a fixed amount of memory (`--memory`), and
+//! allocations fail once it is used up. A cache sized conservatively wastes
+//! the memory it leaves unused; a [`ShardLocalLru`] can instead be allowed to
+//! grow without a bound of its own, since it registers with the shard's
+//! allocator (see [`register_reclaimer`]) and evicts its least recently used
+//! entries when the allocator runs low.
+
+use crate::{register_reclaimer, ReclaimerRegistration};
+use std::borrow::Borrow;
+use std::cell::RefCell;
+use std::collections::HashMap;
+use std::hash::Hash;
+use std::mem;
+use std::rc::Rc;
+
+const NIL: usize = usize::MAX;
+
+struct Node<K, V> {
+    key: K,
+    value: V,
+    size: usize,
+    // Towards the most and the least recently used entries.
+    prev: usize,
+    next: usize,
+}
+
+/// Statistics of a [`ShardLocalLru`].
+#[derive(Clone, Copy, Debug, Default, PartialEq, Eq)]
+pub struct LruStats {
+    /// Lookups that found their entry.
+    pub hits: u64,
+    /// Lookups that did not.
+    pub misses: u64,
+    /// Entries evicted, to stay within the maximum size or to release memory.
+    pub evictions: u64,
+    /// Bytes (as weighed) evicted because the allocator asked for memory.
+    pub reclaimed: u64,
+}
+
+struct State<K, V> {
+    index: HashMap<K, usize>,
+    // The entries are linked in recency order through their positions here,
+    // so the list costs no allocation of its own, and reordering is O(1).
+    nodes: Vec<Option<Node<K, V>>>,
+    free: Vec<usize>,
+    // The most and the least recently used entries.
+    head: usize,
+    tail: usize,
+    size: usize,
+    max_size: usize,
+    weigher: Box<dyn Fn(&K, &V) -> usize>,
+    stats: LruStats,
+}
+
+impl<K: Hash + Eq + Clone, V> State<K, V> {
+    fn node(&mut self, i: usize) -> &mut Node<K, V> {
+        self.nodes[i].as_mut().unwrap()
+    }
+
+    fn unlink(&mut self, i: usize) {
+        let (prev, next) = {
+            let node = self.node(i);
+            (node.prev, node.next)
+        };
+        match prev {
+            NIL => self.head = next,
+            prev => self.node(prev).next = next,
+        }
+        match next {
+            NIL => self.tail = prev,
+            next => self.node(next).prev = prev,
+        }
+    }
+
+    fn push_front(&mut self, i: usize) {
+        let head = self.head;
+        let node = self.node(i);
+        node.prev = NIL;
+        node.next = head;
+        match head {
+            NIL => self.tail = i,
+            head => self.node(head).prev = i,
+        }
+        self.head = i;
+    }
+
+    fn touch(&mut self, i: usize) {
+        if self.head != i {
+            self.unlink(i);
+            self.push_front(i);
+        }
+    }
+
+    fn take(&mut self, i: usize) -> Node<K, V> {
+        self.unlink(i);
+        let node = self.nodes[i].take().unwrap();
+        self.index.remove(&node.key);
+        self.free.push(i);
+        self.size -= node.size;
+        node
+    }
+
+    /// Evicts entries, least recently used first, until at least `bytes`
+    /// were evicted or the cache is empty. Returns the bytes evicted.
+    fn evict(&mut self, bytes: usize) -> usize {
+        let mut evicted = 0;
+        while evicted < bytes && self.tail != NIL {
+            evicted += self.take(self.tail).size;
+            self.stats.evictions += 1;
+        }
+        if self.index.is_empty() {
+            // Also give back the storage of the entries.
+            self.nodes = Vec::new();
+            self.free = Vec::new();
+            self.index.shrink_to_fit();
+        }
+        evicted
+    }
+
+    fn shrink_to(&mut self, max_size: usize) {
+        if self.size > max_size {
+            self.evict(self.size - max_size);
+        }
+    }
+
+    fn insert(&mut self, key: K, value: V) -> Option<V> {
+        let old = self.index.get(&key).copied().map(|i| self.take(i).value);
+        let size = (self.weigher)(&key, &value);
+        if size > self.max_size {
+            return old;
+        }
+        self.shrink_to(self.max_size - size);
+        let node = Some(Node {
+            key: key.clone(),
+            value,
+            size,
+            prev: NIL,
+            next: NIL,
+        });
+        let i = match self.free.pop() {
+            Some(i) => {
+                self.nodes[i] = node;
+                i
+            }
+            None => {
+                self.nodes.push(node);
+                self.nodes.len() - 1
+            }
+        };
+        self.index.insert(key, i);
+        self.push_front(i);
+        self.size += size;
+        old
+    }
+}
+
+/// A cache of the most recently used entries of the current shard, evicted
+/// under memory pressure.
+///
+/// Entries are weighed when they are inserted, and the least recently used
+/// ones are evicted when the total weight would exceed the maximum size, or
+/// when the shard's allocator asks for memory back. The weight should thus
+/// reflect the memory the entry holds, including on the heap.
+///
+/// Like the other shard-local primitives, it is neither `Send` nor `Sync`.
+/// Values must not use the cache when they are dropped.
+///
+/// # Example
+///
+/// ```rust
+/// #[seastar::test]
+/// async fn lru_example() {
+///     // Bounded by the memory of the shard only.
+///     let cache = ShardLocalLru::with_weigher(usize::MAX, |k: &String, v: &Vec<u8>| {
+///         k.capacity() + v.capacity()
+///     });
+///     cache.insert("key".to_string(), vec![0; 1024]);
+///     assert_eq!(cache.get("key").map(|v| v.len()), Some(1024));
+/// }
+/// ```
+pub struct ShardLocalLru<K, V> {
+    // Dropped first: the reclaimer holds on to the state.
+    _reclaimer: ReclaimerRegistration,
+    state: Rc<RefCell<State<K, V>>>,
+}
+
+impl<K, V> ShardLocalLru<K, V>
+where
+    K: Hash + Eq + Clone + 'static,
+    V: 'static,
+{
+    /// Creates a cache holding up to `max_size` bytes, weighing entries by
+    /// their inline size only, which suits keys and values that own no heap
+    /// memory.
+    pub fn new(max_size: usize) -> Self {
+        Self::with_weigher(max_size, |_, _| mem::size_of::<Node<K, V>>())
+    }
+
+    /// Creates a cache holding up to `max_size` bytes, as weighed by `weigher`.
+    ///
+    /// With a `max_size` of `usize::MAX`, the cache is only bounded by the
+    /// memory of the shard.
+    pub fn with_weigher(max_size: usize, weigher: impl Fn(&K, &V) -> usize + 'static) -> Self {
+        let state = Rc::new(RefCell::new(State {
+            index: HashMap::new(),
+            nodes: Vec::new(),
+            free: Vec::new(),
+            head: NIL,
+            tail: NIL,
+            size: 0,
+            max_size,
+            weigher: Box::new(weigher),
+            stats: LruStats::default(),
+        }));
+        let s = state.clone();
+        let reclaimer = register_reclaimer(move |bytes| {
+            // Reclaimers run from their own task, so the cache should never
+            // be borrowed then; if it is, there is nothing to give back now.
+            let Ok(mut state) = s.try_borrow_mut() else {
+                return 0;
+            };
+            let evicted = state.evict(bytes);
+            state.stats.reclaimed += evicted as u64;
+            evicted
+        });
+        ShardLocalLru {
+            _reclaimer: reclaimer,
+            state,
+        }
+    }
+
+    /// Inserts an entry as the most recently used one, evicting others as
+    /// needed, and returns the value it replaces, if any.
+    ///
+    /// An entry weighing more than the maximum size is not inserted, but
+    /// still replaces the previous value.
+    pub fn insert(&self, key: K, value: V) -> Option<V> {
+        self.state.borrow_mut().insert(key, value)
+    }
+
+    /// Returns a copy of the value for `key`, if any, and marks the entry as
+    /// the most recently used one.
+    pub fn get<Q>(&self, key: &Q) -> Option<V>
+    where
+        K: Borrow<Q>,
+        Q: Hash + Eq + ?Sized,
+        V: Clone,
+    {
+        let mut state = self.state.borrow_mut();
+        let Some(&i) = state.index.get(key) else {
+            state.stats.misses += 1;
+            return None;
+        };
+        state.stats.hits += 1;
+        state.touch(i);
+        Some(state.node(i).value.clone())
+    }
+
+    /// Checks whether there is an entry for `key`, without marking it as used.
+    pub fn contains_key<Q>(&self, key: &Q) -> bool
+    where
+        K: Borrow<Q>,
+        Q: Hash + Eq + ?Sized,
+    {
+        self.state.borrow().index.contains_key(key)
+    }
+
+    /// Removes the entry for `key`, and returns its value.
+    pub fn remove<Q>(&self, key: &Q) -> Option<V>
+    where
+        K: Borrow<Q>,
+        Q: Hash + Eq + ?Sized,
+    {
+        let mut state = self.state.borrow_mut();
+        let i = *state.index.get(key)?;
+        Some(state.take(i).value)
+    }
+
+    /// Evicts the least recently used entries until at least `bytes` were
+    /// evicted or the cache is empty. Returns the bytes evicted.
+    pub fn evict(&self, bytes: usize) -> usize {
+        self.state.borrow_mut().evict(bytes)
+    }
+
+    /// Removes all the entries.
+    pub fn clear(&self) {
+        self.evict(usize::MAX);
+    }
+
+    /// Returns the number of entries.
+    pub fn len(&self) -> usize {
+        self.state.borrow().index.len()
+    }
+
+    /// Checks whether the cache has no entries.
+    pub fn is_empty(&self) -> bool {
+        self.len() == 0
+    }
+
+    /// Returns the total weight of the entries.
+    pub fn size(&self) -> usize {
+        self.state.borrow().size
+    }
+
+    /// Returns the maximum total weight of the entries.
+    pub fn max_size(&self) -> usize {
+        self.state.borrow().max_size
+    }
+
+    /// Changes the maximum total weight of the entries, evicting entries
+    /// if it is now exceeded.
+    pub fn set_max_size(&self, max_size: usize) {
+        let mut state = self.state.borrow_mut();
+        state.max_size = max_size;
+        state.shrink_to(max_size);
+    }
+
+    /// Returns the statistics of the cache.
+    pub fn stats(&self) -> LruStats {
+        self.state.borrow().stats
+    }
+}
+
+#[cfg(test)]
+mod tests {
+    use super::*;
+    use crate as seastar;
+
+    fn weigh_one(_: &u32, _: &String) -> usize {
+        1
+    }
+
+    #[seastar::test(shared)]
+    async fn test_lru_evicts_least_recently_used() {
+        let cache = ShardLocalLru::with_weigher(3, weigh_one);
+        for i in 0..3 {
+            assert_eq!(cache.insert(i, i.to_string()), None);
+        }
+        assert_eq!(cache.get(&0).as_deref(), Some("0"));
+        cache.insert(3, "3".to_string());
+        assert!(!cache.contains_key(&1));
+        assert_eq!(cache.len(), 3);
+        assert_eq!(cache.size(), 3);
+
+        assert_eq!(cache.insert(0, "zero".to_string()).as_deref(), Some("0"));
+        cache.insert(4, "4".to_string());
+        assert!(!cache.contains_key(&2));
+        assert!(cache.contains_key(&0));
+
+        assert_eq!(cache.get(&1), None);
+        let stats = cache.stats();
+        assert_eq!((stats.hits, stats.misses, stats.evictions), (1, 1, 2));
+        assert_eq!(stats.reclaimed, 0);
+    }
+
+    #[seastar::test(shared)]
+    async fn test_lru_size_accounting() {
+        let cache = ShardLocalLru::with_weigher(100, |_: &u32, v: &Vec<u8>| v.len());
+        cache.insert(0, vec![0; 40]);
+        cache.insert(1, vec![0; 40]);
+        assert_eq!(cache.size(), 80);
+        cache.insert(2, vec![0; 40]);
+        assert_eq!((cache.len(), cache.size()), (2, 80));
+        assert!(!cache.contains_key(&0));
+
+        // Too large to be cached, but replaces the previous value.
+        assert!(cache.insert(1, vec![0; 200]).is_some());
+        assert_eq!((cache.len(), cache.size()), (1, 40));
+
+        assert_eq!(cache.remove(&2).map(|v| v.len()), Some(40));
+        assert!(cache.is_empty());
+        assert_eq!(cache.size(), 0);
+    }
+
+    #[seastar::test(shared)]
+    async fn test_lru_evict_and_shrink() {
+        let cache = ShardLocalLru::with_weigher(usize::MAX, weigh_one);
+        for i in 0..10 {
+            cache.insert(i, i.to_string());
+        }
+        assert_eq!(cache.evict(3), 3);
+        assert!(!cache.contains_key(&2));
+        assert!(cache.contains_key(&3));
+
+        cache.set_max_size(5);
+        assert_eq!(cache.len(), 5);
+        assert!(cache.contains_key(&5));
+
+        cache.clear();
+        assert!(cache.is_empty());
+        assert_eq!(cache.evict(1), 0);
+        cache.insert(0, "0".to_string());
+        assert_eq!(cache.get(&0).as_deref(), Some("0"));
+    }
+
+    #[seastar::test(shared)]
+    async fn test_lru_reclaimer_evicts() {
+        let mut cache = ShardLocalLru::with_weigher(usize::MAX, |_: &u32, v: &Vec<u8>| v.len());
+        for i in 0..4 {
+            cache.insert(i, vec![0; 100]);
+        }
+        cache.get(&0);
+        assert_eq!(cache._reclaimer.reclaim(150), 200);
+        assert_eq!(cache.len(), 2);
+        assert!(cache.contains_key(&0));
+        assert!(!cache.contains_key(&1));
+        assert!(!cache.contains_key(&2));
+        let stats = cache.stats();
+        assert_eq!((stats.evictions, stats.reclaimed), (2, 200));
+
+        // Nothing can be evicted while the cache is in use.
+        let state = cache.state.clone();
+        let _in_use = state.borrow();
+        assert_eq!(cache._reclaimer.reclaim(150), 0);
+    }
+
+    #[seastar::test(shared)]
+    async fn test_lru_default_weight() {
+        let cache = ShardLocalLru::<u64, u64>::new(usize::MAX);
+        cache.insert(1, 2);
+        assert_eq!(cache.size(), mem::size_of::<Node<u64, u64>>());
+    }
+}
@@ -0,0 +1,124 @@
+#include <seastar/core/memory.hh>
+#include <seastar/core/metrics.hh>
+#include <seastar/core/metrics_api.hh>
+#include <seastar/core/prometheus.hh>
+#include <seastar/core/reactor.hh>
+#include <seastar/net/inet_address.hh>
+
+#include "metrics.hh"
+
+namespace seastar_ffi {
+namespace metrics {
+
+namespace sm = seastar::metrics;
+
+static seastar::sstring to_sstring(rust::Str s) {
+    return seastar::sstring(s.data(), s.size());
+}
+
+std::unique_ptr<metric_groups> new_metric_groups() {
+    return std::make_unique<metric_groups>();
+}
+
+std::unique_ptr<labels> new_labels() {
+    return std::make_unique<labels>();
+}
+
+void add_label(labels& l, rust::Str key, rust::Str value) {
+    l.emplace_back(to_sstring(key), to_sstring(value));
+}
+
+void add_counter(metric_groups& mg, rust::Str group, rust::Str name, rust::Str description, const labels& l, const uint64_t* value) {
+    mg.add_group(to_sstring(group), {
+        sm::make_counter(to_sstring(name), [value] { return *value; }, sm::description(to_sstring(description)), l),
+    });
+}
+
+void add_gauge(metric_groups& mg, rust::Str group, rust::Str name, rust::Str description, const labels& l, const double* value) {
+    mg.add_group(to_sstring(group), {
+        sm::make_gauge(to_sstring(name), [value] { return *value; }, sm::description(to_sstring(description)), l),
+    });
+}
+
+void add_histogram(metric_groups& mg, rust::Str group, rust::Str name, rust::Str description, const labels& l,
+        rust::Slice<const double> bounds, const uint64_t* counts, const uint64_t* sample_count, const double* sample_sum) {
+    std::vector<double> upper_bounds(bounds.begin(), bounds.end());
+    auto read = [upper_bounds = std::move(upper_bounds), counts, sample_count, sample_sum] {
+        sm::histogram h;
+        h.sample_count = *sample_count;
+        h.sample_sum = *sample_sum;
+        h.buckets.reserve(upper_bounds.size());
+        uint64_t cumulative = 0;
+        for (size_t i = 0; i < upper_bounds.size(); ++i) {
+            cumulative += counts[i];
+            h.buckets.push_back(sm::histogram_bucket{cumulative, upper_bounds[i]});
+        }
+        return h;
+    };
+    mg.add_group(to_sstring(group), {
+        sm::make_histogram(to_sstring(name), std::move(read), sm::description(to_sstring(description)), l),
+    });
+}
+
+bool read_metric(rust::Str name, double& value) {
+    auto values = sm::impl::get_values();
+    const auto& metadata = *values->metadata;
+    std::string_view wanted(name.data(), name.size());
+    bool found = false;
+    double sum = 0;
+    for (size_t i = 0; i < metadata.size(); ++i) {
+        if (metadata[i].mf.name != wanted) {
+            continue;
+        }
+        for (const auto& v : values->values[i]) {
+            if (v._type != sm::impl::data_type::HISTOGRAM) {
+                sum += v.d();
+                found = true;
+            }
+        }
+    }
+    value = sum;
+    return found;
+}
+
+uint64_t get_tasks_processed() {
+    return seastar::engine().get_sched_stats().tasks_processed;
+}
+
+uint64_t get_free_memory() {
+    return seastar::memory::stats().free_memory();
+}
+
+uint64_t get_allocated_memory() {
+    return seastar::memory::stats().allocated_memory();
+}
+
+uint64_t get_total_memory() {
+    return seastar::memory::stats().total_memory();
+}
+
+uint64_t get_cross_cpu_frees() {
+    return seastar::memory::stats().cross_cpu_frees();
+}
+
+std::shared_ptr<prometheus_server> new_prometheus_server() {
+    return std::make_shared<prometheus_server>();
+}
+
+VoidFuture start_prometheus_server(const std::shared_ptr<prometheus_server>& server, rust::Str host, uint16_t port, rust::Str prefix) {
+    auto s = server;
+    auto addr = seastar::socket_address(seastar::net::inet_address(std::string(host.data(), host.size())), port);
+    seastar::prometheus::config conf;
+    conf.prefix = to_sstring(prefix);
+    co_await s->control.start("prometheus");
+    co_await seastar::prometheus::start(s->control, conf);
+    co_await s->control.listen(addr);
+}
+
+VoidFuture stop_prometheus_server(const std::shared_ptr<prometheus_server>& server) {
+    auto s = server;
+    co_await s->control.stop();
+}
+
+} // namespace metrics
+} // namespace seastar_ffi
@@ -0,0 +1,55 @@
+#pragma once
+
+#include "cxx_async_futures.hh"
+#include <seastar/core/metrics_registration.hh>
+#include <seastar/http/httpd.hh>
+
+namespace seastar_ffi {
+namespace metrics {
+
+using metric_groups = seastar::metrics::metric_groups;
+using labels = std::vector<seastar::metrics::label_instance>;
+
+std::unique_ptr<metric_groups> new_metric_groups();
+
+std::unique_ptr<labels> new_labels();
+
+void add_label(labels& l, rust::Str key, rust::Str value);
+
+// The values live in Rust and must outlive their registration
+// (i.e. the metric_groups object). They are only read on scrapes.
+
+void add_counter(metric_groups& mg, rust::Str group, rust::Str name, rust::Str description, const labels& l, const uint64_t* value);
+
+void add_gauge(metric_groups& mg, rust::Str group, rust::Str name, rust::Str description, const labels& l, const double* value);
+
+// `counts` has one (non-cumulative) count per bound, followed by the count of larger samples.
+void add_histogram(metric_groups& mg, rust::Str group, rust::Str name, rust::Str description, const labels& l,
+        rust::Slice<const double> bounds, const uint64_t* counts, const uint64_t* sample_count, const double* sample_sum);
+
+// Sums the values of all instances of the metric `name` ("<group>_<name>")
+// registered on this shard. Histograms are skipped.
+bool read_metric(rust::Str name, double& value);
+
+uint64_t get_tasks_processed();
+
+uint64_t get_free_memory();
+
+uint64_t get_allocated_memory();
+
+uint64_t get_total_memory();
+
+uint64_t get_cross_cpu_frees();
+
+struct prometheus_server {
+    seastar::httpd::http_server_control control;
+};
+
+std::shared_ptr<prometheus_server> new_prometheus_server();
+
+VoidFuture start_prometheus_server(const std::shared_ptr<prometheus_server>& server, rust::Str host, uint16_t port, rust::Str prefix);
+
+VoidFuture stop_prometheus_server(const std::shared_ptr<prometheus_server>& server);
+
+} // namespace metrics
+} // namespace seastar_ffi
@@ -0,0 +1,479 @@
+use cxx::{SharedPtr, UniquePtr};
+use std::any::Any;
+use std::cell::Cell;
+use std::net::SocketAddr;
+use std::rc::Rc;
+use thiserror::Error;
+
+#[cxx::bridge]
+mod ffi {
+    #[namespace = "seastar_ffi"]
+    unsafe extern "C++" {
+        type VoidFuture = crate::cxx_async_futures::VoidFuture;
+    }
+
+    #[namespace = "seastar_ffi::metrics"]
+    unsafe extern "C++" {
+        include!("seastar/src/metrics.hh");
+
+        type metric_groups;
+        type labels;
+        type prometheus_server;
+
+        fn new_metric_groups() -> UniquePtr<metric_groups>;
+        fn new_labels() -> UniquePtr<labels>;
+        fn add_label(l: Pin<&mut labels>, key: &str, value: &str);
+
+        unsafe fn add_counter(
+            mg: Pin<&mut metric_groups>,
+            group: &str,
+            name: &str,
+            description: &str,
+            l: &labels,
+            value: *const u64,
+        ) -> Result<()>;
+        unsafe fn add_gauge(
+            mg: Pin<&mut metric_groups>,
+            group: &str,
+            name: &str,
+            description: &str,
+            l: &labels,
+            value: *const f64,
+        ) -> Result<()>;
+        unsafe fn add_histogram(
+            mg: Pin<&mut metric_groups>,
+            group: &str,
+            name: &str,
+            description: &str,
+            l: &labels,
+            bounds: &[f64],
+            counts: *const u64,
+            sample_count: *const u64,
+            sample_sum: *const f64,
+        ) -> Result<()>;
+
+        fn read_metric(name: &str, value: &mut f64) -> bool;
+        fn get_tasks_processed() -> u64;
+        fn get_free_memory() -> u64;
+        fn get_allocated_memory() -> u64;
+        fn get_total_memory() -> u64;
+        fn get_cross_cpu_frees() -> u64;
+
+        fn new_prometheus_server() -> SharedPtr<prometheus_server>;
+        fn start_prometheus_server(
+            server: &SharedPtr<prometheus_server>,
+            host: &str,
+            port: u16,
+            prefix: &str,
+        ) -> VoidFuture;
+        fn stop_prometheus_server(server: &SharedPtr<prometheus_server>) -> VoidFuture;
+    }
+}
+
+/// Error returned when registering a metric fails, e.g. because a metric
+/// with the same name and labels is already registered on the shard,
+/// or when starting the Prometheus server fails.
+#[derive(Error, Debug)]
+#[error("MetricsError: {0}")]
+pub struct MetricsError(String);
+
+/// A set of metrics registered on the current shard (`seastar::metrics::metric_groups`).
+///
+/// Metrics are registered under a group name, which prefixes their names:
+/// a counter `requests` in the group `http` is exported as `http_requests`.
+/// Every metric gets a `shard` label, in addition to the given ones.
+///
+/// The values are plain `Cell`s on the current shard, so updating a metric
+/// is a single non-atomic store. They are read only when the metrics are
+/// collected, e.g. by the Prometheus endpoint (see [`PrometheusServer`]).
+///
+/// The metrics are unregistered when the group is dropped; the handles
+/// returned by the group can still be updated afterwards.
+///
+/// # Example
+///
+/// ```rust
+/// #[seastar::test]
+/// async fn metrics_example() {
+///     let mut metrics = MetricGroup::new("http");
+///     let requests = metrics
+///         .counter("requests", "Number of requests served", &[("method", "GET")])
+///         .unwrap();
+///     requests.inc();
+///     assert_eq!(read_metric("http_requests"), Some(1.0));
+/// }
+/// ```
+pub struct MetricGroup {
+    // Declared first, so the metrics are unregistered before their values are freed.
+    inner: UniquePtr<ffi::metric_groups>,
+    name: String,
+    values: Vec<Rc<dyn Any>>,
+}
+
+fn to_labels(labels: &[(&str, &str)]) -> UniquePtr<ffi::labels> {
+    let mut ret = ffi::new_labels();
+    for (key, value) in labels {
+        ffi::add_label(ret.pin_mut(), key, value);
+    }
+    ret
+}
+
+fn to_error(err: cxx::Exception) -> MetricsError {
+    MetricsError(err.what().to_string())
+}
+
+impl MetricGroup {
+    /// Creates an empty group named `name`.
+    pub fn new(name: &str) -> Self {
+        crate::assert_runtime_is_running();
+        MetricGroup {
+            inner: ffi::new_metric_groups(),
+            name: name.to_string(),
+            values: Vec::new(),
+        }
+    }
+
+    /// Registers a counter: a monotonically increasing integer.
+    pub fn counter(
+        &mut self,
+        name: &str,
+        description: &str,
+        labels: &[(&str, &str)],
+    ) -> Result<Counter, MetricsError> {
+        let value = Rc::new(Cell::new(0u64));
+        unsafe {
+            ffi::add_counter(
+                self.inner.pin_mut(),
+                &self.name,
+                name,
+                description,
+                &to_labels(labels),
+                value.as_ptr(),
+            )
+        }
+        .map_err(to_error)?;
+        self.values.push(value.clone());
+        Ok(Counter { value })
+    }
+
+    /// Registers a gauge: a value that can go up and down.
+    pub fn gauge(
+        &mut self,
+        name: &str,
+        description: &str,
+        labels: &[(&str, &str)],
+    ) -> Result<Gauge, MetricsError> {
+        let value = Rc::new(Cell::new(0f64));
+        unsafe {
+            ffi::add_gauge(
+                self.inner.pin_mut(),
+                &self.name,
+                name,
+                description,
+                &to_labels(labels),
+                value.as_ptr(),
+            )
+        }
+        .map_err(to_error)?;
+        self.values.push(value.clone());
+        Ok(Gauge { value })
+    }
+
+    /// Registers a histogram with buckets ending at `bounds`, which must be increasing.
+    ///
+    /// Samples larger than the last bound are only counted in the total.
+    pub fn histogram(
+        &mut self,
+        name: &str,
+        description: &str,
+        labels: &[(&str, &str)],
+        bounds: &[f64],
+    ) -> Result<Histogram, MetricsError> {
+        assert!(
+            bounds.windows(2).all(|w| w[0] < w[1]),
+            "Histogram bounds must be increasing"
+        );
+        let data = Rc::new(HistogramData {
+            bounds: bounds.into(),
+            counts: (0..=bounds.len()).map(|_| Cell::new(0)).collect(),
+            count: Cell::new(0),
+            sum: Cell::new(0.0),
+        });
+        unsafe {
+            ffi::add_histogram(
+                self.inner.pin_mut(),
+                &self.name,
+                name,
+                description,
+                &to_labels(labels),
+                &data.bounds,
+                data.counts.as_ptr() as *const u64,
+                data.count.as_ptr(),
+                data.sum.as_ptr(),
+            )
+        }
+        .map_err(to_error)?;
+        self.values.push(data.clone());
+        Ok(Histogram { data })
+    }
+}
+
+/// A counter registered in a [`MetricGroup`].
+#[derive(Clone)]
+pub struct Counter {
+    value: Rc<Cell<u64>>,
+}
+
+impl Counter {
+    /// Increments the counter by one.
+    pub fn inc(&self) {
+        self.add(1);
+    }
+
+    /// Increments the counter by `n`.
+    pub fn add(&self, n: u64) {
+        self.value.set(self.value.get() + n);
+    }
+
+    /// Returns the value of the counter.
+    pub fn get(&self) -> u64 {
+        self.value.get()
+    }
+}
+
+/// A gauge registered in a [`MetricGroup`].
+#[derive(Clone)]
+pub struct Gauge {
+    value: Rc<Cell<f64>>,
+}
+
+impl Gauge {
+    /// Sets the gauge to `value`.
+    pub fn set(&self, value: f64) {
+        self.value.set(value);
+    }
+
+    /// Adds `delta` to the gauge.
+    pub fn add(&self, delta: f64) {
+        self.value.set(self.value.get() + delta);
+    }
+
+    /// Subtracts `delta` from the gauge.
+    pub fn sub(&self, delta: f64) {
+        self.value.set(self.value.get() - delta);
+    }
+
+    /// Returns the value of the gauge.
+    pub fn get(&self) -> f64 {
+        self.value.get()
+    }
+}
+
+struct HistogramData {
+    bounds: Box<[f64]>,
+    // One count per bucket, and one for samples above the last bound.
+    counts: Box<[Cell<u64>]>,
+    count: Cell<u64>,
+    sum: Cell<f64>,
+}
+
+/// A histogram registered in a [`MetricGroup`].
+#[derive(Clone)]
+pub struct Histogram {
+    data: Rc<HistogramData>,
+}
+
+impl Histogram {
+    /// Records a sample. Does not allocate.
+    pub fn record(&self, value: f64) {
+        let data = &self.data;
+        let bucket = data.bounds.partition_point(|&bound| bound < value);
+        let count = &data.counts[bucket];
+        count.set(count.get() + 1);
+        data.count.set(data.count.get() + 1);
+        data.sum.set(data.sum.get() + value);
+    }
+
+    /// Returns the number of samples.
+    pub fn count(&self) -> u64 {
+        self.data.count.get()
+    }
+
+    /// Returns the sum of the samples.
+    pub fn sum(&self) -> f64 {
+        self.data.sum.get()
+    }
+}
+
+/// Returns the value of the metric `name` on the current shard, e.g. `"reactor_polls"`.
+///
+/// The name is the full one, prefixed by the group name. The values of all
+/// label sets are summed up. Returns `None` if no such metric is registered
+/// or it is a histogram.
+pub fn read_metric(name: &str) -> Option<f64> {
+    crate::assert_runtime_is_running();
+    let mut value = 0.0;
+    ffi::read_metric(name, &mut value).then_some(value)
+}
+
+/// A snapshot of the built-in statistics of the current shard's reactor.
+#[derive(Clone, Debug, Default, PartialEq)]
+pub struct ReactorStats {
+    /// Tasks run by the scheduler.
+    pub tasks_processed: u64,
+    /// Reactor polls.
+    pub polls: u64,
+    /// I/O requests queued in the shard's I/O queues.
+    pub io_queue_length: u64,
+    /// Reactor stalls reported by the stall detector.
+    pub stalls: u64,
+    /// Cross-shard messages sent from this shard.
+    pub cross_shard_messages_sent: u64,
+    /// Cross-shard messages received by this shard.
+    pub cross_shard_messages_received: u64,
+    /// Memory freed on this shard but allocated on another one.
+    pub cross_shard_frees: u64,
+    /// Free memory in bytes.
+    pub free_memory: u64,
+    /// Allocated memory in bytes.
+    pub allocated_memory: u64,
+    /// Memory owned by the shard in bytes.
+    pub total_memory: u64,
+}
+
+impl ReactorStats {
+    /// Reads the statistics of the current shard.
+    ///
+    /// Statistics that Seastar only exposes as metrics are read from the
+    /// metrics registry, and are 0 when the corresponding metric is missing
+    /// (e.g. when the stall detector is disabled).
+    pub fn read() -> Self {
+        crate::assert_runtime_is_running();
+        let metric = |name| read_metric(name).unwrap_or(0.0) as u64;
+        ReactorStats {
+            tasks_processed: ffi::get_tasks_processed(),
+            polls: metric("reactor_polls"),
+            io_queue_length: metric("io_queue_queue_length"),
+            stalls: metric("stall_detector_reported"),
+            cross_shard_messages_sent: metric("smp_total_sent_messages"),
+            cross_shard_messages_received: metric("smp_total_received_messages"),
+            cross_shard_frees: ffi::get_cross_cpu_frees(),
+            free_memory: ffi::get_free_memory(),
+            allocated_memory: ffi::get_allocated_memory(),
+            total_memory: ffi::get_total_memory(),
+        }
+    }
+}
+
+/// An HTTP server exporting the metrics of all shards in the Prometheus format.
+///
+/// # Example
+///
+/// ```rust
+/// #[seastar::test]
+/// async fn prometheus_example() {
+///     let server = PrometheusServer::start("127.0.0.1:9180".parse().unwrap(), "seastar")
+///         .await
+///         .unwrap();
+///     // ... `curl http://127.0.0.1:9180/metrics` ...
+///     server.stop().await;
+/// }
+/// ```
+///
+/// Dropping the server stops it in the background. Outside of the runtime,
+/// where this is not possible, the server is leaked instead.
+pub struct PrometheusServer {
+    inner: Option<SharedPtr<ffi::prometheus_server>>,
+}
+
+impl PrometheusServer {
+    /// Starts the server on all shards, listening on `addr`.
+    ///
+    /// Metric names are exported prefixed by `prefix`.
+    pub async fn start(addr: SocketAddr, prefix: &str) -> Result<Self, MetricsError> {
+        crate::assert_runtime_is_running();
+        let inner = ffi::new_prometheus_server();
+        ffi::start_prometheus_server(&inner, &addr.ip().to_string(), addr.port(), prefix)
+            .await
+            .map_err(|err| MetricsError(err.what().to_string()))?;
+        Ok(PrometheusServer { inner: Some(inner) })
+    }
+
+    /// Stops the server.
+    pub async fn stop(mut self) {
+        let inner = self.inner.take().unwrap();
+        let _ = ffi::stop_prometheus_server(&inner).await;
+    }
+}
+
+impl Drop for PrometheusServer {
+    fn drop(&mut self) {
+        if let Some(inner) = self.inner.take() {
+            if !crate::engine_is_ready() {
+                // A running server must not be destroyed before it is stopped.
+                std::mem::forget(inner);
+                return;
+            }
+            crate::spawn_detached(async move {
+                let _ = ffi::stop_prometheus_server(&inner).await;
+            });
+        }
+    }
+}
+
+#[cfg(test)]
+mod tests {
+    use super::*;
+    use crate as seastar;
+
+    #[seastar::test]
+    async fn test_counter_and_gauge() {
+        let mut group = MetricGroup::new("test");
+        let counter = group
+            .counter("requests", "Requests", &[("kind", "a")])
+            .unwrap();
+        let other = group
+            .counter("requests", "Requests", &[("kind", "b")])
+            .unwrap();
+        let gauge = group.gauge("queue_length", "Queue length", &[]).unwrap();
+        assert!(group
+            .counter("requests", "Requests", &[("kind", "a")])
+            .is_err());
+
+        counter.add(2);
+        other.inc();
+        gauge.set(5.0);
+        gauge.sub(1.5);
+        assert_eq!(read_metric("test_requests"), Some(3.0));
+        assert_eq!(read_metric("test_queue_length"), Some(3.5));
+
+        drop(group);
+        assert_eq!(read_metric("test_requests"), None);
+        counter.inc();
+    }
+
+    #[seastar::test]
+    async fn test_histogram() {
+        let mut group = MetricGroup::new("test");
+        let histogram = group
+            .histogram("latency", "Latency", &[], &[1.0, 10.0, 100.0])
+            .unwrap();
+        for value in [0.5, 5.0, 50.0, 500.0] {
+            histogram.record(value);
+        }
+        assert_eq!(histogram.count(), 4);
+        assert_eq!(histogram.sum(), 555.5);
+        let counts: Vec<_> = histogram.data.counts.iter().map(Cell::get).collect();
+        assert_eq!(counts, [1, 1, 1, 1]);
+    }
+
+    #[seastar::test]
+    async fn test_reactor_stats() {
+        let before = ReactorStats::read();
+        crate::submit_to(1, || async {}).await;
+        let after = ReactorStats::read();
+        assert!(after.tasks_processed > before.tasks_processed);
+        assert!(after.total_memory > 0);
+        assert!(after.total_memory >= after.free_memory);
+    }
+}
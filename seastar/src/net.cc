@@ -0,0 +1,158 @@
+#include "net.hh"
+#include <seastar/core/seastar.hh>
+#include <sstream>
+
+namespace seastar_ffi {
+namespace net {
+
+static seastar::socket_address to_socket_address(rust::Str host, uint16_t port) {
+    return seastar::socket_address(seastar::net::inet_address(seastar::sstring(host.data(), host.size())), port);
+}
+
+static rust::String host_of(const seastar::socket_address& addr) {
+    std::ostringstream out;
+    out << addr.addr();
+    return rust::String(out.str());
+}
+
+static seastar::server_socket::load_balancing_algorithm to_lba(uint8_t lba) {
+    using algorithm = seastar::server_socket::load_balancing_algorithm;
+    switch (lba) {
+    case lba_port:
+        return algorithm::port;
+    case lba_fixed:
+        return algorithm::fixed;
+    default:
+        return algorithm::connection_distribution;
+    }
+}
+
+std::shared_ptr<server_socket> listen(rust::Str host, uint16_t port, bool reuse_address, uint8_t lba, uint32_t fixed_cpu) {
+    seastar::listen_options opts;
+    opts.reuse_address = reuse_address;
+    opts.lba = to_lba(lba);
+    opts.fixed_cpu = fixed_cpu;
+    return std::make_shared<server_socket>(seastar::listen(to_socket_address(host, port), opts));
+}
+
+rust::String get_local_host(const std::shared_ptr<server_socket>& ss) {
+    return host_of(ss->local_address());
+}
+
+uint16_t get_local_port(const std::shared_ptr<server_socket>& ss) {
+    return ss->local_address().port();
+}
+
+void abort_accept(const std::shared_ptr<server_socket>& ss) {
+    ss->abort_accept();
+}
+
+std::shared_ptr<connection> new_connection() {
+    return std::make_shared<connection>();
+}
+
+VoidFuture accept(const std::shared_ptr<server_socket>& ss, const std::shared_ptr<connection>& dst) {
+    auto s = ss;
+    auto d = dst;
+    auto ar = co_await s->accept();
+    d->socket = std::move(ar.connection);
+    d->remote = std::move(ar.remote_address);
+}
+
+VoidFuture connect(const std::shared_ptr<connection>& dst, rust::Str host, uint16_t port) {
+    auto d = dst;
+    auto addr = to_socket_address(host, port);
+    d->socket = co_await seastar::connect(addr);
+    d->remote = addr;
+}
+
+rust::String get_remote_host(const std::shared_ptr<connection>& conn) {
+    return host_of(conn->remote);
+}
+
+uint16_t get_remote_port(const std::shared_ptr<connection>& conn) {
+    return conn->remote.port();
+}
+
+rust::String get_local_host_of(const std::shared_ptr<connection>& conn) {
+    return host_of(conn->socket.local_address());
+}
+
+uint16_t get_local_port_of(const std::shared_ptr<connection>& conn) {
+    return conn->socket.local_address().port();
+}
+
+void set_nodelay(const std::shared_ptr<connection>& conn, bool nodelay) {
+    conn->socket.set_nodelay(nodelay);
+}
+
+bool get_nodelay(const std::shared_ptr<connection>& conn) {
+    return conn->socket.get_nodelay();
+}
+
+void set_keepalive(const std::shared_ptr<connection>& conn, bool keepalive) {
+    conn->socket.set_keepalive(keepalive);
+}
+
+bool get_keepalive(const std::shared_ptr<connection>& conn) {
+    return conn->socket.get_keepalive();
+}
+
+void set_keepalive_parameters(const std::shared_ptr<connection>& conn, uint64_t idle_s, uint64_t interval_s, uint32_t count) {
+    seastar::net::tcp_keepalive_params params;
+    params.idle = std::chrono::seconds(idle_s);
+    params.interval = std::chrono::seconds(interval_s);
+    params.count = count;
+    conn->socket.set_keepalive_parameters(params);
+}
+
+void shutdown_input(const std::shared_ptr<connection>& conn) {
+    conn->socket.shutdown_input();
+}
+
+void shutdown_output(const std::shared_ptr<connection>& conn) {
+    conn->socket.shutdown_output();
+}
+
+void open_input(const std::shared_ptr<connection>& conn) {
+    conn->in = conn->socket.input();
+}
+
+void open_output(const std::shared_ptr<connection>& conn, size_t buffer_size) {
+    conn->out = conn->socket.output(buffer_size);
+}
+
+VoidFuture read(const std::shared_ptr<connection>& conn) {
+    auto c = conn;
+    c->read_result = co_await c->in.read();
+}
+
+std::unique_ptr<buffer> take_read_result(const std::shared_ptr<connection>& conn) {
+    return std::make_unique<buffer>(std::move(conn->read_result));
+}
+
+// Only the zero-copy writes of output_stream are used, as they must not be
+// mixed with buffered ones. They are still batched: packets accumulate until
+// they fill the stream's buffer size, and only then are sent.
+VoidFuture write_buffer(const std::shared_ptr<connection>& conn, std::unique_ptr<buffer> buf) {
+    auto c = conn;
+    co_await c->out.write(std::move(*buf));
+}
+
+VoidFuture write_packet(const std::shared_ptr<connection>& conn, std::unique_ptr<packet> p) {
+    auto c = conn;
+    co_await c->out.write(std::move(*p));
+}
+
+VoidFuture flush(const std::shared_ptr<connection>& conn) {
+    auto c = conn;
+    co_await c->out.flush();
+}
+
+VoidFuture close_output(const std::shared_ptr<connection>& conn) {
+    auto c = conn;
+    co_await c->out.close();
+}
+
+} // namespace net
+} // namespace seastar_ffi
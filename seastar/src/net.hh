@@ -0,0 +1,86 @@
+#pragma once
+
+#include "cxx_async_futures.hh"
+#include "packet.hh"
+#include "temporary_buffer.hh"
+#include <seastar/net/api.hh>
+
+namespace seastar_ffi {
+namespace net {
+
+using server_socket = seastar::server_socket;
+using buffer = seastar_ffi::temporary_buffer::buffer;
+using packet = seastar_ffi::packet::packet;
+
+// A connected socket together with its streams, shared between
+// the Rust handles and the operations in flight.
+struct connection {
+    seastar::connected_socket socket;
+    seastar::socket_address remote;
+    seastar::input_stream<char> in;
+    seastar::output_stream<char> out;
+    seastar::temporary_buffer<char> read_result;
+};
+
+// Must match `LoadBalancingAlgorithm` in net.rs.
+constexpr uint8_t lba_connection_distribution = 0;
+constexpr uint8_t lba_port = 1;
+constexpr uint8_t lba_fixed = 2;
+
+std::shared_ptr<server_socket> listen(rust::Str host, uint16_t port, bool reuse_address, uint8_t lba, uint32_t fixed_cpu);
+
+rust::String get_local_host(const std::shared_ptr<server_socket>& ss);
+
+uint16_t get_local_port(const std::shared_ptr<server_socket>& ss);
+
+void abort_accept(const std::shared_ptr<server_socket>& ss);
+
+std::shared_ptr<connection> new_connection();
+
+// Asynchronous functions copy the shared pointers before suspending,
+// so they are safe to abandon on the Rust side.
+
+VoidFuture accept(const std::shared_ptr<server_socket>& ss, const std::shared_ptr<connection>& dst);
+
+VoidFuture connect(const std::shared_ptr<connection>& dst, rust::Str host, uint16_t port);
+
+rust::String get_remote_host(const std::shared_ptr<connection>& conn);
+
+uint16_t get_remote_port(const std::shared_ptr<connection>& conn);
+
+rust::String get_local_host_of(const std::shared_ptr<connection>& conn);
+
+uint16_t get_local_port_of(const std::shared_ptr<connection>& conn);
+
+void set_nodelay(const std::shared_ptr<connection>& conn, bool nodelay);
+
+bool get_nodelay(const std::shared_ptr<connection>& conn);
+
+void set_keepalive(const std::shared_ptr<connection>& conn, bool keepalive);
+
+bool get_keepalive(const std::shared_ptr<connection>& conn);
+
+void set_keepalive_parameters(const std::shared_ptr<connection>& conn, uint64_t idle_s, uint64_t interval_s, uint32_t count);
+
+void shutdown_input(const std::shared_ptr<connection>& conn);
+
+void shutdown_output(const std::shared_ptr<connection>& conn);
+
+void open_input(const std::shared_ptr<connection>& conn);
+
+void open_output(const std::shared_ptr<connection>& conn, size_t buffer_size);
+
+VoidFuture read(const std::shared_ptr<connection>& conn);
+
+std::unique_ptr<buffer> take_read_result(const std::shared_ptr<connection>& conn);
+
+VoidFuture write_buffer(const std::shared_ptr<connection>& conn, std::unique_ptr<buffer> buf);
+
+VoidFuture write_packet(const std::shared_ptr<connection>& conn, std::unique_ptr<packet> p);
+
+VoidFuture flush(const std::shared_ptr<connection>& conn);
+
+VoidFuture close_output(const std::shared_ptr<connection>& conn);
+
+} // namespace net
+} // namespace seastar_ffi
@@ -0,0 +1,791 @@
+use crate::cxx_async_futures::VoidFuture;
+use crate::temporary_buffer::ShareToken;
+use crate::{spawn_detached, AbortSource, AbortSubscription, Packet, TemporaryBuffer};
+use cxx::SharedPtr;
+use futures::io::{AsyncRead, AsyncWrite};
+use futures::ready;
+use std::cell::Cell;
+use std::future::{poll_fn, Future};
+use std::io;
+use std::net::{IpAddr, SocketAddr};
+use std::pin::Pin;
+use std::task::{Context, Poll};
+use std::time::Duration;
+use thiserror::Error;
+
+#[cxx::bridge]
+mod ffi {
+    #[namespace = "seastar_ffi"]
+    unsafe extern "C++" {
+        type VoidFuture = crate::cxx_async_futures::VoidFuture;
+    }
+
+    #[namespace = "seastar_ffi::temporary_buffer"]
+    unsafe extern "C++" {
+        type buffer = crate::temporary_buffer::buffer;
+    }
+
+    #[namespace = "seastar_ffi::packet"]
+    unsafe extern "C++" {
+        type packet = crate::packet::packet;
+    }
+
+    #[namespace = "seastar_ffi::net"]
+    unsafe extern "C++" {
+        include!("seastar/src/net.hh");
+
+        type server_socket;
+        type connection;
+
+        fn listen(
+            host: &str,
+            port: u16,
+            reuse_address: bool,
+            lba: u8,
+            fixed_cpu: u32,
+        ) -> Result<SharedPtr<server_socket>>;
+        fn get_local_host(ss: &SharedPtr<server_socket>) -> String;
+        fn get_local_port(ss: &SharedPtr<server_socket>) -> u16;
+        fn abort_accept(ss: &SharedPtr<server_socket>);
+
+        fn new_connection() -> SharedPtr<connection>;
+        fn accept(ss: &SharedPtr<server_socket>, dst: &SharedPtr<connection>) -> VoidFuture;
+        fn connect(dst: &SharedPtr<connection>, host: &str, port: u16) -> VoidFuture;
+        fn get_remote_host(conn: &SharedPtr<connection>) -> String;
+        fn get_remote_port(conn: &SharedPtr<connection>) -> u16;
+        fn get_local_host_of(conn: &SharedPtr<connection>) -> String;
+        fn get_local_port_of(conn: &SharedPtr<connection>) -> u16;
+        fn set_nodelay(conn: &SharedPtr<connection>, nodelay: bool);
+        fn get_nodelay(conn: &SharedPtr<connection>) -> bool;
+        fn set_keepalive(conn: &SharedPtr<connection>, keepalive: bool);
+        fn get_keepalive(conn: &SharedPtr<connection>) -> bool;
+        fn set_keepalive_parameters(
+            conn: &SharedPtr<connection>,
+            idle_s: u64,
+            interval_s: u64,
+            count: u32,
+        );
+        fn shutdown_input(conn: &SharedPtr<connection>);
+        fn shutdown_output(conn: &SharedPtr<connection>);
+
+        fn open_input(conn: &SharedPtr<connection>);
+        fn open_output(conn: &SharedPtr<connection>, buffer_size: usize);
+        fn read(conn: &SharedPtr<connection>) -> VoidFuture;
+        fn take_read_result(conn: &SharedPtr<connection>) -> UniquePtr<buffer>;
+        fn write_buffer(conn: &SharedPtr<connection>, buf: UniquePtr<buffer>) -> VoidFuture;
+        fn write_packet(conn: &SharedPtr<connection>, p: UniquePtr<packet>) -> VoidFuture;
+        fn flush(conn: &SharedPtr<connection>) -> VoidFuture;
+        fn close_output(conn: &SharedPtr<connection>) -> VoidFuture;
+    }
+}
+
+/// Error returned when listening, accepting or connecting fails.
+#[derive(Error, Debug)]
+#[error("NetError: {0}")]
+pub struct NetError(String);
+
+fn io_error(err: cxx_async::CxxAsyncException) -> io::Error {
+    io::Error::new(io::ErrorKind::Other, err.what().to_string())
+}
+
+fn to_socket_addr(host: String, port: u16) -> SocketAddr {
+    let ip: IpAddr = host.parse().expect("Seastar returned an invalid address");
+    SocketAddr::new(ip, port)
+}
+
+/// Decides which shard handles a connection accepted by a [`ServerSocket`].
+///
+/// Applies when all shards listen on the same address.
+#[derive(Clone, Copy, Debug, Default, PartialEq, Eq)]
+pub enum LoadBalancingAlgorithm {
+    /// Balances the number of connections across shards.
+    #[default]
+    ConnectionDistribution,
+    /// Picks the shard from the client's port (`port % smp_count`), so a client
+    /// can choose its shard. Used together with `SO_REUSEPORT`-style clients.
+    Port,
+    /// Delivers all connections to the given shard.
+    Fixed(u32),
+}
+
+// Must match the constants in net.hh.
+impl LoadBalancingAlgorithm {
+    fn to_ffi(self) -> (u8, u32) {
+        match self {
+            LoadBalancingAlgorithm::ConnectionDistribution => (0, 0),
+            LoadBalancingAlgorithm::Port => (1, 0),
+            LoadBalancingAlgorithm::Fixed(shard) => (2, shard),
+        }
+    }
+}
+
+/// Options for [`listen`].
+#[derive(Clone, Copy, Debug, Default)]
+pub struct ListenOptions {
+    /// Sets `SO_REUSEADDR` on the listening socket.
+    pub reuse_address: bool,
+    /// How accepted connections are assigned to shards.
+    pub lba: LoadBalancingAlgorithm,
+}
+
+/// A listening socket, returned by [`listen`].
+pub struct ServerSocket {
+    inner: SharedPtr<ffi::server_socket>,
+}
+
+/// Listens for TCP connections on `addr`.
+///
+/// To accept connections on all shards, call it on every shard (e.g. with
+/// [`invoke_on_all`](crate::invoke_on_all)) with the same address; incoming
+/// connections are then distributed according to [`ListenOptions::lba`].
+///
+/// # Example
+///
+/// ```rust
+/// #[seastar::test]
+/// async fn echo_server_example() {
+///     let server = listen("127.0.0.1:0".parse().unwrap(), ListenOptions::default()).unwrap();
+///     let (socket, _) = server.accept().await.unwrap();
+///     let (mut input, mut output) = (socket.input(), socket.output());
+///     futures::io::copy(&mut input, &mut output).await.unwrap();
+///     output.close().await.unwrap();
+/// }
+/// ```
+pub fn listen(addr: SocketAddr, opts: ListenOptions) -> Result<ServerSocket, NetError> {
+    crate::assert_runtime_is_running();
+    let (lba, fixed_cpu) = opts.lba.to_ffi();
+    match ffi::listen(
+        &addr.ip().to_string(),
+        addr.port(),
+        opts.reuse_address,
+        lba,
+        fixed_cpu,
+    ) {
+        Ok(inner) => Ok(ServerSocket { inner }),
+        Err(err) => Err(NetError(err.what().to_string())),
+    }
+}
+
+impl ServerSocket {
+    /// Waits for the next connection.
+    ///
+    /// Returns the connected socket and the address of the peer.
+    pub async fn accept(&self) -> Result<(ConnectedSocket, SocketAddr), NetError> {
+        let conn = ffi::new_connection();
+        if let Err(err) = ffi::accept(&self.inner, &conn).await {
+            return Err(NetError(err.what().to_string()));
+        }
+        let socket = ConnectedSocket::new(conn);
+        let remote = socket.remote_address();
+        Ok((socket, remote))
+    }
+
+    /// Makes pending and future [`accept`](ServerSocket::accept)s fail.
+    pub fn abort_accept(&self) {
+        ffi::abort_accept(&self.inner);
+    }
+
+    /// Makes pending and future [`accept`](ServerSocket::accept)s fail when
+    /// an abort is requested on `abort`, unless the returned subscription is
+    /// dropped first. Returns `None`, and aborts right away, if an abort was
+    /// already requested.
+    pub fn abort_accept_on(&self, abort: &AbortSource) -> Option<AbortSubscription> {
+        let inner = self.inner.clone();
+        let subscription = abort.subscribe(move || ffi::abort_accept(&inner));
+        if subscription.is_none() {
+            self.abort_accept();
+        }
+        subscription
+    }
+
+    /// Returns the address the socket listens on.
+    pub fn local_address(&self) -> SocketAddr {
+        to_socket_addr(
+            ffi::get_local_host(&self.inner),
+            ffi::get_local_port(&self.inner),
+        )
+    }
+}
+
+/// Connects to `addr` over TCP.
+pub async fn connect(addr: SocketAddr) -> Result<ConnectedSocket, NetError> {
+    crate::assert_runtime_is_running();
+    let conn = ffi::new_connection();
+    if let Err(err) = ffi::connect(&conn, &addr.ip().to_string(), addr.port()).await {
+        return Err(NetError(err.what().to_string()));
+    }
+    Ok(ConnectedSocket::new(conn))
+}
+
+/// Default buffer size of an [`OutputStream`], i.e. how many bytes are
+/// collected before they are sent.
+pub const DEFAULT_OUTPUT_BUFFER_SIZE: usize = 8192;
+
+/// A TCP connection.
+///
+/// Data is read through its [`InputStream`] and written through its
+/// [`OutputStream`], each of which can be obtained once.
+/// A `ConnectedSocket` and its streams must stay on the shard
+/// that created them.
+pub struct ConnectedSocket {
+    conn: SharedPtr<ffi::connection>,
+    input_taken: Cell<bool>,
+    output_taken: Cell<bool>,
+}
+
+impl ConnectedSocket {
+    fn new(conn: SharedPtr<ffi::connection>) -> Self {
+        ConnectedSocket {
+            conn,
+            input_taken: Cell::new(false),
+            output_taken: Cell::new(false),
+        }
+    }
+
+    /// Returns the stream for reading from the connection.
+    ///
+    /// Panics if called more than once.
+    pub fn input(&self) -> InputStream {
+        assert!(!self.input_taken.replace(true), "Input already taken");
+        ffi::open_input(&self.conn);
+        InputStream {
+            conn: self.conn.clone(),
+            pending: None,
+            buffered: None,
+            eof: false,
+        }
+    }
+
+    /// Returns the stream for writing to the connection,
+    /// which sends data in batches of [`DEFAULT_OUTPUT_BUFFER_SIZE`] bytes.
+    ///
+    /// Panics if called more than once.
+    pub fn output(&self) -> OutputStream {
+        self.output_with_buffer_size(DEFAULT_OUTPUT_BUFFER_SIZE)
+    }
+
+    /// Same as [`output`](ConnectedSocket::output), but data is sent
+    /// in batches of `buffer_size` bytes, e.g. a multiple of the segment size.
+    ///
+    /// Panics if called more than once.
+    pub fn output_with_buffer_size(&self, buffer_size: usize) -> OutputStream {
+        assert!(buffer_size > 0, "Buffer size must be positive");
+        assert!(!self.output_taken.replace(true), "Output already taken");
+        ffi::open_output(&self.conn, buffer_size);
+        OutputStream {
+            conn: self.conn.clone(),
+            buffer_size,
+            staging: None,
+            staged: 0,
+            pending: None,
+            unflushed: false,
+            in_flight: Vec::new(),
+            flushing: None,
+            state: OutputState::Open,
+        }
+    }
+
+    /// Returns the address of the peer.
+    pub fn remote_address(&self) -> SocketAddr {
+        to_socket_addr(
+            ffi::get_remote_host(&self.conn),
+            ffi::get_remote_port(&self.conn),
+        )
+    }
+
+    /// Returns the local address of the connection.
+    pub fn local_address(&self) -> SocketAddr {
+        to_socket_addr(
+            ffi::get_local_host_of(&self.conn),
+            ffi::get_local_port_of(&self.conn),
+        )
+    }
+
+    /// Disables (or enables) Nagle's algorithm (`TCP_NODELAY`).
+    pub fn set_nodelay(&self, nodelay: bool) {
+        ffi::set_nodelay(&self.conn, nodelay);
+    }
+
+    /// Checks whether Nagle's algorithm is disabled.
+    pub fn get_nodelay(&self) -> bool {
+        ffi::get_nodelay(&self.conn)
+    }
+
+    /// Enables (or disables) TCP keepalive (`SO_KEEPALIVE`).
+    pub fn set_keepalive(&self, keepalive: bool) {
+        ffi::set_keepalive(&self.conn, keepalive);
+    }
+
+    /// Checks whether TCP keepalive is enabled.
+    pub fn get_keepalive(&self) -> bool {
+        ffi::get_keepalive(&self.conn)
+    }
+
+    /// Sets the idle time before the first keepalive probe, the interval
+    /// between probes, and the number of unanswered probes before the
+    /// connection is dropped. Times are rounded down to seconds.
+    pub fn set_keepalive_parameters(&self, idle: Duration, interval: Duration, count: u32) {
+        ffi::set_keepalive_parameters(&self.conn, idle.as_secs(), interval.as_secs(), count);
+    }
+
+    /// Shuts the reading side of the connection down, ending pending reads.
+    pub fn shutdown_input(&self) {
+        ffi::shutdown_input(&self.conn);
+    }
+
+    /// Shuts the writing side of the connection down, failing pending writes.
+    pub fn shutdown_output(&self) {
+        ffi::shutdown_output(&self.conn);
+    }
+
+    /// Shuts both sides of the connection down when an abort is requested
+    /// on `abort`, unless the returned subscription is dropped first.
+    /// Returns `None`, and shuts down right away, if an abort was already
+    /// requested.
+    ///
+    /// This is how reads and writes are aborted: dropping their futures
+    /// only abandons them, the operations stay pending in the reactor
+    /// until they complete.
+    pub fn shutdown_on(&self, abort: &AbortSource) -> Option<AbortSubscription> {
+        let conn = self.conn.clone();
+        let subscription = abort.subscribe(move || {
+            ffi::shutdown_input(&conn);
+            ffi::shutdown_output(&conn);
+        });
+        if subscription.is_none() {
+            self.shutdown_input();
+            self.shutdown_output();
+        }
+        subscription
+    }
+}
+
+fn poll_pending(pending: &mut Option<VoidFuture>, cx: &mut Context<'_>) -> Poll<io::Result<()>> {
+    match pending {
+        None => Poll::Ready(Ok(())),
+        Some(future) => {
+            let ret = ready!(Pin::new(future).poll(cx));
+            *pending = None;
+            Poll::Ready(ret.map_err(io_error))
+        }
+    }
+}
+
+/// The reading side of a [`ConnectedSocket`].
+///
+/// Read data either without copying, as [`TemporaryBuffer`]s, with
+/// [`read`](InputStream::read), or through [`AsyncRead`].
+/// A read that is abandoned half-way is resumed by the next one,
+/// so no data is lost.
+pub struct InputStream {
+    conn: SharedPtr<ffi::connection>,
+    pending: Option<VoidFuture>,
+    buffered: Option<TemporaryBuffer>,
+    eof: bool,
+}
+
+impl InputStream {
+    fn poll_buffer(&mut self, cx: &mut Context<'_>) -> Poll<io::Result<TemporaryBuffer>> {
+        if let Some(buf) = self.buffered.take() {
+            return Poll::Ready(Ok(buf));
+        }
+        if self.eof {
+            return Poll::Ready(Ok(TemporaryBuffer::new(0)));
+        }
+        if self.pending.is_none() {
+            self.pending = Some(ffi::read(&self.conn));
+        }
+        ready!(poll_pending(&mut self.pending, cx))?;
+        let buf = TemporaryBuffer::from_cpp_shared(ffi::take_read_result(&self.conn));
+        self.eof = buf.is_empty();
+        Poll::Ready(Ok(buf))
+    }
+
+    /// Returns the next chunk of data, as received, without copying it.
+    ///
+    /// An empty buffer means that the peer has closed the connection.
+    pub async fn read(&mut self) -> io::Result<TemporaryBuffer> {
+        poll_fn(|cx| self.poll_buffer(cx)).await
+    }
+}
+
+impl AsyncRead for InputStream {
+    fn poll_read(
+        self: Pin<&mut Self>,
+        cx: &mut Context<'_>,
+        buf: &mut [u8],
+    ) -> Poll<io::Result<usize>> {
+        let this = self.get_mut();
+        let mut data = ready!(this.poll_buffer(cx))?;
+        let n = data.len().min(buf.len());
+        buf[..n].copy_from_slice(&data[..n]);
+        if n < data.len() {
+            data.trim_front(n);
+            this.buffered = Some(data);
+        }
+        Poll::Ready(Ok(n))
+    }
+}
+
+#[derive(Clone, Copy, PartialEq, Eq)]
+enum OutputState {
+    Open,
+    Closing,
+    Closed,
+}
+
+/// The writing side of a [`ConnectedSocket`].
+///
+/// Data is collected until it fills the buffer size of the stream, and only
+/// then sent, so small writes do not produce small segments. Use
+/// [`flush`](futures::AsyncWriteExt::flush) to send a partial batch.
+///
+/// Data can be written without copying, with [`write_buffer`](OutputStream::write_buffer)
+/// and [`write_packet`](OutputStream::write_packet), or through [`AsyncWrite`],
+/// which copies it once into a buffer of the stream.
+///
+/// The stream should be [`close`](futures::AsyncWriteExt::close)d when no
+/// longer needed. If it is dropped instead, the remaining data is sent
+/// and the stream is closed in the background. Outside of the runtime,
+/// where this is not possible, the connection is leaked instead.
+pub struct OutputStream {
+    conn: SharedPtr<ffi::connection>,
+    buffer_size: usize,
+    staging: Option<TemporaryBuffer>,
+    staged: usize,
+    pending: Option<VoidFuture>,
+    // Whether data was handed over to the C++ stream since the last flush
+    // was started.
+    unflushed: bool,
+    // Tokens of the buffers written without copying since the last flush
+    // was started. The C++ stream may hold on to them until it is flushed,
+    // so the other views of their memory stay read-only until then.
+    in_flight: Vec<ShareToken>,
+    // Set while `pending` is a flush, with the tokens of the buffers it covers.
+    flushing: Option<Vec<ShareToken>>,
+    state: OutputState,
+}
+
+impl OutputStream {
+    fn assert_open(&self) {
+        assert!(self.state == OutputState::Open, "Output stream closed");
+    }
+
+    /// Waits for the pending operation, if any. A flush that succeeds
+    /// releases the buffers it covers.
+    fn poll_idle(&mut self, cx: &mut Context<'_>) -> Poll<io::Result<()>> {
+        let ret = ready!(poll_pending(&mut self.pending, cx));
+        if let Some(tokens) = self.flushing.take() {
+            if ret.is_err() {
+                self.in_flight.extend(tokens);
+            }
+        }
+        Poll::Ready(ret)
+    }
+
+    fn submit_staged(&mut self) {
+        if let Some(mut staging) = self.staging.take() {
+            staging.trim(self.staged);
+            self.staged = 0;
+            let (staging, token) = staging.into_cpp();
+            self.in_flight.extend(token);
+            self.pending = Some(ffi::write_buffer(&self.conn, staging));
+            self.unflushed = true;
+        }
+    }
+
+    async fn write_zero_copy(
+        &mut self,
+        start: impl FnOnce(&SharedPtr<ffi::connection>) -> VoidFuture,
+    ) -> io::Result<()> {
+        self.assert_open();
+        poll_fn(|cx| self.poll_idle(cx)).await?;
+        self.submit_staged();
+        poll_fn(|cx| self.poll_idle(cx)).await?;
+        self.pending = Some(start(&self.conn));
+        self.unflushed = true;
+        poll_fn(|cx| self.poll_idle(cx)).await
+    }
+
+    /// Writes `buf` without copying it.
+    pub async fn write_buffer(&mut self, buf: TemporaryBuffer) -> io::Result<()> {
+        let (buf, token) = buf.into_cpp();
+        self.in_flight.extend(token);
+        self.write_zero_copy(|conn| ffi::write_buffer(conn, buf))
+            .await
+    }
+
+    /// Writes all fragments of `packet` without copying them.
+    pub async fn write_packet(&mut self, packet: Packet) -> io::Result<()> {
+        let (packet, tokens) = packet.into_cpp();
+        self.in_flight.extend(tokens);
+        self.write_zero_copy(|conn| ffi::write_packet(conn, packet))
+            .await
+    }
+}
+
+impl AsyncWrite for OutputStream {
+    fn poll_write(
+        self: Pin<&mut Self>,
+        cx: &mut Context<'_>,
+        buf: &[u8],
+    ) -> Poll<io::Result<usize>> {
+        let this = self.get_mut();
+        this.assert_open();
+        loop {
+            ready!(this.poll_idle(cx))?;
+            if this.staged < this.buffer_size {
+                break;
+            }
+            this.submit_staged();
+        }
+        let staging = this
+            .staging
+            .get_or_insert_with(|| TemporaryBuffer::new(this.buffer_size));
+        let n = buf.len().min(this.buffer_size - this.staged);
+        staging[this.staged..this.staged + n].copy_from_slice(&buf[..n]);
+        this.staged += n;
+        Poll::Ready(Ok(n))
+    }
+
+    fn poll_flush(self: Pin<&mut Self>, cx: &mut Context<'_>) -> Poll<io::Result<()>> {
+        let this = self.get_mut();
+        this.assert_open();
+        // Every step leaves the stream consistent, so a flush that is
+        // dropped half-way is completed by the next one.
+        ready!(this.poll_idle(cx))?;
+        this.submit_staged();
+        ready!(this.poll_idle(cx))?;
+        if this.unflushed {
+            this.unflushed = false;
+            this.flushing = Some(std::mem::take(&mut this.in_flight));
+            this.pending = Some(ffi::flush(&this.conn));
+            ready!(this.poll_idle(cx))?;
+        }
+        Poll::Ready(Ok(()))
+    }
+
+    fn poll_close(self: Pin<&mut Self>, cx: &mut Context<'_>) -> Poll<io::Result<()>> {
+        let this = self.get_mut();
+        if this.state == OutputState::Closed {
+            return Poll::Ready(Ok(()));
+        }
+        if this.state == OutputState::Open {
+            ready!(Pin::new(&mut *this).poll_flush(cx))?;
+            this.pending = Some(ffi::close_output(&this.conn));
+            this.state = OutputState::Closing;
+        }
+        ready!(poll_pending(&mut this.pending, cx))?;
+        this.in_flight.clear();
+        this.state = OutputState::Closed;
+        Poll::Ready(Ok(()))
+    }
+}
+
+impl Drop for OutputStream {
+    fn drop(&mut self) {
+        // C++ requires output streams to be closed before they are destroyed.
+        if self.state == OutputState::Closed {
+            return;
+        }
+        if !crate::engine_is_ready() {
+            // Closing needs the runtime; the C++ stream must not be
+            // destroyed unclosed, so the connection is leaked.
+            std::mem::forget(self.conn.clone());
+            std::mem::forget(self.staging.take());
+            std::mem::forget(self.pending.take());
+            self.state = OutputState::Closed;
+            return;
+        }
+        let mut stream = OutputStream {
+            conn: self.conn.clone(),
+            buffer_size: self.buffer_size,
+            staging: self.staging.take(),
+            staged: self.staged,
+            pending: self.pending.take(),
+            unflushed: self.unflushed,
+            in_flight: std::mem::take(&mut self.in_flight),
+            flushing: self.flushing.take(),
+            state: self.state,
+        };
+        self.state = OutputState::Closed;
+        spawn_detached(async move {
+            let _ = futures::AsyncWriteExt::close(&mut stream).await;
+            stream.state = OutputState::Closed;
+        });
+    }
+}
+
+#[cfg(test)]
+mod tests {
+    use super::*;
+    use crate as seastar;
+    use crate::this_shard_id;
+    use futures::{join, AsyncReadExt, AsyncWriteExt};
+
+    fn local_listener() -> ServerSocket {
+        let opts = ListenOptions {
+            reuse_address: true,
+            lba: LoadBalancingAlgorithm::Fixed(this_shard_id()),
+        };
+        listen("127.0.0.1:0".parse().unwrap(), opts).unwrap()
+    }
+
+    #[seastar::test]
+    async fn test_tcp_echo() {
+        let server = local_listener();
+        let addr = server.local_address();
+
+        let serve = async {
+            let (socket, _) = server.accept().await.unwrap();
+            let (mut input, mut output) = (socket.input(), socket.output());
+            let mut request = [0; 5];
+            input.read_exact(&mut request).await.unwrap();
+            output.write_all(&request).await.unwrap();
+            output.close().await.unwrap();
+        };
+        let client = async {
+            let socket = connect(addr).await.unwrap();
+            socket.set_nodelay(true);
+            assert!(socket.get_nodelay());
+            let (mut input, mut output) = (socket.input(), socket.output());
+            output.write_all(b"hello").await.unwrap();
+            output.flush().await.unwrap();
+            let mut response = Vec::new();
+            input.read_to_end(&mut response).await.unwrap();
+            output.close().await.unwrap();
+            response
+        };
+
+        let ((), response) = join!(serve, client);
+        assert_eq!(response, b"hello");
+    }
+
+    #[seastar::test]
+    async fn test_tcp_zero_copy() {
+        let server = local_listener();
+        let addr = server.local_address();
+
+        let serve = async {
+            let (socket, remote) = server.accept().await.unwrap();
+            assert!(remote.ip().is_loopback());
+            let mut output = socket.output();
+            let mut packet = Packet::from(TemporaryBuffer::copy_of(b"head"));
+            packet.append(TemporaryBuffer::copy_of(b"er"));
+            output.write_packet(packet).await.unwrap();
+            let mut body = TemporaryBuffer::copy_of(b"body");
+            output.write_buffer(body.share()).await.unwrap();
+            // The stream may still hold the written view until it is flushed.
+            assert!(body.get_mut().is_none());
+            output.flush().await.unwrap();
+            assert!(body.get_mut().is_some());
+            output.close().await.unwrap();
+        };
+        let client = async {
+            let socket = connect(addr).await.unwrap();
+            assert_eq!(socket.remote_address(), addr);
+            let mut input = socket.input();
+            let mut received = Vec::new();
+            loop {
+                let mut buf = input.read().await.unwrap();
+                if buf.is_empty() {
+                    break;
+                }
+                // The input stream may still share the memory.
+                assert!(buf.get_mut().is_none());
+                received.extend_from_slice(&buf);
+            }
+            socket.output().close().await.unwrap();
+            received
+        };
+
+        let ((), received) = join!(serve, client);
+        assert_eq!(received, b"headerbody");
+    }
+
+    #[seastar::test]
+    async fn test_tcp_dropped_flush() {
+        let server = local_listener();
+        let addr = server.local_address();
+
+        let serve = async {
+            let (socket, _) = server.accept().await.unwrap();
+            let mut output = socket.output();
+            output.write_all(b"first").await.unwrap();
+            {
+                let mut flush = output.flush();
+                let _ = futures::poll!(&mut flush);
+            }
+            output.write_all(b" second").await.unwrap();
+            output.flush().await.unwrap();
+            output.close().await.unwrap();
+        };
+        let client = async {
+            let socket = connect(addr).await.unwrap();
+            let mut received = Vec::new();
+            socket.input().read_to_end(&mut received).await.unwrap();
+            socket.output().close().await.unwrap();
+            received
+        };
+
+        let ((), received) = join!(serve, client);
+        assert_eq!(received, b"first second");
+    }
+
+    #[seastar::test]
+    async fn test_output_stream_rejects_writes_when_closing() {
+        let server = local_listener();
+        let addr = server.local_address();
+        let (accepted, socket) = join!(server.accept(), connect(addr));
+        let (_peer, socket) = (accepted.unwrap(), socket.unwrap());
+        let mut output = socket.output();
+        {
+            let mut close = output.close();
+            let _ = futures::poll!(&mut close);
+        }
+        let write = std::panic::catch_unwind(std::panic::AssertUnwindSafe(|| {
+            let mut cx = Context::from_waker(futures::task::noop_waker_ref());
+            let _ = Pin::new(&mut output).poll_write(&mut cx, b"late");
+        }));
+        assert!(write.is_err());
+        output.close().await.unwrap();
+    }
+
+    #[seastar::test]
+    async fn test_tcp_keepalive() {
+        let server = local_listener();
+        let addr = server.local_address();
+        let (accepted, socket) = join!(server.accept(), connect(addr));
+        let socket = socket.unwrap();
+        socket.set_keepalive(true);
+        assert!(socket.get_keepalive());
+        socket.set_keepalive_parameters(Duration::from_secs(60), Duration::from_secs(10), 3);
+        drop(accepted.unwrap());
+    }
+
+    #[seastar::test]
+    async fn test_abort_accept() {
+        let server = local_listener();
+        server.abort_accept();
+        assert!(server.accept().await.is_err());
+    }
+
+    #[seastar::test]
+    async fn test_abort_io() {
+        let server = local_listener();
+        let abort = AbortSource::new();
+        let _accept_subscription = server.abort_accept_on(&abort);
+        let (accepted, socket) = join!(server.accept(), connect(server.local_address()));
+        let (_peer, socket) = (accepted.unwrap(), socket.unwrap());
+        let _subscription = socket.shutdown_on(&abort);
+        let mut input = socket.input();
+        let read = input.read();
+        let request = async {
+            crate::sleep(Duration::from_millis(1)).await;
+            abort.request_abort();
+        };
+        let (read, ()) = join!(read, request);
+        assert!(read.map_or(true, |buf| buf.is_empty()));
+        assert!(server.accept().await.is_err());
+    }
+}
@@ -0,0 +1,45 @@
+#include "packet.hh"
+
+namespace seastar_ffi {
+namespace packet {
+
+std::unique_ptr<packet> new_packet() {
+    return std::make_unique<packet>();
+}
+
+std::unique_ptr<packet> packet_from_buffer(std::unique_ptr<buffer> buf) {
+    return std::make_unique<packet>(std::move(*buf));
+}
+
+void append_buffer(packet& p, std::unique_ptr<buffer> buf) {
+    p = packet(std::move(p), std::move(*buf));
+}
+
+// Sharing only touches the packet's deleter, never its contents.
+std::unique_ptr<packet> share(const packet& p) {
+    return std::make_unique<packet>(const_cast<packet&>(p).share());
+}
+
+size_t get_len(const packet& p) {
+    return p.len();
+}
+
+size_t get_nr_frags(const packet& p) {
+    return p.nr_frags();
+}
+
+rust::Slice<const uint8_t> get_fragment(const packet& p, size_t index) {
+    const auto& frag = const_cast<packet&>(p).frag(index);
+    return {reinterpret_cast<const uint8_t*>(frag.base), frag.size};
+}
+
+void trim_front(packet& p, size_t how_much) {
+    p.trim_front(how_much);
+}
+
+void trim_back(packet& p, size_t how_much) {
+    p.trim_back(how_much);
+}
+
+} // namespace packet
+} // namespace seastar_ffi
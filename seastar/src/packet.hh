@@ -0,0 +1,31 @@
+#pragma once
+
+#include "temporary_buffer.hh"
+#include <seastar/net/packet.hh>
+
+namespace seastar_ffi {
+namespace packet {
+
+using packet = seastar::net::packet;
+using buffer = seastar_ffi::temporary_buffer::buffer;
+
+std::unique_ptr<packet> new_packet();
+
+std::unique_ptr<packet> packet_from_buffer(std::unique_ptr<buffer> buf);
+
+void append_buffer(packet& p, std::unique_ptr<buffer> buf);
+
+std::unique_ptr<packet> share(const packet& p);
+
+size_t get_len(const packet& p);
+
+size_t get_nr_frags(const packet& p);
+
+rust::Slice<const uint8_t> get_fragment(const packet& p, size_t index);
+
+void trim_front(packet& p, size_t how_much);
+
+void trim_back(packet& p, size_t how_much);
+
+} // namespace packet
+} // namespace seastar_ffi
@@ -0,0 +1,219 @@
+use crate::temporary_buffer::ShareToken;
+use crate::TemporaryBuffer;
+use cxx::UniquePtr;
+use std::iter::FusedIterator;
+
+#[cxx::bridge]
+mod ffi {
+    #[namespace = "seastar_ffi::temporary_buffer"]
+    unsafe extern "C++" {
+        type buffer = crate::temporary_buffer::buffer;
+    }
+
+    #[namespace = "seastar_ffi::packet"]
+    unsafe extern "C++" {
+        include!("seastar/src/packet.hh");
+
+        type packet;
+
+        fn new_packet() -> UniquePtr<packet>;
+        fn packet_from_buffer(buf: UniquePtr<buffer>) -> UniquePtr<packet>;
+        fn append_buffer(p: Pin<&mut packet>, buf: UniquePtr<buffer>);
+        fn share(p: &packet) -> UniquePtr<packet>;
+        fn get_len(p: &packet) -> usize;
+        fn get_nr_frags(p: &packet) -> usize;
+        fn get_fragment(p: &packet, index: usize) -> &[u8];
+        fn trim_front(p: Pin<&mut packet>, how_much: usize);
+        fn trim_back(p: Pin<&mut packet>, how_much: usize);
+    }
+}
+
+pub(crate) use ffi::packet;
+
+/// A network packet (`seastar::net::packet`): a read-only sequence of
+/// fragments, each pointing into a buffer that is kept alive by the packet.
+///
+/// Building a packet from [`TemporaryBuffer`]s does not copy them, and
+/// [`fragments`](Packet::fragments) exposes the data as slices for
+/// scatter/gather I/O.
+///
+/// # Example
+///
+/// ```rust
+/// #[seastar::test]
+/// async fn packet_example() {
+///     let mut packet = Packet::from(TemporaryBuffer::copy_of(b"header"));
+///     packet.append(TemporaryBuffer::copy_of(b"payload"));
+///     let iov: Vec<_> = packet.fragments().map(std::io::IoSlice::new).collect();
+///     assert_eq!(iov.len(), 2);
+/// }
+/// ```
+pub struct Packet {
+    inner: UniquePtr<packet>,
+    // Keep the buffers appended to this packet marked as shared (see `TemporaryBuffer`).
+    tokens: Vec<ShareToken>,
+}
+
+impl Default for Packet {
+    fn default() -> Self {
+        Self::new()
+    }
+}
+
+impl Packet {
+    /// Creates an empty packet.
+    pub fn new() -> Self {
+        Packet {
+            inner: ffi::new_packet(),
+            tokens: Vec::new(),
+        }
+    }
+
+    pub(crate) fn into_cpp(self) -> (UniquePtr<packet>, Vec<ShareToken>) {
+        (self.inner, self.tokens)
+    }
+
+    /// Appends `buf` as a new fragment, without copying it.
+    pub fn append(&mut self, buf: TemporaryBuffer) {
+        let (buf, token) = buf.into_cpp();
+        self.tokens.extend(token);
+        ffi::append_buffer(self.inner.pin_mut(), buf);
+    }
+
+    /// Creates another packet referencing the same fragments, without copying.
+    pub fn share(&self) -> Packet {
+        Packet {
+            inner: ffi::share(&self.inner),
+            tokens: self.tokens.clone(),
+        }
+    }
+
+    /// Returns the total length of the fragments.
+    pub fn len(&self) -> usize {
+        ffi::get_len(&self.inner)
+    }
+
+    /// Checks whether the packet has no data.
+    pub fn is_empty(&self) -> bool {
+        self.len() == 0
+    }
+
+    /// Returns the number of fragments.
+    pub fn nr_frags(&self) -> usize {
+        ffi::get_nr_frags(&self.inner)
+    }
+
+    /// Returns an iterator over the fragments.
+    pub fn fragments(&self) -> Fragments<'_> {
+        Fragments {
+            packet: self,
+            index: 0,
+            count: self.nr_frags(),
+        }
+    }
+
+    /// Drops the first `how_much` bytes.
+    ///
+    /// Panics if the packet is shorter.
+    pub fn trim_front(&mut self, how_much: usize) {
+        assert!(
+            how_much <= self.len(),
+            "Trimming beyond the end of the packet"
+        );
+        ffi::trim_front(self.inner.pin_mut(), how_much);
+    }
+
+    /// Drops the last `how_much` bytes.
+    ///
+    /// Panics if the packet is shorter.
+    pub fn trim_back(&mut self, how_much: usize) {
+        assert!(
+            how_much <= self.len(),
+            "Trimming beyond the end of the packet"
+        );
+        ffi::trim_back(self.inner.pin_mut(), how_much);
+    }
+}
+
+impl From<TemporaryBuffer> for Packet {
+    fn from(buf: TemporaryBuffer) -> Self {
+        let (buf, token) = buf.into_cpp();
+        Packet {
+            inner: ffi::packet_from_buffer(buf),
+            tokens: token.into_iter().collect(),
+        }
+    }
+}
+
+/// Iterator over the fragments of a [`Packet`], returned by [`Packet::fragments`].
+pub struct Fragments<'a> {
+    packet: &'a Packet,
+    index: usize,
+    count: usize,
+}
+
+impl<'a> Iterator for Fragments<'a> {
+    type Item = &'a [u8];
+
+    fn next(&mut self) -> Option<&'a [u8]> {
+        if self.index == self.count {
+            return None;
+        }
+        let fragment = ffi::get_fragment(&self.packet.inner, self.index);
+        self.index += 1;
+        Some(fragment)
+    }
+
+    fn size_hint(&self) -> (usize, Option<usize>) {
+        let remaining = self.count - self.index;
+        (remaining, Some(remaining))
+    }
+}
+
+impl<'a> ExactSizeIterator for Fragments<'a> {}
+
+impl<'a> FusedIterator for Fragments<'a> {}
+
+#[cfg(test)]
+mod tests {
+    use super::*;
+    use crate as seastar;
+
+    #[seastar::test(shared)]
+    async fn test_packet_fragments() {
+        let header = TemporaryBuffer::copy_of(b"header");
+        let payload = TemporaryBuffer::copy_of(b"payload");
+        let payload_ptr = payload.as_ptr();
+
+        let mut packet = Packet::from(header);
+        packet.append(payload);
+        assert_eq!(packet.len(), 13);
+        assert_eq!(packet.nr_frags(), 2);
+
+        let fragments: Vec<_> = packet.fragments().collect();
+        assert_eq!(fragments, [&b"header"[..], &b"payload"[..]]);
+        assert_eq!(fragments[1].as_ptr(), payload_ptr);
+    }
+
+    #[seastar::test(shared)]
+    async fn test_packet_trim_and_share() {
+        let mut packet = Packet::from(TemporaryBuffer::copy_of(b"hello"));
+        packet.append(TemporaryBuffer::copy_of(b" world"));
+        packet.trim_front(2);
+        packet.trim_back(1);
+        let shared = packet.share();
+        drop(packet);
+        let data: Vec<u8> = shared.fragments().flatten().copied().collect();
+        assert_eq!(data, b"llo worl");
+    }
+
+    #[seastar::test(shared)]
+    async fn test_packet_keeps_buffer_shared() {
+        let buf = TemporaryBuffer::copy_of(b"data");
+        let mut view = buf.share();
+        let packet = Packet::from(buf);
+        assert!(view.get_mut().is_none());
+        drop(packet);
+        assert!(view.get_mut().is_some());
+    }
+}
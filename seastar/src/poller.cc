@@ -0,0 +1,86 @@
+#include "poller.hh"
+#include <seastar/core/posix.hh>
+#include <sys/socket.h>
+
+namespace seastar_ffi {
+namespace poller {
+
+namespace {
+
+class rust_pollfn final : public seastar::pollfn {
+    uint8_t* _data;
+    rust::Fn<bool(uint8_t*)> _poll;
+    rust::Fn<bool(uint8_t*)> _pure_poll;
+    rust::Fn<bool(uint8_t*)> _try_enter_interrupt_mode;
+    rust::Fn<void(uint8_t*)> _exit_interrupt_mode;
+
+public:
+    rust_pollfn(uint8_t* data, rust::Fn<bool(uint8_t*)> poll, rust::Fn<bool(uint8_t*)> pure_poll,
+            rust::Fn<bool(uint8_t*)> try_enter_interrupt_mode, rust::Fn<void(uint8_t*)> exit_interrupt_mode)
+        : _data(data)
+        , _poll(poll)
+        , _pure_poll(pure_poll)
+        , _try_enter_interrupt_mode(try_enter_interrupt_mode)
+        , _exit_interrupt_mode(exit_interrupt_mode) {}
+
+    bool poll() override {
+        return _poll(_data);
+    }
+
+    bool pure_poll() override {
+        return _pure_poll(_data);
+    }
+
+    bool try_enter_interrupt_mode() override {
+        return _try_enter_interrupt_mode(_data);
+    }
+
+    void exit_interrupt_mode() override {
+        _exit_interrupt_mode(_data);
+    }
+};
+
+} // namespace
+
+// Destroying the poller unregisters the pollfn right away; only its
+// destruction is deferred, and it does not call back into Rust.
+std::unique_ptr<reactor_poller> register_poller(
+    uint8_t* data,
+    rust::Fn<bool(uint8_t*)> poll,
+    rust::Fn<bool(uint8_t*)> pure_poll,
+    rust::Fn<bool(uint8_t*)> try_enter_interrupt_mode,
+    rust::Fn<void(uint8_t*)> exit_interrupt_mode) {
+    auto fn = std::make_unique<rust_pollfn>(data, poll, pure_poll, try_enter_interrupt_mode, exit_interrupt_mode);
+    return std::make_unique<reactor_poller>(std::move(fn));
+}
+
+std::shared_ptr<pollable_fd> new_pollable_fd(int32_t fd) {
+    return std::make_shared<pollable_fd>(seastar::file_desc::from_fd(fd));
+}
+
+int32_t get_fd(const std::shared_ptr<pollable_fd>& pfd) {
+    return pfd->get_fd();
+}
+
+VoidFuture readable(const std::shared_ptr<pollable_fd>& pfd) {
+    auto p = pfd;
+    co_await p->readable();
+}
+
+VoidFuture writeable(const std::shared_ptr<pollable_fd>& pfd) {
+    auto p = pfd;
+    co_await p->writeable();
+}
+
+VoidFuture readable_or_writeable(const std::shared_ptr<pollable_fd>& pfd) {
+    auto p = pfd;
+    co_await p->readable_or_writeable();
+}
+
+void shutdown(const std::shared_ptr<pollable_fd>& pfd, bool read, bool write) {
+    int how = read && write ? SHUT_RDWR : read ? SHUT_RD : SHUT_WR;
+    pfd->shutdown(how);
+}
+
+} // namespace poller
+} // namespace seastar_ffi
@@ -0,0 +1,39 @@
+#pragma once
+
+#include "cxx_async_futures.hh"
+#include <seastar/core/internal/poll.hh>
+#include <seastar/core/internal/pollable_fd.hh>
+#include <seastar/core/reactor.hh>
+
+namespace seastar_ffi {
+namespace poller {
+
+using reactor_poller = seastar::reactor::poller;
+using pollable_fd = seastar::pollable_fd;
+
+// The callbacks are those of a Rust `Poller`, and are all called with `data`.
+std::unique_ptr<reactor_poller> register_poller(
+    uint8_t* data,
+    rust::Fn<bool(uint8_t*)> poll,
+    rust::Fn<bool(uint8_t*)> pure_poll,
+    rust::Fn<bool(uint8_t*)> try_enter_interrupt_mode,
+    rust::Fn<void(uint8_t*)> exit_interrupt_mode);
+
+// Takes ownership of `fd`.
+std::shared_ptr<pollable_fd> new_pollable_fd(int32_t fd);
+
+int32_t get_fd(const std::shared_ptr<pollable_fd>& pfd);
+
+// Asynchronous functions copy the shared pointer before suspending,
+// so they are safe to abandon on the Rust side.
+
+VoidFuture readable(const std::shared_ptr<pollable_fd>& pfd);
+
+VoidFuture writeable(const std::shared_ptr<pollable_fd>& pfd);
+
+VoidFuture readable_or_writeable(const std::shared_ptr<pollable_fd>& pfd);
+
+void shutdown(const std::shared_ptr<pollable_fd>& pfd, bool read, bool write);
+
+} // namespace poller
+} // namespace seastar_ffi
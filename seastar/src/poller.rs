@@ -0,0 +1,303 @@
+use cxx::{SharedPtr, UniquePtr};
+use std::net::Shutdown;
+use std::os::fd::{AsRawFd, IntoRawFd, OwnedFd, RawFd};
+use thiserror::Error;
+
+#[cxx::bridge]
+mod ffi {
+    #[namespace = "seastar_ffi"]
+    unsafe extern "C++" {
+        type VoidFuture = crate::cxx_async_futures::VoidFuture;
+    }
+
+    #[namespace = "seastar_ffi::poller"]
+    unsafe extern "C++" {
+        include!("seastar/src/poller.hh");
+
+        type reactor_poller;
+        type pollable_fd;
+
+        unsafe fn register_poller(
+            data: *mut u8,
+            poll: unsafe fn(*mut u8) -> bool,
+            pure_poll: unsafe fn(*mut u8) -> bool,
+            try_enter_interrupt_mode: unsafe fn(*mut u8) -> bool,
+            exit_interrupt_mode: unsafe fn(*mut u8),
+        ) -> UniquePtr<reactor_poller>;
+
+        fn new_pollable_fd(fd: i32) -> Result<SharedPtr<pollable_fd>>;
+        fn get_fd(pfd: &SharedPtr<pollable_fd>) -> i32;
+        fn readable(pfd: &SharedPtr<pollable_fd>) -> VoidFuture;
+        fn writeable(pfd: &SharedPtr<pollable_fd>) -> VoidFuture;
+        fn readable_or_writeable(pfd: &SharedPtr<pollable_fd>) -> VoidFuture;
+        fn shutdown(pfd: &SharedPtr<pollable_fd>, read: bool, write: bool) -> Result<()>;
+    }
+}
+
+/// Error returned when registering or waiting on a [`PollableFd`] fails.
+#[derive(Error, Debug)]
+#[error("PollError: {0}")]
+pub struct PollError(String);
+
+/// Work polled by the reactor on every iteration of its loop
+/// (`seastar::pollfn`).
+///
+/// Pollers let components that are driven by polling, like user-space
+/// protocol stacks or device queues, run on the shard's thread, between
+/// tasks, instead of on threads of their own.
+///
+/// When it runs out of work, the reactor goes to sleep only if all of its
+/// pollers agree to, through [`try_enter_interrupt_mode`](Poller::try_enter_interrupt_mode).
+/// A poller that can be interrupted, e.g. because its events also go to an
+/// fd watched by the reactor, should agree to that, so that the shard does
+/// not spin while idle.
+///
+/// The methods are called by the reactor, from outside of any task. They
+/// must not panic, and should not take long, like tasks.
+pub trait Poller: 'static {
+    /// Polls for work and processes it. Returns whether there was any.
+    fn poll(&mut self) -> bool;
+
+    /// Checks whether there is work, without processing it or having any
+    /// other side effect. The reactor calls it before going to sleep.
+    ///
+    /// Defaults to [`poll`](Poller::poll), like `seastar::reactor::poller::simple`.
+    fn pure_poll(&mut self) -> bool {
+        self.poll()
+    }
+
+    /// Called when the reactor is about to sleep. Returns whether the poller
+    /// arranged for the reactor to be woken up (e.g. by an fd) when there is
+    /// work, and so whether the reactor is allowed to sleep.
+    ///
+    /// Defaults to `false`, which keeps the reactor from ever sleeping.
+    fn try_enter_interrupt_mode(&mut self) -> bool {
+        false
+    }
+
+    /// Called when the reactor wakes up, after a successful
+    /// [`try_enter_interrupt_mode`](Poller::try_enter_interrupt_mode).
+    fn exit_interrupt_mode(&mut self) {}
+}
+
+impl<F: FnMut() -> bool + 'static> Poller for F {
+    fn poll(&mut self) -> bool {
+        self()
+    }
+}
+
+unsafe fn poll<P: Poller>(poller: *mut u8) -> bool {
+    (*(poller as *mut P)).poll()
+}
+
+unsafe fn pure_poll<P: Poller>(poller: *mut u8) -> bool {
+    (*(poller as *mut P)).pure_poll()
+}
+
+unsafe fn try_enter_interrupt_mode<P: Poller>(poller: *mut u8) -> bool {
+    (*(poller as *mut P)).try_enter_interrupt_mode()
+}
+
+unsafe fn exit_interrupt_mode<P: Poller>(poller: *mut u8) {
+    (*(poller as *mut P)).exit_interrupt_mode()
+}
+
+/// A [`Poller`] registered with the reactor of the current shard,
+/// returned by [`register_poller`].
+///
+/// Dropping it unregisters the poller.
+pub struct PollerRegistration {
+    // Dropped first: the reactor stops calling the poller right away.
+    _cpp: UniquePtr<ffi::reactor_poller>,
+    _poller: Box<dyn Poller>,
+}
+
+/// Registers `poller` with the reactor of the current shard.
+///
+/// It is polled from the next iteration of the reactor loop on, until the
+/// returned [`PollerRegistration`] is dropped, which must happen on the
+/// same shard.
+///
+/// # Example
+///
+/// ```rust
+/// #[seastar::test]
+/// async fn poller_example() {
+///     let polls = Rc::new(Cell::new(0));
+///     let p = polls.clone();
+///     let registration = register_poller(move || {
+///         p.set(p.get() + 1);
+///         false
+///     });
+///     sleep(Duration::from_millis(1)).await;
+///     drop(registration);
+///     assert!(polls.get() > 0);
+/// }
+/// ```
+pub fn register_poller<P: Poller>(poller: P) -> PollerRegistration {
+    crate::assert_runtime_is_running();
+    let mut poller = Box::new(poller);
+    let data = &mut *poller as *mut P as *mut u8;
+    let cpp = unsafe {
+        ffi::register_poller(
+            data,
+            poll::<P>,
+            pure_poll::<P>,
+            try_enter_interrupt_mode::<P>,
+            exit_interrupt_mode::<P>,
+        )
+    };
+    PollerRegistration {
+        _cpp: cpp,
+        _poller: poller,
+    }
+}
+
+/// An fd whose readiness is watched by the reactor (`seastar::pollable_fd`).
+///
+/// It lets Rust code wait for an fd it does its own I/O on, such as an
+/// `eventfd` or a device, without a thread of its own: the reactor adds the
+/// fd to the set it polls or sleeps on.
+///
+/// The fd should be non-blocking: readiness may be reported spuriously, so
+/// the operations that follow must handle [`WouldBlock`](std::io::ErrorKind::WouldBlock)
+/// by waiting again.
+///
+/// # Example
+///
+/// ```rust
+/// #[seastar::test]
+/// async fn pollable_fd_example() {
+///     let (a, mut b) = UnixStream::pair().unwrap();
+///     a.set_nonblocking(true).unwrap();
+///     let a = PollableFd::new(a.into()).unwrap();
+///     b.write_all(b"ping").unwrap();
+///     a.readable().await.unwrap();
+/// }
+/// ```
+pub struct PollableFd {
+    inner: SharedPtr<ffi::pollable_fd>,
+}
+
+impl PollableFd {
+    /// Starts watching `fd`. It is closed when the `PollableFd` and all the
+    /// waits on it are gone.
+    pub fn new(fd: OwnedFd) -> Result<Self, PollError> {
+        crate::assert_runtime_is_running();
+        let inner = ffi::new_pollable_fd(fd.into_raw_fd())
+            .map_err(|err| PollError(err.what().to_string()))?;
+        Ok(PollableFd { inner })
+    }
+
+    /// Waits until the fd is readable.
+    pub async fn readable(&self) -> Result<(), PollError> {
+        to_result(ffi::readable(&self.inner).await)
+    }
+
+    /// Waits until the fd is writeable.
+    pub async fn writeable(&self) -> Result<(), PollError> {
+        to_result(ffi::writeable(&self.inner).await)
+    }
+
+    /// Waits until the fd is readable or writeable.
+    pub async fn readable_or_writeable(&self) -> Result<(), PollError> {
+        to_result(ffi::readable_or_writeable(&self.inner).await)
+    }
+
+    /// Shuts down the reading, writing, or both halves of the socket, which
+    /// fails the waits for them.
+    pub fn shutdown(&self, how: Shutdown) -> Result<(), PollError> {
+        let (read, write) = match how {
+            Shutdown::Read => (true, false),
+            Shutdown::Write => (false, true),
+            Shutdown::Both => (true, true),
+        };
+        ffi::shutdown(&self.inner, read, write).map_err(|err| PollError(err.what().to_string()))
+    }
+}
+
+impl AsRawFd for PollableFd {
+    fn as_raw_fd(&self) -> RawFd {
+        ffi::get_fd(&self.inner)
+    }
+}
+
+fn to_result(result: cxx_async::CxxAsyncResult<()>) -> Result<(), PollError> {
+    result.map_err(|err| PollError(err.what().to_string()))
+}
+
+#[cfg(test)]
+mod tests {
+    use super::*;
+    use crate as seastar;
+    use crate::sleep;
+    use std::cell::Cell;
+    use std::io::{Read, Write};
+    use std::os::unix::net::UnixStream;
+    use std::rc::Rc;
+    use std::time::Duration;
+
+    #[seastar::test]
+    async fn test_poller_is_polled_until_unregistered() {
+        let polls = Rc::new(Cell::new(0));
+        let p = polls.clone();
+        let registration = register_poller(move || {
+            p.set(p.get() + 1);
+            false
+        });
+        sleep(Duration::from_millis(10)).await;
+        drop(registration);
+        let after_drop = polls.get();
+        assert!(after_drop > 0);
+        sleep(Duration::from_millis(10)).await;
+        assert_eq!(polls.get(), after_drop);
+    }
+
+    #[derive(Default)]
+    struct InterruptiblePoller {
+        entered: Rc<Cell<u32>>,
+        exited: Rc<Cell<u32>>,
+    }
+
+    impl Poller for InterruptiblePoller {
+        fn poll(&mut self) -> bool {
+            false
+        }
+
+        fn try_enter_interrupt_mode(&mut self) -> bool {
+            self.entered.set(self.entered.get() + 1);
+            true
+        }
+
+        fn exit_interrupt_mode(&mut self) {
+            self.exited.set(self.exited.get() + 1);
+        }
+    }
+
+    #[seastar::test]
+    async fn test_interruptible_poller_lets_the_reactor_sleep() {
+        let poller = InterruptiblePoller::default();
+        let (entered, exited) = (poller.entered.clone(), poller.exited.clone());
+        let _registration = register_poller(poller);
+        sleep(Duration::from_millis(50)).await;
+        assert!(entered.get() > 0);
+        assert!(exited.get() > 0);
+    }
+
+    #[seastar::test]
+    async fn test_pollable_fd() {
+        let (a, mut b) = UnixStream::pair().unwrap();
+        a.set_nonblocking(true).unwrap();
+        let mut reader = a.try_clone().unwrap();
+        let a = PollableFd::new(a.into()).unwrap();
+        a.writeable().await.unwrap();
+
+        b.write_all(b"ping").unwrap();
+        a.readable().await.unwrap();
+        let mut buf = [0; 4];
+        reader.read_exact(&mut buf).unwrap();
+        assert_eq!(&buf, b"ping");
+
+        a.shutdown(Shutdown::Both).unwrap();
+    }
+}
@@ -1,3 +1,9 @@
+use futures::Stream;
+use pin_project::pin_project;
+use std::future::Future;
+use std::pin::Pin;
+use std::task::{Context, Poll};
+
 #[cxx::bridge(namespace = "seastar")]
 mod ffi {
     unsafe extern "C++" {
@@ -11,6 +17,111 @@ mod ffi {
 
 pub use ffi::need_preempt;
 
+/// Future returned by [`yield_now`].
+struct YieldNow {
+    yielded: bool,
+}
+
+impl Future for YieldNow {
+    type Output = ();
+
+    fn poll(mut self: Pin<&mut Self>, cx: &mut Context<'_>) -> Poll<Self::Output> {
+        if self.yielded {
+            return Poll::Ready(());
+        }
+        self.yielded = true;
+        cx.waker().wake_by_ref();
+        Poll::Pending
+    }
+}
+
+/// Returns control to the Seastar scheduler, letting other tasks run
+/// before the current task continues.
+pub fn yield_now() -> impl Future<Output = ()> {
+    YieldNow { yielded: false }
+}
+
+/// Returns control to the Seastar scheduler, but only if the current task
+/// exhausted its time quota (see [`need_preempt`]).
+///
+/// Completes immediately otherwise, so it is cheap enough to call on every
+/// iteration of a long loop.
+///
+/// # Example
+///
+/// ```rust
+/// #[seastar::test]
+/// async fn maybe_yield_example() {
+///     let mut sum = 0u64;
+///     for i in 0..1_000_000 {
+///         sum += i;
+///         maybe_yield().await;
+///     }
+/// }
+/// ```
+pub async fn maybe_yield() {
+    if need_preempt() {
+        yield_now().await;
+    }
+}
+
+/// Calls `func` on each item of `iter`, yielding to the scheduler
+/// between items whenever the time quota has run out.
+pub async fn for_each_preemptible<I, Func>(iter: I, mut func: Func)
+where
+    I: IntoIterator,
+    Func: FnMut(I::Item),
+{
+    for item in iter {
+        func(item);
+        maybe_yield().await;
+    }
+}
+
+/// Stream returned by [`PreemptibleStreamExt::preemptible`].
+#[pin_project]
+pub struct Preemptible<S> {
+    #[pin]
+    stream: S,
+    yielded: bool,
+}
+
+impl<S: Stream> Stream for Preemptible<S> {
+    type Item = S::Item;
+
+    fn poll_next(self: Pin<&mut Self>, cx: &mut Context<'_>) -> Poll<Option<Self::Item>> {
+        let this = self.project();
+        if !*this.yielded && need_preempt() {
+            *this.yielded = true;
+            cx.waker().wake_by_ref();
+            return Poll::Pending;
+        }
+        *this.yielded = false;
+        this.stream.poll_next(cx)
+    }
+
+    fn size_hint(&self) -> (usize, Option<usize>) {
+        self.stream.size_hint()
+    }
+}
+
+/// Adds yield points to streams.
+pub trait PreemptibleStreamExt: Stream + Sized {
+    /// Wraps the stream so that it yields to the scheduler before producing
+    /// an item whenever the time quota has run out.
+    ///
+    /// Useful for streams that are mostly ready, like iterators turned into
+    /// streams, which would otherwise never give other tasks a chance to run.
+    fn preemptible(self) -> Preemptible<Self> {
+        Preemptible {
+            stream: self,
+            yielded: false,
+        }
+    }
+}
+
+impl<S: Stream> PreemptibleStreamExt for S {}
+
 #[test]
 fn test_preempt_smoke_test() {
     // The need_preempt function "works" even if there is no Seastar runtime
@@ -20,3 +131,32 @@ fn test_preempt_smoke_test() {
     assert!(!need_preempt());
     assert!(!need_preempt());
 }
+
+#[cfg(test)]
+mod tests {
+    use super::*;
+    use crate as seastar;
+    use futures::StreamExt;
+
+    #[seastar::test]
+    async fn test_yield_now() {
+        yield_now().await;
+        maybe_yield().await;
+    }
+
+    #[seastar::test]
+    async fn test_for_each_preemptible() {
+        let mut sum = 0u64;
+        for_each_preemptible(0..100_000u64, |i| sum += i).await;
+        assert_eq!(sum, 100_000 * 99_999 / 2);
+    }
+
+    #[seastar::test]
+    async fn test_preemptible_stream() {
+        let sum = futures::stream::iter(0..100_000u64)
+            .preemptible()
+            .fold(0, |acc, i| async move { acc + i })
+            .await;
+        assert_eq!(sum, 100_000 * 99_999 / 2);
+    }
+}
@@ -0,0 +1,19 @@
+#include "reclaimer.hh"
+
+namespace seastar_ffi {
+namespace reclaimer {
+
+std::unique_ptr<reclaimer> register_reclaimer(
+        uint8_t* data,
+        rust::Fn<size_t(uint8_t*, size_t)> reclaim) {
+    // Asynchronous reclaimers run from a task of the reactor, never from
+    // inside an allocation, so Rust code can take its usual borrows.
+    return std::make_unique<reclaimer>([data, reclaim] (reclaimer::request request) {
+        return reclaim(data, request.bytes_to_reclaim) > 0
+            ? seastar::memory::reclaiming_result::reclaimed_something
+            : seastar::memory::reclaiming_result::reclaimed_nothing;
+    }, seastar::memory::reclaimer_scope::async);
+}
+
+} // namespace reclaimer
+} // namespace seastar_ffi
@@ -0,0 +1,19 @@
+#pragma once
+
+#include "rust/cxx.h"
+#include <seastar/core/memory.hh>
+
+namespace seastar_ffi {
+namespace reclaimer {
+
+using reclaimer = seastar::memory::reclaimer;
+
+// Registers an asynchronous reclaimer with the allocator of the current shard.
+// `reclaim` is called with `data` and the number of bytes to release, and
+// returns the number of bytes it released.
+std::unique_ptr<reclaimer> register_reclaimer(
+    uint8_t* data,
+    rust::Fn<size_t(uint8_t*, size_t)> reclaim);
+
+} // namespace reclaimer
+} // namespace seastar_ffi
@@ -0,0 +1,102 @@
+use cxx::UniquePtr;
+
+#[cxx::bridge(namespace = "seastar_ffi::reclaimer")]
+mod ffi {
+    unsafe extern "C++" {
+        include!("seastar/src/reclaimer.hh");
+
+        type reclaimer;
+
+        unsafe fn register_reclaimer(
+            data: *mut u8,
+            reclaim: unsafe fn(*mut u8, usize) -> usize,
+        ) -> UniquePtr<reclaimer>;
+    }
+}
+
+unsafe fn reclaim<F: FnMut(usize) -> usize>(data: *mut u8, bytes: usize) -> usize {
+    (*(data as *mut F))(bytes)
+}
+
+/// A reclaimer registered with the allocator of the current shard,
+/// returned by [`register_reclaimer`].
+///
+/// Dropping it unregisters the reclaimer.
+pub struct ReclaimerRegistration {
+    // Dropped first: the allocator stops calling the reclaimer right away.
+    _cpp: UniquePtr<ffi::reclaimer>,
+    _reclaim: Box<dyn FnMut(usize) -> usize>,
+}
+
+impl ReclaimerRegistration {
+    /// Calls the reclaimer like the allocator does when memory runs low.
+    #[cfg(test)]
+    pub(crate) fn reclaim(&mut self, bytes: usize) -> usize {
+        (self._reclaim)(bytes)
+    }
+}
+
+/// Registers `reclaim` with the allocator of the current shard
+/// (`seastar::memory::reclaimer`).
+///
+/// When the free memory of the shard runs low, the reactor asks its
+/// reclaimers to release memory, before allocations start failing. `reclaim`
+/// is called with the number of bytes the allocator would like back, and
+/// returns the number of bytes it released; it may be called again until
+/// enough memory is free, and should return 0 once it has nothing left to
+/// release.
+///
+/// `reclaim` is called from a task of the reactor, not from inside an
+/// allocation. It must not panic, and should not take long, like tasks.
+///
+/// # Example
+///
+/// ```rust
+/// #[seastar::test]
+/// async fn reclaimer_example() {
+///     let cache = Rc::new(RefCell::new(Vec::<Vec<u8>>::new()));
+///     let c = cache.clone();
+///     let _registration = register_reclaimer(move |_| {
+///         let released = c.borrow().iter().map(|v| v.capacity()).sum();
+///         c.borrow_mut().clear();
+///         released
+///     });
+/// }
+/// ```
+pub fn register_reclaimer<F>(reclaim: F) -> ReclaimerRegistration
+where
+    F: FnMut(usize) -> usize + 'static,
+{
+    crate::assert_runtime_is_running();
+    let mut reclaim = Box::new(reclaim);
+    let data = &mut *reclaim as *mut F as *mut u8;
+    let cpp = unsafe { ffi::register_reclaimer(data, self::reclaim::<F>) };
+    ReclaimerRegistration {
+        _cpp: cpp,
+        _reclaim: reclaim,
+    }
+}
+
+#[cfg(test)]
+mod tests {
+    use super::*;
+    use crate as seastar;
+    use std::cell::Cell;
+    use std::rc::Rc;
+
+    #[seastar::test(shared)]
+    async fn test_register_reclaimer() {
+        let calls = Rc::new(Cell::new(0));
+        let c = calls.clone();
+        let registration = register_reclaimer(move |_| {
+            c.set(c.get() + 1);
+            0
+        });
+        // Memory is plentiful in tests, nothing asks for it back.
+        assert_eq!(calls.get(), 0);
+        let mut registration = registration;
+        assert_eq!(registration.reclaim(4096), 0);
+        assert_eq!(calls.get(), 1);
+        drop(registration);
+    }
+}
@@ -0,0 +1,21 @@
+#pragma once
+
+#include "rust/cxx.h"
+
+namespace seastar_ffi {
+
+// Gives the C++ side's reference to a Rust result slot (see result_slot.rs)
+// back to Rust when destroyed.
+class slot_releaser {
+    uint8_t* _slot;
+    rust::Fn<void(uint8_t*)> _releaser;
+public:
+    slot_releaser(uint8_t* slot, rust::Fn<void(uint8_t*)> releaser) noexcept
+        : _slot(slot), _releaser(releaser) {}
+    slot_releaser(const slot_releaser&) = delete;
+    ~slot_releaser() {
+        _releaser(_slot);
+    }
+};
+
+} // namespace seastar_ffi
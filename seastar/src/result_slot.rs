@@ -0,0 +1,194 @@
+//! Typed values across the FFI without side channels.
+//!
+//! The bridge only knows how to move a handful of types through futures
+//! (see [`VoidFuture`]). Instead of sending a Rust value through a channel,
+//! the producer writes it directly into a [`ResultSlot`] owned by the awaiting
+//! side, and the C++ future only signals completion. [`SlotFuture`] puts the
+//! two back together.
+//!
+//! A slot is shared by exactly two references, both of which must be created
+//! and dropped on the shard that created the slot, so the reference count is
+//! not atomic. A reference handed to C++ as a raw pointer is released with
+//! [`release_raw`], which C++ must call on the owning shard.
+
+use crate::cxx_async_futures::VoidFuture;
+use crate::slab;
+use pin_project::pin_project;
+use std::cell::{Cell, UnsafeCell};
+use std::future::Future;
+use std::pin::Pin;
+use std::ptr::NonNull;
+use std::task::{Context, Poll};
+
+enum Stage<In, Out> {
+    Pending(In),
+    Running,
+    Finished(Out),
+    Taken,
+}
+
+/// Storage for the input of an operation and, later, its output.
+pub(crate) struct ResultSlot<In, Out> {
+    refs: Cell<u8>,
+    stage: UnsafeCell<Stage<In, Out>>,
+}
+
+impl<In, Out> ResultSlot<In, Out> {
+    /// Takes the input out of the slot.
+    ///
+    /// # Safety
+    ///
+    /// Nobody else may access the slot's contents at the same time.
+    pub(crate) unsafe fn take_input(&self) -> In {
+        match std::mem::replace(&mut *self.stage.get(), Stage::Running) {
+            Stage::Pending(input) => input,
+            _ => unreachable!("slot input taken twice"),
+        }
+    }
+
+    /// Stores the output in the slot.
+    ///
+    /// # Safety
+    ///
+    /// Nobody else may access the slot's contents at the same time.
+    pub(crate) unsafe fn set_result(&self, output: Out) {
+        *self.stage.get() = Stage::Finished(output);
+    }
+
+    /// Checks whether the caller holds the only remaining reference,
+    /// i.e. nobody is waiting for the output anymore.
+    pub(crate) fn is_abandoned(&self) -> bool {
+        self.refs.get() == 1
+    }
+
+    /// Takes the output out of the slot.
+    ///
+    /// # Safety
+    ///
+    /// Nobody else may access the slot's contents at the same time,
+    /// and the output must have been set.
+    pub(crate) unsafe fn take_result(&self) -> Out {
+        match std::mem::replace(&mut *self.stage.get(), Stage::Taken) {
+            Stage::Finished(output) => output,
+            _ => unreachable!("slot completed without a result"),
+        }
+    }
+}
+
+/// One of the two references to a [`ResultSlot`].
+pub(crate) struct SlotRef<In, Out>(NonNull<ResultSlot<In, Out>>);
+
+impl<In, Out> SlotRef<In, Out> {
+    /// Creates a slot holding `input` and returns both references to it.
+    pub(crate) fn new(input: In) -> (Self, Self) {
+        let slot = slab::alloc(ResultSlot {
+            refs: Cell::new(2),
+            stage: UnsafeCell::new(Stage::Pending(input)),
+        });
+        (SlotRef(slot), SlotRef(slot))
+    }
+
+    /// Turns the reference into a raw pointer that can be passed to C++.
+    pub(crate) fn into_raw(self) -> *mut u8 {
+        let raw = self.0.as_ptr() as *mut u8;
+        std::mem::forget(self);
+        raw
+    }
+
+    /// Accesses the slot behind a raw reference without taking it over.
+    ///
+    /// # Safety
+    ///
+    /// `raw` must come from [`into_raw`](SlotRef::into_raw) with matching types
+    /// and must not have been released yet.
+    pub(crate) unsafe fn borrow_raw<'a>(raw: *mut u8) -> &'a ResultSlot<In, Out> {
+        &*(raw as *const ResultSlot<In, Out>)
+    }
+}
+
+impl<In, Out> std::ops::Deref for SlotRef<In, Out> {
+    type Target = ResultSlot<In, Out>;
+
+    fn deref(&self) -> &Self::Target {
+        unsafe { self.0.as_ref() }
+    }
+}
+
+impl<In, Out> Drop for SlotRef<In, Out> {
+    fn drop(&mut self) {
+        let refs = self.refs.get() - 1;
+        self.refs.set(refs);
+        if refs == 0 {
+            unsafe { slab::free(self.0) };
+        }
+    }
+}
+
+/// Releases a reference obtained from [`SlotRef::into_raw`].
+///
+/// # Safety
+///
+/// `raw` must come from [`SlotRef::into_raw`] with matching types, must be
+/// released only once, and only on the shard that created the slot.
+pub(crate) unsafe fn release_raw<In, Out>(raw: *mut u8) {
+    drop(SlotRef::<In, Out>(NonNull::new_unchecked(
+        raw as *mut ResultSlot<In, Out>,
+    )));
+}
+
+/// A future that resolves to the value stored in a slot once the C++ side
+/// signals completion.
+#[pin_project]
+pub(crate) struct SlotFuture<In, Out> {
+    #[pin]
+    completion: VoidFuture,
+    slot: SlotRef<In, Out>,
+}
+
+impl<In, Out> SlotFuture<In, Out> {
+    /// `completion` must resolve only after the output has been stored in `slot`.
+    pub(crate) fn new(completion: VoidFuture, slot: SlotRef<In, Out>) -> Self {
+        SlotFuture { completion, slot }
+    }
+}
+
+impl<In, Out> Future for SlotFuture<In, Out> {
+    type Output = Out;
+
+    fn poll(self: Pin<&mut Self>, cx: &mut Context<'_>) -> Poll<Self::Output> {
+        let this = self.project();
+        match this.completion.poll(cx) {
+            Poll::Ready(Ok(())) => Poll::Ready(unsafe { this.slot.take_result() }),
+            Poll::Ready(Err(_)) => panic!(),
+            Poll::Pending => Poll::Pending,
+        }
+    }
+}
+
+#[cfg(test)]
+mod tests {
+    use super::*;
+    use std::rc::Rc;
+
+    #[test]
+    fn test_slot_moves_input_and_result() {
+        let (reader, writer) = SlotRef::<i32, String>::new(42);
+        unsafe {
+            let input = writer.take_input();
+            writer.set_result(input.to_string());
+            drop(writer);
+            assert_eq!(reader.take_result(), "42");
+        }
+    }
+
+    #[test]
+    fn test_slot_drops_contents_with_last_reference() {
+        let rc = Rc::new(());
+        let (reader, writer) = SlotRef::<Rc<()>, ()>::new(rc.clone());
+        let raw = writer.into_raw();
+        drop(reader);
+        assert_eq!(Rc::strong_count(&rc), 2);
+        unsafe { release_raw::<Rc<()>, ()>(raw) };
+        assert_eq!(Rc::strong_count(&rc), 1);
+    }
+}
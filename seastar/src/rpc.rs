@@ -0,0 +1,1166 @@
+//! Remote procedure calls between shards and nodes.
+//!
+//! An [`RpcProtocol`] holds the handlers of a service, keyed by [`Verb`]s,
+//! and the [`RpcSerializer`] that encodes their arguments and results.
+//! [`RpcServer`] serves it over TCP, and [`RpcClient`] calls it, either on
+//! another node, through a connection, or on a shard of the current node,
+//! through a [`Sharded`] protocol. In the latter case the request and the
+//! response are moved between shards as they are, without being serialized.
+//!
+//! Both kinds of calls come in two flavors: [`Verb`]s return one response,
+//! [`StreamVerb`]s return a stream of them.
+//!
+//! Connections can compress their messages. The client offers the
+//! [`RpcCompressor`]s of its protocol when it connects, and the server picks
+//! the first one it also has, if any.
+//!
+//! # Wire format
+//!
+//! Every message is a frame: a kind (`u8`), a call id (`u64`), a verb (`u64`),
+//! the length of the payload (`u32`), all little endian, and the payload.
+//! A connection starts with a negotiation frame in each direction: the
+//! client's payload lists the names of its compressors, separated by commas,
+//! and the server's names the chosen one, or is empty.
+
+use crate::{
+    connect, listen, mpsc, oneshot, shard_channel, spawn_detached, ConnectedSocket, Gate,
+    InputStream, ListenOptions, OutputStream, ServerSocket, Sharded,
+    DEFAULT_SHARD_CHANNEL_BATCH_SIZE,
+};
+use futures::stream::LocalBoxStream;
+use futures::{ready, AsyncReadExt, AsyncWriteExt, Stream, StreamExt};
+use std::any::Any;
+use std::cell::{Cell, RefCell};
+use std::collections::{HashMap, VecDeque};
+use std::future::Future;
+use std::io;
+use std::marker::PhantomData;
+use std::net::SocketAddr;
+use std::pin::Pin;
+use std::rc::Rc;
+use std::task::{Context, Poll, Waker};
+use thiserror::Error;
+
+// Frame kinds.
+const NEGOTIATE: u8 = 0;
+const REQUEST: u8 = 1;
+const RESPONSE: u8 = 2;
+const STREAM_ITEM: u8 = 3;
+const STREAM_END: u8 = 4;
+const ERROR: u8 = 5;
+
+// The payload of ERROR frames starts with one of these.
+const ERROR_UNKNOWN_VERB: u8 = 0;
+const ERROR_WRONG_SIGNATURE: u8 = 1;
+const ERROR_SERIALIZATION: u8 = 2;
+
+const HEADER_SIZE: usize = 1 + 8 + 8 + 4;
+const MAX_FRAME_SIZE: usize = 128 << 20;
+/// Longer error messages are truncated, so that error frames always fit.
+const MAX_ERROR_MESSAGE_SIZE: usize = 4096;
+
+/// How many frames may wait to be written to a connection.
+const FRAME_QUEUE_SIZE: usize = 128;
+
+/// Error returned when a call fails.
+#[derive(Error, Debug, Clone, PartialEq, Eq)]
+pub enum RpcError {
+    /// No handler is registered for the verb.
+    #[error("RpcError: unknown verb {0}")]
+    UnknownVerb(u64),
+    /// A handler is registered for the verb, with other types, or the other
+    /// flavor (single response vs. stream).
+    #[error("RpcError: verb {0} registered with another signature")]
+    WrongSignature(u64),
+    /// A message could not be (de)serialized or decompressed, or is larger
+    /// than a frame allows.
+    #[error("RpcError: serialization failed: {0}")]
+    Serialization(String),
+    /// The connection was closed before the call completed.
+    #[error("RpcError: connection closed")]
+    ConnectionClosed,
+    /// Connecting, listening or the connection itself failed.
+    #[error("RpcError: {0}")]
+    Net(String),
+}
+
+fn net_error(err: impl std::fmt::Display) -> RpcError {
+    RpcError::Net(err.to_string())
+}
+
+/// How values of type `T` are encoded on the wire.
+///
+/// A serializer implements it for all the argument and result types of the
+/// verbs of its protocol, so the encoding can be picked freely, e.g.
+/// wrapping a serialization library.
+pub trait RpcSerializer<T>: 'static {
+    /// Appends the encoding of `value` to `out`.
+    fn write(&self, value: &T, out: &mut Vec<u8>);
+
+    /// Decodes a value written by [`write`](RpcSerializer::write).
+    fn read(&self, data: &[u8]) -> Result<T, RpcError>;
+}
+
+/// A compression algorithm for the messages of a connection.
+pub trait RpcCompressor: 'static {
+    /// The name under which the algorithm is negotiated. It must not
+    /// contain commas.
+    fn name(&self) -> &'static str;
+
+    /// Compresses a message.
+    fn compress(&self, data: &[u8]) -> Vec<u8>;
+
+    /// Decompresses a message compressed by the peer.
+    fn decompress(&self, data: &[u8]) -> Result<Vec<u8>, RpcError>;
+}
+
+/// A call returning one response, of type `Resp`, for a request of type `Req`.
+///
+/// Verbs are identified by their id, which must be unique in a protocol,
+/// across [`Verb`]s and [`StreamVerb`]s.
+pub struct Verb<Req, Resp> {
+    id: u64,
+    _types: PhantomData<fn(Req) -> Resp>,
+}
+
+impl<Req, Resp> Verb<Req, Resp> {
+    /// Creates a verb with the given id.
+    pub const fn new(id: u64) -> Self {
+        Verb {
+            id,
+            _types: PhantomData,
+        }
+    }
+}
+
+impl<Req, Resp> Clone for Verb<Req, Resp> {
+    fn clone(&self) -> Self {
+        *self
+    }
+}
+
+impl<Req, Resp> Copy for Verb<Req, Resp> {}
+
+/// A call returning a stream of responses, of type `Resp`, for a request of
+/// type `Req`.
+pub struct StreamVerb<Req, Resp> {
+    id: u64,
+    _types: PhantomData<fn(Req) -> Resp>,
+}
+
+impl<Req, Resp> StreamVerb<Req, Resp> {
+    /// Creates a verb with the given id.
+    pub const fn new(id: u64) -> Self {
+        StreamVerb {
+            id,
+            _types: PhantomData,
+        }
+    }
+}
+
+impl<Req, Resp> Clone for StreamVerb<Req, Resp> {
+    fn clone(&self) -> Self {
+        *self
+    }
+}
+
+impl<Req, Resp> Copy for StreamVerb<Req, Resp> {}
+
+type LocalFn<Req, Resp> = Box<dyn Fn(Req) -> Pin<Box<dyn Future<Output = Resp>>>>;
+type LocalStreamFn<Req, Resp> = Box<dyn Fn(Req) -> LocalBoxStream<'static, Resp>>;
+
+/// What a handler produces for a remote call: serialized responses.
+enum RemoteReply {
+    Single(Pin<Box<dyn Future<Output = Vec<u8>>>>),
+    Stream(LocalBoxStream<'static, Vec<u8>>),
+}
+
+type RemoteFn = Rc<dyn Fn(&[u8]) -> Result<RemoteReply, RpcError>>;
+
+struct Handler {
+    // A `LocalFn` or a `LocalStreamFn`, for calls from the same node.
+    local: Rc<dyn Any>,
+    remote: RemoteFn,
+}
+
+/// The handlers of a service, and how their messages are encoded.
+///
+/// To serve calls from other shards, start a protocol on every shard with
+/// [`Sharded`], registering the same handlers on each of them.
+///
+/// # Example
+///
+/// ```rust
+/// const ECHO: Verb<String, String> = Verb::new(1);
+///
+/// #[seastar::test]
+/// async fn rpc_example() {
+///     let protocol = Rc::new(RpcProtocol::new(MySerializer));
+///     protocol.register(ECHO, |s: String| async move { s });
+///     let server = RpcServer::listen(protocol.clone(), "127.0.0.1:0".parse().unwrap()).unwrap();
+///
+///     let client = RpcClient::connect(protocol, server.local_address()).await.unwrap();
+///     assert_eq!(client.call(ECHO, "hi".to_string()).await.unwrap(), "hi");
+///     server.stop().await;
+/// }
+/// ```
+pub struct RpcProtocol<S> {
+    serializer: Rc<S>,
+    handlers: RefCell<HashMap<u64, Handler>>,
+    compressors: Vec<Rc<dyn RpcCompressor>>,
+}
+
+impl<S: 'static> RpcProtocol<S> {
+    /// Creates a protocol without handlers, encoding messages with `serializer`.
+    pub fn new(serializer: S) -> Self {
+        RpcProtocol {
+            serializer: Rc::new(serializer),
+            handlers: RefCell::new(HashMap::new()),
+            compressors: Vec::new(),
+        }
+    }
+
+    /// Adds a compression algorithm.
+    ///
+    /// Clients offer theirs in the order they were added, the first ones
+    /// being preferred.
+    pub fn with_compressor(mut self, compressor: impl RpcCompressor) -> Self {
+        self.compressors.push(Rc::new(compressor));
+        self
+    }
+
+    /// Registers `handler` for `verb`, replacing the previous one, if any.
+    pub fn register<Req, Resp, Func, Fut>(&self, verb: Verb<Req, Resp>, handler: Func)
+    where
+        S: RpcSerializer<Req> + RpcSerializer<Resp>,
+        Req: 'static,
+        Resp: 'static,
+        Func: Fn(Req) -> Fut + 'static,
+        Fut: Future<Output = Resp> + 'static,
+    {
+        let handler = Rc::new(handler);
+        let h = handler.clone();
+        let local: LocalFn<Req, Resp> = Box::new(move |req| Box::pin(h(req)));
+        let serializer = self.serializer.clone();
+        let remote: RemoteFn = Rc::new(move |payload: &[u8]| {
+            let req = RpcSerializer::<Req>::read(&*serializer, payload)?;
+            let resp = handler(req);
+            let serializer = serializer.clone();
+            Ok(RemoteReply::Single(Box::pin(async move {
+                let mut out = Vec::new();
+                RpcSerializer::<Resp>::write(&*serializer, &resp.await, &mut out);
+                out
+            })))
+        });
+        self.insert(verb.id, local, remote);
+    }
+
+    /// Registers `handler` for the streaming `verb`, replacing the previous
+    /// one, if any.
+    pub fn register_stream<Req, Resp, Func, St>(&self, verb: StreamVerb<Req, Resp>, handler: Func)
+    where
+        S: RpcSerializer<Req> + RpcSerializer<Resp>,
+        Req: 'static,
+        Resp: 'static,
+        Func: Fn(Req) -> St + 'static,
+        St: Stream<Item = Resp> + 'static,
+    {
+        let handler = Rc::new(handler);
+        let h = handler.clone();
+        let local: LocalStreamFn<Req, Resp> = Box::new(move |req| h(req).boxed_local());
+        let serializer = self.serializer.clone();
+        let remote: RemoteFn = Rc::new(move |payload: &[u8]| {
+            let req = RpcSerializer::<Req>::read(&*serializer, payload)?;
+            let serializer = serializer.clone();
+            let items = handler(req).map(move |item| {
+                let mut out = Vec::new();
+                RpcSerializer::<Resp>::write(&*serializer, &item, &mut out);
+                out
+            });
+            Ok(RemoteReply::Stream(items.boxed_local()))
+        });
+        self.insert(verb.id, local, remote);
+    }
+
+    fn insert<L: 'static>(&self, verb: u64, local: L, remote: RemoteFn) {
+        let handler = Handler {
+            local: Rc::new(local),
+            remote,
+        };
+        self.handlers.borrow_mut().insert(verb, handler);
+    }
+
+    fn local_handler<L: 'static>(&self, verb: u64) -> Result<Rc<L>, RpcError> {
+        let handlers = self.handlers.borrow();
+        let handler = handlers.get(&verb).ok_or(RpcError::UnknownVerb(verb))?;
+        handler
+            .local
+            .clone()
+            .downcast::<L>()
+            .map_err(|_| RpcError::WrongSignature(verb))
+    }
+
+    fn remote_handler(&self, verb: u64) -> Result<RemoteFn, RpcError> {
+        let handlers = self.handlers.borrow();
+        let handler = handlers.get(&verb).ok_or(RpcError::UnknownVerb(verb))?;
+        Ok(handler.remote.clone())
+    }
+
+    fn compressor(&self, name: &str) -> Option<Rc<dyn RpcCompressor>> {
+        self.compressors.iter().find(|c| c.name() == name).cloned()
+    }
+}
+
+struct Frame {
+    kind: u8,
+    id: u64,
+    verb: u64,
+    payload: Vec<u8>,
+}
+
+/// Encodes a frame, unless the payload is too large for one.
+fn encode(kind: u8, id: u64, verb: u64, payload: &[u8]) -> Result<Vec<u8>, RpcError> {
+    if payload.len() > MAX_FRAME_SIZE {
+        let msg = format!("message of {} bytes is too large", payload.len());
+        return Err(RpcError::Serialization(msg));
+    }
+    Ok(encode_unchecked(kind, id, verb, payload))
+}
+
+fn encode_unchecked(kind: u8, id: u64, verb: u64, payload: &[u8]) -> Vec<u8> {
+    let mut frame = Vec::with_capacity(HEADER_SIZE + payload.len());
+    frame.push(kind);
+    frame.extend_from_slice(&id.to_le_bytes());
+    frame.extend_from_slice(&verb.to_le_bytes());
+    frame.extend_from_slice(&(payload.len() as u32).to_le_bytes());
+    frame.extend_from_slice(payload);
+    frame
+}
+
+fn encode_error(id: u64, err: &RpcError) -> Vec<u8> {
+    let (code, verb, message) = match err {
+        RpcError::UnknownVerb(verb) => (ERROR_UNKNOWN_VERB, *verb, String::new()),
+        RpcError::WrongSignature(verb) => (ERROR_WRONG_SIGNATURE, *verb, String::new()),
+        RpcError::Serialization(message) => (ERROR_SERIALIZATION, 0, message.clone()),
+        err => (ERROR_SERIALIZATION, 0, err.to_string()),
+    };
+    let mut payload = vec![code];
+    payload.extend_from_slice(&message.as_bytes()[..message.len().min(MAX_ERROR_MESSAGE_SIZE)]);
+    encode_unchecked(ERROR, id, verb, &payload)
+}
+
+fn decode_error(frame: &Frame) -> RpcError {
+    match frame.payload.first() {
+        Some(&ERROR_UNKNOWN_VERB) => RpcError::UnknownVerb(frame.verb),
+        Some(&ERROR_WRONG_SIGNATURE) => RpcError::WrongSignature(frame.verb),
+        _ => {
+            let message = frame.payload.get(1..).unwrap_or_default();
+            RpcError::Serialization(String::from_utf8_lossy(message).into_owned())
+        }
+    }
+}
+
+/// Reads the next frame, or `None` at the end of the stream.
+async fn read_frame(input: &mut InputStream) -> io::Result<Option<Frame>> {
+    let mut header = [0; HEADER_SIZE];
+    // `InputStream::read` returns buffers, the bytes are read through `AsyncRead`.
+    if AsyncReadExt::read(input, &mut header[..1]).await? == 0 {
+        return Ok(None);
+    }
+    input.read_exact(&mut header[1..]).await?;
+    let len = u32::from_le_bytes(header[17..21].try_into().unwrap()) as usize;
+    if len > MAX_FRAME_SIZE {
+        let msg = format!("RPC frame of {len} bytes");
+        return Err(io::Error::new(io::ErrorKind::InvalidData, msg));
+    }
+    let mut payload = vec![0; len];
+    input.read_exact(&mut payload).await?;
+    Ok(Some(Frame {
+        kind: header[0],
+        id: u64::from_le_bytes(header[1..9].try_into().unwrap()),
+        verb: u64::from_le_bytes(header[9..17].try_into().unwrap()),
+        payload,
+    }))
+}
+
+/// Writes the frames queued for a connection, flushing whenever the queue
+/// runs empty, so that frames queued together are sent together.
+async fn write_frames(mut output: OutputStream, mut frames: mpsc::Receiver<Vec<u8>>) {
+    while let Some(frame) = frames.recv().await {
+        if output.write_all(&frame).await.is_err() {
+            break;
+        }
+        if frames.is_empty() && output.flush().await.is_err() {
+            break;
+        }
+    }
+    let _ = output.close().await;
+}
+
+/// The compression of a connection, if any.
+#[derive(Clone)]
+struct Compression(Option<Rc<dyn RpcCompressor>>);
+
+impl Compression {
+    fn compress(&self, payload: Vec<u8>) -> Vec<u8> {
+        match &self.0 {
+            Some(compressor) => compressor.compress(&payload),
+            None => payload,
+        }
+    }
+
+    fn decompress(&self, payload: Vec<u8>) -> Result<Vec<u8>, RpcError> {
+        match &self.0 {
+            Some(compressor) => compressor.decompress(&payload),
+            None => Ok(payload),
+        }
+    }
+
+    fn name(&self) -> Option<&'static str> {
+        self.0.as_ref().map(|compressor| compressor.name())
+    }
+}
+
+/// Serves an [`RpcProtocol`] over TCP, on the current shard.
+///
+/// To serve on all shards, listen on every shard with the same address
+/// (see [`listen`](crate::listen)).
+pub struct RpcServer {
+    socket: Rc<ServerSocket>,
+    connections: Rc<RefCell<HashMap<u64, Rc<ConnectedSocket>>>>,
+    tasks: Rc<Gate>,
+}
+
+impl RpcServer {
+    /// Starts serving `protocol` on `addr`.
+    pub fn listen<S: 'static>(
+        protocol: Rc<RpcProtocol<S>>,
+        addr: SocketAddr,
+    ) -> Result<Self, RpcError> {
+        let socket = Rc::new(listen(addr, ListenOptions::default()).map_err(net_error)?);
+        let server = RpcServer {
+            socket: socket.clone(),
+            connections: Rc::new(RefCell::new(HashMap::new())),
+            tasks: Rc::new(Gate::new()),
+        };
+        let (connections, tasks) = (server.connections.clone(), server.tasks.clone());
+        let accept_loop = async move {
+            let mut next_id = 0;
+            while let Ok((socket, _)) = socket.accept().await {
+                let socket = Rc::new(socket);
+                let id = next_id;
+                next_id += 1;
+                connections.borrow_mut().insert(id, socket.clone());
+                let (protocol, connections, t) =
+                    (protocol.clone(), connections.clone(), tasks.clone());
+                let _ = tasks.spawn(async move {
+                    serve_connection(protocol, &socket, &t).await;
+                    connections.borrow_mut().remove(&id);
+                });
+            }
+        };
+        server.tasks.spawn(accept_loop).unwrap();
+        Ok(server)
+    }
+
+    /// Returns the address the server listens on.
+    pub fn local_address(&self) -> SocketAddr {
+        self.socket.local_address()
+    }
+
+    /// Stops accepting connections, closes the current ones, and waits for
+    /// the calls in progress to complete.
+    pub async fn stop(self) {
+        self.socket.abort_accept();
+        for socket in self.connections.borrow().values() {
+            socket.shutdown_input();
+        }
+        self.tasks.close().await;
+    }
+}
+
+async fn serve_connection<S: 'static>(
+    protocol: Rc<RpcProtocol<S>>,
+    socket: &ConnectedSocket,
+    tasks: &Rc<Gate>,
+) {
+    let mut input = socket.input();
+    let (frames, queued) = mpsc::channel(FRAME_QUEUE_SIZE);
+    if tasks.spawn(write_frames(socket.output(), queued)).is_err() {
+        return;
+    }
+    let mut compression = Compression(None);
+    while let Ok(Some(frame)) = read_frame(&mut input).await {
+        match frame.kind {
+            NEGOTIATE => {
+                compression = Compression(
+                    String::from_utf8_lossy(&frame.payload)
+                        .split(',')
+                        .find_map(|name| protocol.compressor(name)),
+                );
+                let chosen = compression.name().unwrap_or_default();
+                let reply = encode_unchecked(NEGOTIATE, 0, 0, chosen.as_bytes());
+                if frames.send(reply).await.is_err() {
+                    break;
+                }
+            }
+            REQUEST => {
+                let Frame { id, verb, .. } = frame;
+                let reply = compression
+                    .decompress(frame.payload)
+                    .and_then(|payload| (protocol.remote_handler(verb)?)(&payload));
+                let (frames, compression) = (frames.clone(), compression.clone());
+                let _ = tasks.spawn(async move {
+                    match reply {
+                        Err(err) => {
+                            let _ = frames.send(encode_error(id, &err)).await;
+                        }
+                        Ok(RemoteReply::Single(resp)) => {
+                            let resp = compression.compress(resp.await);
+                            let frame = encode(RESPONSE, id, verb, &resp)
+                                .unwrap_or_else(|err| encode_error(id, &err));
+                            let _ = frames.send(frame).await;
+                        }
+                        Ok(RemoteReply::Stream(mut items)) => {
+                            while let Some(item) = items.next().await {
+                                let item = compression.compress(item);
+                                let (frame, last) = match encode(STREAM_ITEM, id, verb, &item) {
+                                    Ok(frame) => (frame, false),
+                                    // Ends the stream on the client.
+                                    Err(err) => (encode_error(id, &err), true),
+                                };
+                                if frames.send(frame).await.is_err() || last {
+                                    return;
+                                }
+                            }
+                            let end = encode_unchecked(STREAM_END, id, verb, &[]);
+                            let _ = frames.send(end).await;
+                        }
+                    }
+                });
+            }
+            // Not a client.
+            _ => break,
+        }
+    }
+}
+
+/// The items of a remote stream, kept until they are consumed.
+///
+/// The connection never waits for a stream to be consumed, so that a slow
+/// stream does not hold up the replies to the other calls.
+#[derive(Default)]
+struct StreamQueue {
+    items: VecDeque<Result<Vec<u8>, RpcError>>,
+    // Set once no more items will come, with the error that ended the
+    // stream, if any, which is returned after the items.
+    end: Option<Result<(), RpcError>>,
+    waker: Option<Waker>,
+}
+
+impl StreamQueue {
+    fn push(&mut self, item: Result<Vec<u8>, RpcError>) {
+        self.items.push_back(item);
+        self.wake();
+    }
+
+    fn end(&mut self, end: Result<(), RpcError>) {
+        self.end.get_or_insert(end);
+        self.wake();
+    }
+
+    fn wake(&mut self) {
+        if let Some(waker) = self.waker.take() {
+            waker.wake();
+        }
+    }
+
+    fn poll_next(&mut self, cx: &mut Context<'_>) -> Poll<Option<Result<Vec<u8>, RpcError>>> {
+        if let Some(item) = self.items.pop_front() {
+            return Poll::Ready(Some(item));
+        }
+        match &mut self.end {
+            Some(end) => Poll::Ready(std::mem::replace(end, Ok(())).err().map(Err)),
+            None => {
+                self.waker = Some(cx.waker().clone());
+                Poll::Pending
+            }
+        }
+    }
+}
+
+enum Pending {
+    Call(oneshot::Sender<Result<Vec<u8>, RpcError>>),
+    Stream(Rc<RefCell<StreamQueue>>),
+}
+
+/// The client side of a connection, shared with the task reading replies.
+struct Connection<S> {
+    protocol: Rc<RpcProtocol<S>>,
+    socket: ConnectedSocket,
+    frames: mpsc::Sender<Vec<u8>>,
+    compression: Compression,
+    next_id: Cell<u64>,
+    pending: RefCell<HashMap<u64, Pending>>,
+    // Set once the replies can no longer be read.
+    closed: Cell<bool>,
+}
+
+impl<S: 'static> Connection<S> {
+    async fn request(
+        &self,
+        verb: u64,
+        payload: Vec<u8>,
+        pending: Pending,
+    ) -> Result<u64, RpcError> {
+        if self.closed.get() {
+            return Err(RpcError::ConnectionClosed);
+        }
+        let id = self.next_id.get();
+        self.next_id.set(id + 1);
+        let frame = encode(REQUEST, id, verb, &self.compression.compress(payload))?;
+        self.pending.borrow_mut().insert(id, pending);
+        if self.frames.send(frame).await.is_err() {
+            self.pending.borrow_mut().remove(&id);
+            return Err(RpcError::ConnectionClosed);
+        }
+        Ok(id)
+    }
+
+    fn dispatch(&self, frame: Frame) {
+        match frame.kind {
+            RESPONSE | ERROR => {
+                let result = match frame.kind {
+                    RESPONSE => self.compression.decompress(frame.payload),
+                    _ => Err(decode_error(&frame)),
+                };
+                match self.pending.borrow_mut().remove(&frame.id) {
+                    Some(Pending::Call(reply)) => {
+                        let _ = reply.send(result);
+                    }
+                    Some(Pending::Stream(items)) => {
+                        let err = result.err().unwrap_or(RpcError::WrongSignature(frame.verb));
+                        items.borrow_mut().end(Err(err));
+                    }
+                    None => (),
+                }
+            }
+            STREAM_ITEM | STREAM_END => {
+                let items = match self.pending.borrow().get(&frame.id) {
+                    Some(Pending::Stream(items)) => items.clone(),
+                    Some(Pending::Call(_)) => {
+                        self.fail(frame.id, RpcError::WrongSignature(frame.verb));
+                        return;
+                    }
+                    None => return,
+                };
+                if frame.kind == STREAM_END {
+                    self.pending.borrow_mut().remove(&frame.id);
+                    items.borrow_mut().end(Ok(()));
+                } else {
+                    items
+                        .borrow_mut()
+                        .push(self.compression.decompress(frame.payload));
+                }
+            }
+            _ => (),
+        }
+    }
+
+    fn fail(&self, id: u64, err: RpcError) {
+        match self.pending.borrow_mut().remove(&id) {
+            Some(Pending::Call(reply)) => {
+                let _ = reply.send(Err(err));
+            }
+            Some(Pending::Stream(items)) => items.borrow_mut().end(Err(err)),
+            None => (),
+        }
+    }
+
+    fn fail_all(&self) {
+        self.closed.set(true);
+        let ids: Vec<_> = self.pending.borrow().keys().copied().collect();
+        for id in ids {
+            self.fail(id, RpcError::ConnectionClosed);
+        }
+    }
+}
+
+async fn read_replies<S: 'static>(conn: Rc<Connection<S>>, mut input: InputStream) {
+    while let Ok(Some(frame)) = read_frame(&mut input).await {
+        conn.dispatch(frame);
+    }
+    conn.fail_all();
+}
+
+/// Removes the call from the pending ones if it is abandoned.
+struct PendingGuard<'a, S: 'static> {
+    conn: &'a Connection<S>,
+    id: u64,
+}
+
+impl<S: 'static> Drop for PendingGuard<'_, S> {
+    fn drop(&mut self) {
+        self.conn.pending.borrow_mut().remove(&self.id);
+    }
+}
+
+enum Target<S> {
+    Local {
+        protocol: Sharded<RpcProtocol<S>>,
+        shard: u32,
+    },
+    Remote(Rc<Connection<S>>),
+}
+
+/// Calls the verbs of an [`RpcProtocol`], on a shard of the current node
+/// or through a connection to another node.
+///
+/// Dropping a remote client closes its connection, failing the calls in
+/// progress with [`RpcError::ConnectionClosed`].
+pub struct RpcClient<S: 'static> {
+    target: Target<S>,
+}
+
+impl<S: 'static> RpcClient<S> {
+    /// Creates a client calling the instance of `protocol` on `shard`.
+    ///
+    /// Requests and responses are moved to and from `shard` as they are,
+    /// without being serialized.
+    pub fn local(protocol: &Sharded<RpcProtocol<S>>, shard: u32) -> Self {
+        RpcClient {
+            target: Target::Local {
+                protocol: protocol.clone(),
+                shard,
+            },
+        }
+    }
+
+    /// Connects to the [`RpcServer`] listening on `addr`. Messages are
+    /// encoded with the serializer of `protocol`, and compressed with the
+    /// first of its compressors the server also has.
+    pub async fn connect(protocol: Rc<RpcProtocol<S>>, addr: SocketAddr) -> Result<Self, RpcError> {
+        let socket = connect(addr).await.map_err(net_error)?;
+        let mut input = socket.input();
+        let mut output = socket.output();
+
+        let offered: Vec<_> = protocol.compressors.iter().map(|c| c.name()).collect();
+        let negotiation = encode(NEGOTIATE, 0, 0, offered.join(",").as_bytes())?;
+        output.write_all(&negotiation).await.map_err(net_error)?;
+        output.flush().await.map_err(net_error)?;
+        let reply = match read_frame(&mut input).await.map_err(net_error)? {
+            Some(frame) if frame.kind == NEGOTIATE => frame,
+            Some(_) => return Err(RpcError::Net("unexpected RPC frame".to_string())),
+            None => return Err(RpcError::ConnectionClosed),
+        };
+        let chosen = String::from_utf8_lossy(&reply.payload).into_owned();
+        let compression = Compression(protocol.compressor(&chosen));
+
+        let (frames, queued) = mpsc::channel(FRAME_QUEUE_SIZE);
+        spawn_detached(write_frames(output, queued));
+        let conn = Rc::new(Connection {
+            protocol,
+            socket,
+            frames,
+            compression,
+            next_id: Cell::new(0),
+            pending: RefCell::new(HashMap::new()),
+            closed: Cell::new(false),
+        });
+        spawn_detached(read_replies(conn.clone(), input));
+        Ok(RpcClient {
+            target: Target::Remote(conn),
+        })
+    }
+
+    /// Returns the name of the compression negotiated for the connection,
+    /// if any. Local clients never compress.
+    pub fn compression(&self) -> Option<&'static str> {
+        match &self.target {
+            Target::Local { .. } => None,
+            Target::Remote(conn) => conn.compression.name(),
+        }
+    }
+
+    /// Calls `verb` with `req`, and returns its response.
+    pub async fn call<Req, Resp>(&self, verb: Verb<Req, Resp>, req: Req) -> Result<Resp, RpcError>
+    where
+        S: RpcSerializer<Req> + RpcSerializer<Resp>,
+        Req: Send + 'static,
+        Resp: Send + 'static,
+    {
+        let verb = verb.id;
+        match &self.target {
+            Target::Local { protocol, shard } => {
+                protocol
+                    .invoke_on(*shard, move |protocol| async move {
+                        let handler = protocol.local_handler::<LocalFn<Req, Resp>>(verb)?;
+                        Ok(handler(req).await)
+                    })
+                    .await
+            }
+            Target::Remote(conn) => {
+                let serializer = &*conn.protocol.serializer;
+                let mut payload = Vec::new();
+                RpcSerializer::<Req>::write(serializer, &req, &mut payload);
+                let (reply, response) = oneshot::channel();
+                let id = conn.request(verb, payload, Pending::Call(reply)).await?;
+                let _guard = PendingGuard { conn, id };
+                match response.await {
+                    Ok(payload) => RpcSerializer::<Resp>::read(serializer, &payload?),
+                    Err(_) => Err(RpcError::ConnectionClosed),
+                }
+            }
+        }
+    }
+
+    /// Calls the streaming `verb` with `req`, and returns the stream of its
+    /// responses.
+    ///
+    /// The items of a remote stream are kept until they are consumed, without
+    /// holding up the other calls of the connection. Remote streams are not
+    /// cancelled when dropped: the server keeps producing the items, which
+    /// are discarded. Local streams stop before producing their next item.
+    pub async fn call_stream<Req, Resp>(
+        &self,
+        verb: StreamVerb<Req, Resp>,
+        req: Req,
+    ) -> Result<LocalBoxStream<'static, Result<Resp, RpcError>>, RpcError>
+    where
+        S: RpcSerializer<Req> + RpcSerializer<Resp>,
+        Req: Send + 'static,
+        Resp: Send + 'static,
+    {
+        let verb = verb.id;
+        match &self.target {
+            Target::Local { protocol, shard } => {
+                let items = protocol
+                    .invoke_on(*shard, move |protocol| async move {
+                        let handler = protocol.local_handler::<LocalStreamFn<Req, Resp>>(verb)?;
+                        let mut items = handler(req);
+                        let (sender, receiver) = shard_channel(DEFAULT_SHARD_CHANNEL_BATCH_SIZE);
+                        spawn_detached(async move {
+                            while !sender.is_closed() {
+                                match items.next().await {
+                                    // Checked by the loop condition.
+                                    Some(item) => {
+                                        let _ = sender.send(item);
+                                    }
+                                    None => break,
+                                }
+                            }
+                        });
+                        Ok(receiver)
+                    })
+                    .await?;
+                Ok(items.map(Ok).boxed_local())
+            }
+            Target::Remote(conn) => {
+                let mut payload = Vec::new();
+                RpcSerializer::<Req>::write(&*conn.protocol.serializer, &req, &mut payload);
+                let items = Rc::new(RefCell::new(StreamQueue::default()));
+                let pending = Pending::Stream(items.clone());
+                let id = conn.request(verb, payload, pending).await?;
+                let guard = StreamGuard {
+                    conn: conn.clone(),
+                    id,
+                };
+                let stream = futures::stream::poll_fn(move |cx| {
+                    let serializer = &*guard.conn.protocol.serializer;
+                    let item = ready!(items.borrow_mut().poll_next(cx)).map(|payload| {
+                        payload.and_then(|p| RpcSerializer::<Resp>::read(serializer, &p))
+                    });
+                    Poll::Ready(item)
+                });
+                Ok(stream.boxed_local())
+            }
+        }
+    }
+}
+
+/// Like [`PendingGuard`], owning the connection.
+struct StreamGuard<S: 'static> {
+    conn: Rc<Connection<S>>,
+    id: u64,
+}
+
+impl<S: 'static> Drop for StreamGuard<S> {
+    fn drop(&mut self) {
+        self.conn.pending.borrow_mut().remove(&self.id);
+    }
+}
+
+impl<S: 'static> Drop for RpcClient<S> {
+    fn drop(&mut self) {
+        if let Target::Remote(conn) = &self.target {
+            // Ends the task reading replies, which fails the pending calls.
+            conn.socket.shutdown_input();
+        }
+    }
+}
+
+#[cfg(test)]
+mod tests {
+    use super::*;
+    use crate as seastar;
+    use crate::{sleep, this_shard_id, yield_now};
+    use std::sync::atomic::{AtomicU32, Ordering};
+    use std::time::Duration;
+
+    struct TestSerializer;
+
+    impl RpcSerializer<u32> for TestSerializer {
+        fn write(&self, value: &u32, out: &mut Vec<u8>) {
+            out.extend_from_slice(&value.to_le_bytes());
+        }
+
+        fn read(&self, data: &[u8]) -> Result<u32, RpcError> {
+            let bytes = data
+                .try_into()
+                .map_err(|_| RpcError::Serialization("not a u32".to_string()))?;
+            Ok(u32::from_le_bytes(bytes))
+        }
+    }
+
+    impl RpcSerializer<String> for TestSerializer {
+        fn write(&self, value: &String, out: &mut Vec<u8>) {
+            out.extend_from_slice(value.as_bytes());
+        }
+
+        fn read(&self, data: &[u8]) -> Result<String, RpcError> {
+            String::from_utf8(data.to_vec()).map_err(|err| RpcError::Serialization(err.to_string()))
+        }
+    }
+
+    /// Proves that local calls are not serialized.
+    struct NoSerializer;
+
+    impl<T> RpcSerializer<T> for NoSerializer {
+        fn write(&self, _: &T, _: &mut Vec<u8>) {
+            panic!("local calls must not be serialized");
+        }
+
+        fn read(&self, _: &[u8]) -> Result<T, RpcError> {
+            panic!("local calls must not be deserialized");
+        }
+    }
+
+    /// Reverses the bytes, and counts the messages it compresses.
+    struct Reverse(Rc<Cell<u32>>);
+
+    impl RpcCompressor for Reverse {
+        fn name(&self) -> &'static str {
+            "reverse"
+        }
+
+        fn compress(&self, data: &[u8]) -> Vec<u8> {
+            self.0.set(self.0.get() + 1);
+            data.iter().rev().copied().collect()
+        }
+
+        fn decompress(&self, data: &[u8]) -> Result<Vec<u8>, RpcError> {
+            Ok(data.iter().rev().copied().collect())
+        }
+    }
+
+    const ECHO: Verb<String, String> = Verb::new(1);
+    const SHARD: Verb<(), u32> = Verb::new(2);
+    const COUNT: StreamVerb<u32, u32> = StreamVerb::new(3);
+
+    fn test_protocol() -> RpcProtocol<TestSerializer> {
+        let protocol = RpcProtocol::new(TestSerializer);
+        protocol.register(ECHO, |s: String| async move { s });
+        protocol.register_stream(COUNT, |n: u32| futures::stream::iter(0..n));
+        protocol
+    }
+
+    fn any_port() -> SocketAddr {
+        "127.0.0.1:0".parse().unwrap()
+    }
+
+    #[seastar::test]
+    async fn test_local_calls_are_not_serialized() {
+        let protocol = Sharded::start(|| {
+            let protocol = RpcProtocol::new(NoSerializer);
+            protocol.register(SHARD, |()| async { this_shard_id() });
+            protocol.register_stream(COUNT, |n: u32| futures::stream::iter(0..n));
+            protocol
+        })
+        .await;
+        let client = RpcClient::local(&protocol, 1);
+        assert_eq!(client.call(SHARD, ()).await, Ok(1));
+
+        let items: Vec<_> = client.call_stream(COUNT, 3).await.unwrap().collect().await;
+        assert_eq!(items, vec![Ok(0), Ok(1), Ok(2)]);
+
+        let unknown = Verb::<(), u32>::new(42);
+        assert_eq!(
+            client.call(unknown, ()).await,
+            Err(RpcError::UnknownVerb(42))
+        );
+        let mismatch = Verb::<u32, u32>::new(SHARD.id);
+        assert_eq!(
+            client.call(mismatch, 0).await,
+            Err(RpcError::WrongSignature(SHARD.id))
+        );
+        drop(client);
+        protocol.stop().await;
+    }
+
+    #[seastar::test]
+    async fn test_dropped_local_stream_stops() {
+        const FOREVER: StreamVerb<(), u32> = StreamVerb::new(5);
+        static PRODUCED: AtomicU32 = AtomicU32::new(0);
+        let protocol = Sharded::start(|| {
+            let protocol = RpcProtocol::new(NoSerializer);
+            protocol.register_stream(FOREVER, |()| {
+                futures::stream::unfold(0, |n| async move {
+                    yield_now().await;
+                    PRODUCED.fetch_add(1, Ordering::Relaxed);
+                    Some((n, n + 1))
+                })
+            });
+            protocol
+        })
+        .await;
+        let client = RpcClient::local(&protocol, 1);
+        let items: Vec<_> = client
+            .call_stream(FOREVER, ())
+            .await
+            .unwrap()
+            .take(3)
+            .collect()
+            .await;
+        assert_eq!(items, vec![Ok(0), Ok(1), Ok(2)]);
+        sleep(Duration::from_millis(10)).await;
+        let produced = PRODUCED.load(Ordering::Relaxed);
+        sleep(Duration::from_millis(10)).await;
+        assert_eq!(PRODUCED.load(Ordering::Relaxed), produced);
+        drop(client);
+        protocol.stop().await;
+    }
+
+    #[seastar::test]
+    async fn test_remote_calls() {
+        let protocol = Rc::new(test_protocol());
+        let server = RpcServer::listen(protocol.clone(), any_port()).unwrap();
+        let client = RpcClient::connect(protocol, server.local_address())
+            .await
+            .unwrap();
+        assert_eq!(client.compression(), None);
+
+        let (a, b) = futures::join!(
+            client.call(ECHO, "a".to_string()),
+            client.call(ECHO, "b".to_string())
+        );
+        assert_eq!((a.unwrap(), b.unwrap()), ("a".to_string(), "b".to_string()));
+
+        let items: Vec<_> = client
+            .call_stream(COUNT, 100)
+            .await
+            .unwrap()
+            .collect()
+            .await;
+        assert_eq!(items, (0..100).map(Ok).collect::<Vec<_>>());
+
+        let unknown = Verb::<String, String>::new(42);
+        let err = client.call(unknown, String::new()).await;
+        assert_eq!(err, Err(RpcError::UnknownVerb(42)));
+
+        drop(client);
+        server.stop().await;
+    }
+
+    #[seastar::test]
+    async fn test_unconsumed_stream_does_not_block_connection() {
+        const ENDLESS: StreamVerb<u32, u32> = StreamVerb::new(5);
+        let protocol = Rc::new(test_protocol());
+        protocol.register_stream(ENDLESS, |n: u32| {
+            futures::stream::iter(0..n).chain(futures::stream::pending())
+        });
+        let server = RpcServer::listen(protocol.clone(), any_port()).unwrap();
+        let client = RpcClient::connect(protocol, server.local_address())
+            .await
+            .unwrap();
+
+        let items = client.call_stream(ENDLESS, 1000).await.unwrap();
+        // Replies keep coming while the items of the stream pile up.
+        assert_eq!(client.call(ECHO, "a".to_string()).await.unwrap(), "a");
+
+        // The error ending the stream comes after all its items.
+        let items = futures::join!(items.collect::<Vec<_>>(), async {
+            sleep(Duration::from_millis(10)).await;
+            drop(client);
+        })
+        .0;
+        let mut expected: Vec<_> = (0..1000).map(Ok).collect();
+        expected.push(Err(RpcError::ConnectionClosed));
+        assert_eq!(items, expected);
+        server.stop().await;
+    }
+
+    #[seastar::test]
+    async fn test_oversized_frames_are_refused() {
+        let payload = vec![0; MAX_FRAME_SIZE + 1];
+        assert!(matches!(
+            encode(REQUEST, 0, 0, &payload),
+            Err(RpcError::Serialization(_))
+        ));
+    }
+
+    #[seastar::test]
+    async fn test_compression_negotiation() {
+        let server_count = Rc::new(Cell::new(0));
+        let server_protocol = test_protocol().with_compressor(Reverse(server_count.clone()));
+        let server = RpcServer::listen(Rc::new(server_protocol), any_port()).unwrap();
+
+        let client_count = Rc::new(Cell::new(0));
+        let client_protocol = test_protocol().with_compressor(Reverse(client_count.clone()));
+        let client = RpcClient::connect(Rc::new(client_protocol), server.local_address())
+            .await
+            .unwrap();
+        assert_eq!(client.compression(), Some("reverse"));
+        assert_eq!(client.call(ECHO, "abc".to_string()).await.unwrap(), "abc");
+        assert_eq!((client_count.get(), server_count.get()), (1, 1));
+
+        // The server does not know this client's compressors.
+        let plain = RpcClient::connect(Rc::new(test_protocol()), server.local_address())
+            .await
+            .unwrap();
+        assert_eq!(plain.compression(), None);
+        assert_eq!(plain.call(ECHO, "abc".to_string()).await.unwrap(), "abc");
+
+        drop((client, plain));
+        server.stop().await;
+    }
+
+    #[seastar::test]
+    async fn test_server_stop_completes_calls_in_progress() {
+        const SLOW: Verb<u32, u32> = Verb::new(4);
+        let started = Rc::new(Cell::new(false));
+        let protocol = Rc::new(test_protocol());
+        let s = started.clone();
+        protocol.register(SLOW, move |n: u32| {
+            s.set(true);
+            async move {
+                sleep(Duration::from_millis(10)).await;
+                n
+            }
+        });
+        let server = RpcServer::listen(protocol.clone(), any_port()).unwrap();
+        let client = RpcClient::connect(protocol, server.local_address())
+            .await
+            .unwrap();
+        let stop = async {
+            while !started.get() {
+                sleep(Duration::from_millis(1)).await;
+            }
+            server.stop().await;
+        };
+        let (resp, ()) = futures::join!(client.call(SLOW, 7), stop);
+        assert_eq!(resp, Ok(7));
+        // The server closed the connection.
+        let err = client.call(ECHO, String::new()).await;
+        assert_eq!(err, Err(RpcError::ConnectionClosed));
+    }
+}
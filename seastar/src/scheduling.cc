@@ -0,0 +1,41 @@
+#include "scheduling.hh"
+
+namespace seastar_ffi {
+namespace scheduling {
+
+static seastar::scheduling_group from_index(uint32_t group) {
+    return seastar::internal::scheduling_group_from_index((unsigned)group);
+}
+
+IntFuture create_scheduling_group(rust::Str name, float shares) {
+    auto sg = co_await seastar::create_scheduling_group(seastar::sstring(name.data(), name.size()), shares);
+    co_return (int)seastar::internal::scheduling_group_index(sg);
+}
+
+VoidFuture rename_scheduling_group(uint32_t group, rust::Str name) {
+    co_await seastar::rename_scheduling_group(from_index(group), seastar::sstring(name.data(), name.size()));
+}
+
+VoidFuture destroy_scheduling_group(uint32_t group) {
+    co_await seastar::destroy_scheduling_group(from_index(group));
+}
+
+uint32_t get_current_scheduling_group() {
+    return (uint32_t)seastar::internal::scheduling_group_index(seastar::current_scheduling_group());
+}
+
+rust::String get_scheduling_group_name(uint32_t group) {
+    const auto& name = from_index(group).name();
+    return rust::String(name.data(), name.size());
+}
+
+float get_scheduling_group_shares(uint32_t group) {
+    return from_index(group).get_shares();
+}
+
+void set_scheduling_group_shares(uint32_t group, float shares) {
+    from_index(group).set_shares(shares);
+}
+
+} // namespace scheduling
+} // namespace seastar_ffi
@@ -0,0 +1,26 @@
+#pragma once
+
+#include "cxx_async_futures.hh"
+#include <seastar/core/scheduling.hh>
+
+namespace seastar_ffi {
+namespace scheduling {
+
+// Scheduling groups cross the FFI as their indices.
+
+IntFuture create_scheduling_group(rust::Str name, float shares);
+
+VoidFuture rename_scheduling_group(uint32_t group, rust::Str name);
+
+VoidFuture destroy_scheduling_group(uint32_t group);
+
+uint32_t get_current_scheduling_group();
+
+rust::String get_scheduling_group_name(uint32_t group);
+
+float get_scheduling_group_shares(uint32_t group);
+
+void set_scheduling_group_shares(uint32_t group, float shares);
+
+} // namespace scheduling
+} // namespace seastar_ffi
@@ -0,0 +1,265 @@
+use crate::spawn::{new_task_in, JoinHandle};
+use crate::submit_to;
+use std::cell::RefCell;
+use std::future::Future;
+use std::time::Duration;
+use thiserror::Error;
+
+#[cxx::bridge]
+mod ffi {
+    #[namespace = "seastar_ffi"]
+    unsafe extern "C++" {
+        type VoidFuture = crate::cxx_async_futures::VoidFuture;
+        type IntFuture = crate::cxx_async_futures::IntFuture;
+    }
+
+    #[namespace = "seastar_ffi::scheduling"]
+    unsafe extern "C++" {
+        include!("seastar/src/scheduling.hh");
+
+        fn create_scheduling_group(name: &str, shares: f32) -> IntFuture;
+        fn rename_scheduling_group(group: u32, name: &str) -> VoidFuture;
+        fn destroy_scheduling_group(group: u32) -> VoidFuture;
+        fn get_current_scheduling_group() -> u32;
+        fn get_scheduling_group_name(group: u32) -> String;
+        fn get_scheduling_group_shares(group: u32) -> f32;
+        fn set_scheduling_group_shares(group: u32, shares: f32);
+    }
+}
+
+/// Error returned when an operation on a scheduling group fails,
+/// e.g. because the maximum number of groups has been reached.
+#[derive(Error, Debug)]
+#[error("SchedulingGroupError: {0}")]
+pub struct SchedulingGroupError(String);
+
+/// Identifies function calls that are accounted as a group.
+///
+/// A scheduling group can be used to identify tasks that are part of
+/// the same activity, e.g. foreground request handling and background
+/// compaction. Each group receives a share of the CPU proportional to
+/// its shares, so background work cannot starve foreground work.
+///
+/// Scheduling groups are created on all shards at once.
+#[derive(Clone, Copy, Debug, PartialEq, Eq, Hash)]
+pub struct SchedulingGroup {
+    id: u32,
+}
+
+impl Default for SchedulingGroup {
+    /// Returns the main (default) scheduling group.
+    fn default() -> Self {
+        SchedulingGroup { id: 0 }
+    }
+}
+
+impl SchedulingGroup {
+    /// Checks whether this is the main (default) scheduling group.
+    pub fn is_main(&self) -> bool {
+        self.id == 0
+    }
+
+    /// Returns the name of the group.
+    pub fn name(&self) -> String {
+        crate::assert_runtime_is_running();
+        ffi::get_scheduling_group_name(self.id)
+    }
+
+    /// Returns the shares of the group on the current shard.
+    pub fn get_shares(&self) -> f32 {
+        crate::assert_runtime_is_running();
+        ffi::get_scheduling_group_shares(self.id)
+    }
+
+    /// Adjusts the shares of the group on the current shard.
+    ///
+    /// The new value takes effect immediately.
+    pub fn set_shares(&self, shares: f32) {
+        crate::assert_runtime_is_running();
+        ffi::set_scheduling_group_shares(self.id, shares);
+    }
+
+    /// Returns statistics of the group on the current shard.
+    ///
+    /// Only tasks started with [`spawn_in`] (directly or through
+    /// [`submit_to_in`]) are accounted.
+    pub fn stats(&self) -> SchedulingGroupStats {
+        GROUP_STATS.with(|stats| {
+            stats
+                .borrow()
+                .get(self.id as usize)
+                .copied()
+                .unwrap_or_default()
+        })
+    }
+}
+
+/// Statistics of a [`SchedulingGroup`] on a single shard.
+#[derive(Clone, Copy, Debug, Default, PartialEq, Eq)]
+pub struct SchedulingGroupStats {
+    /// Total time spent polling the group's tasks.
+    pub runtime: Duration,
+    /// Number of polls of the group's tasks.
+    pub tasks_processed: u64,
+    /// Number of the group's tasks that have been spawned but have not finished yet.
+    pub pending_tasks: u64,
+}
+
+thread_local! {
+    static GROUP_STATS: RefCell<Vec<SchedulingGroupStats>> = RefCell::new(Vec::new());
+}
+
+fn with_group_stats(group: u32, f: impl FnOnce(&mut SchedulingGroupStats)) {
+    let _ = GROUP_STATS.try_with(|stats| {
+        let mut stats = stats.borrow_mut();
+        let index = group as usize;
+        if stats.len() <= index {
+            stats.resize(index + 1, SchedulingGroupStats::default());
+        }
+        f(&mut stats[index]);
+    });
+}
+
+pub(crate) fn record_spawn(group: u32) {
+    with_group_stats(group, |stats| stats.pending_tasks += 1);
+}
+
+pub(crate) fn record_poll(group: u32, runtime: Duration) {
+    with_group_stats(group, |stats| {
+        stats.runtime += runtime;
+        stats.tasks_processed += 1;
+    });
+}
+
+pub(crate) fn record_finish(group: u32) {
+    with_group_stats(group, |stats| stats.pending_tasks -= 1);
+}
+
+/// Creates a scheduling group with a specified number of shares.
+///
+/// The operation is global and affects all shards.
+///
+/// # Example
+///
+/// ```rust
+/// #[seastar::test]
+/// async fn create_scheduling_group_example() {
+///     let background = create_scheduling_group("background", 100.0).await.unwrap();
+///     spawn_in(background, async { /* compaction */ }).await;
+///     destroy_scheduling_group(background).await.unwrap();
+/// }
+/// ```
+pub async fn create_scheduling_group(
+    name: &str,
+    shares: f32,
+) -> Result<SchedulingGroup, SchedulingGroupError> {
+    crate::assert_runtime_is_running();
+    match ffi::create_scheduling_group(name, shares).await {
+        Ok(id) => Ok(SchedulingGroup { id: id as u32 }),
+        Err(err) => Err(SchedulingGroupError(err.what().to_string())),
+    }
+}
+
+/// Renames a scheduling group on all shards.
+pub async fn rename_scheduling_group(
+    group: SchedulingGroup,
+    name: &str,
+) -> Result<(), SchedulingGroupError> {
+    crate::assert_runtime_is_running();
+    ffi::rename_scheduling_group(group.id, name)
+        .await
+        .map_err(|err| SchedulingGroupError(err.what().to_string()))
+}
+
+/// Destroys a scheduling group on all shards.
+///
+/// The group must not be in use, and must not be the main group.
+pub async fn destroy_scheduling_group(group: SchedulingGroup) -> Result<(), SchedulingGroupError> {
+    crate::assert_runtime_is_running();
+    ffi::destroy_scheduling_group(group.id)
+        .await
+        .map_err(|err| SchedulingGroupError(err.what().to_string()))
+}
+
+/// Returns the scheduling group of the currently running task.
+pub fn current_scheduling_group() -> SchedulingGroup {
+    crate::assert_runtime_is_running();
+    SchedulingGroup {
+        id: ffi::get_current_scheduling_group(),
+    }
+}
+
+/// Spawns a new asynchronous task in the given scheduling group.
+///
+/// Same as [`spawn`](crate::spawn), but the task runs, and is accounted, as part of `group`.
+pub fn spawn_in<T, Ret: 'static>(group: SchedulingGroup, future: T) -> impl Future<Output = Ret>
+where
+    T: Future<Output = Ret> + 'static,
+{
+    JoinHandle::new(new_task_in(future, true, Some(group.id), None))
+}
+
+/// Runs a function `func` on a `shard_id` shard, in the given scheduling group.
+///
+/// Same as [`submit_to`], but `func` and the future it returns run as part of `group`.
+pub fn submit_to_in<Func, Fut, Ret>(
+    shard_id: u32,
+    group: SchedulingGroup,
+    func: Func,
+) -> impl Future<Output = Ret>
+where
+    Func: FnOnce() -> Fut + Send + 'static,
+    Fut: Future<Output = Ret> + 'static,
+    Ret: Send + 'static,
+{
+    submit_to(shard_id, move || {
+        spawn_in(group, async move { func().await })
+    })
+}
+
+#[cfg(test)]
+mod tests {
+    use super::*;
+    use crate as seastar;
+
+    #[seastar::test]
+    async fn test_default_scheduling_group() {
+        let group = current_scheduling_group();
+        assert!(group.is_main());
+        assert_eq!(group, SchedulingGroup::default());
+    }
+
+    #[seastar::test]
+    async fn test_create_rename_destroy_scheduling_group() {
+        let group = create_scheduling_group("background", 200.0).await.unwrap();
+        assert!(!group.is_main());
+        assert_eq!(group.name(), "background");
+        assert_eq!(group.get_shares(), 200.0);
+        group.set_shares(50.0);
+        assert_eq!(group.get_shares(), 50.0);
+        rename_scheduling_group(group, "compaction").await.unwrap();
+        assert_eq!(group.name(), "compaction");
+        destroy_scheduling_group(group).await.unwrap();
+    }
+
+    #[seastar::test]
+    async fn test_spawn_in() {
+        let group = create_scheduling_group("spawn_in", 100.0).await.unwrap();
+        let ret = spawn_in(group, async move { current_scheduling_group() }).await;
+        assert_eq!(ret, group);
+        let stats = group.stats();
+        assert!(stats.tasks_processed >= 1);
+        assert_eq!(stats.pending_tasks, 0);
+        destroy_scheduling_group(group).await.unwrap();
+    }
+
+    #[seastar::test]
+    async fn test_submit_to_in() {
+        let group = create_scheduling_group("submit_to_in", 100.0)
+            .await
+            .unwrap();
+        let ret = submit_to_in(1, group, || async { current_scheduling_group() }).await;
+        assert_eq!(ret, group);
+        destroy_scheduling_group(group).await.unwrap();
+    }
+}
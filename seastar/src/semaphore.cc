@@ -0,0 +1,64 @@
+#include "semaphore.hh"
+#include "result_slot.hh"
+
+namespace seastar_ffi {
+namespace semaphore {
+
+std::shared_ptr<semaphore> new_semaphore(size_t count, rust::Str name) {
+    return std::make_shared<semaphore>(count, seastar::named_semaphore_exception_factory{seastar::sstring(name.data(), name.size())});
+}
+
+bool try_wait(const std::shared_ptr<semaphore>& sem, size_t units) {
+    return sem->try_wait(units);
+}
+
+VoidFuture wait(
+        const std::shared_ptr<semaphore>& sem,
+        size_t units,
+        int64_t timeout_ns,
+        uint8_t* slot,
+        rust::Fn<bool(uint8_t*, int32_t)> deliver,
+        rust::Fn<void(uint8_t*)> releaser) {
+    slot_releaser release_on_return(slot, releaser);
+    // Keeps the semaphore alive even if the Rust side goes away mid-wait.
+    auto s = sem;
+    int32_t outcome = wait_ok;
+    try {
+        if (timeout_ns < 0) {
+            co_await s->wait(units);
+        } else {
+            auto timeout = std::chrono::duration_cast<semaphore::duration>(std::chrono::nanoseconds(timeout_ns));
+            co_await s->wait(semaphore::clock::now() + timeout, units);
+        }
+    } catch (const seastar::semaphore_timed_out&) {
+        outcome = wait_timed_out;
+    } catch (const seastar::broken_semaphore&) {
+        outcome = wait_broken;
+    }
+    if (!deliver(slot, outcome) && outcome == wait_ok) {
+        s->signal(units);
+    }
+}
+
+void signal(const std::shared_ptr<semaphore>& sem, size_t units) {
+    sem->signal(units);
+}
+
+void consume(const std::shared_ptr<semaphore>& sem, size_t units) {
+    sem->consume(units);
+}
+
+int64_t available_units(const std::shared_ptr<semaphore>& sem) {
+    return (int64_t)sem->available_units();
+}
+
+size_t waiters(const std::shared_ptr<semaphore>& sem) {
+    return sem->waiters();
+}
+
+void broken(const std::shared_ptr<semaphore>& sem) {
+    sem->broken();
+}
+
+} // namespace semaphore
+} // namespace seastar_ffi
@@ -0,0 +1,42 @@
+#pragma once
+
+#include "cxx_async_futures.hh"
+#include <seastar/core/semaphore.hh>
+
+namespace seastar_ffi {
+namespace semaphore {
+
+using semaphore = seastar::named_semaphore;
+
+// Outcomes of a wait, as delivered to Rust.
+constexpr int32_t wait_ok = 0;
+constexpr int32_t wait_timed_out = 1;
+constexpr int32_t wait_broken = 2;
+
+std::shared_ptr<semaphore> new_semaphore(size_t count, rust::Str name);
+
+bool try_wait(const std::shared_ptr<semaphore>& sem, size_t units);
+
+// Waits for `units`, giving up after `timeout_ns` unless it is negative.
+// The outcome is passed to `deliver`; if nobody is there to receive it,
+// acquired units are returned to the semaphore.
+VoidFuture wait(
+    const std::shared_ptr<semaphore>& sem,
+    size_t units,
+    int64_t timeout_ns,
+    uint8_t* slot,
+    rust::Fn<bool(uint8_t*, int32_t)> deliver,
+    rust::Fn<void(uint8_t*)> releaser);
+
+void signal(const std::shared_ptr<semaphore>& sem, size_t units);
+
+void consume(const std::shared_ptr<semaphore>& sem, size_t units);
+
+int64_t available_units(const std::shared_ptr<semaphore>& sem);
+
+size_t waiters(const std::shared_ptr<semaphore>& sem);
+
+void broken(const std::shared_ptr<semaphore>& sem);
+
+} // namespace semaphore
+} // namespace seastar_ffi
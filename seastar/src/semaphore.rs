@@ -0,0 +1,352 @@
+use crate::result_slot::{release_raw, SlotFuture, SlotRef};
+use cxx::SharedPtr;
+use std::future::Future;
+use std::time::Duration;
+use thiserror::Error;
+
+#[cxx::bridge(namespace = "seastar_ffi::semaphore")]
+mod ffi {
+    unsafe extern "C++" {
+        include!("seastar/src/semaphore.hh");
+
+        type semaphore;
+
+        #[namespace = "seastar_ffi"]
+        type VoidFuture = crate::cxx_async_futures::VoidFuture;
+
+        fn new_semaphore(count: usize, name: &str) -> SharedPtr<semaphore>;
+        fn try_wait(sem: &SharedPtr<semaphore>, units: usize) -> bool;
+        unsafe fn wait(
+            sem: &SharedPtr<semaphore>,
+            units: usize,
+            timeout_ns: i64,
+            slot: *mut u8,
+            deliver: unsafe fn(*mut u8, i32) -> bool,
+            releaser: unsafe fn(*mut u8),
+        ) -> VoidFuture;
+        fn signal(sem: &SharedPtr<semaphore>, units: usize);
+        fn consume(sem: &SharedPtr<semaphore>, units: usize);
+        fn available_units(sem: &SharedPtr<semaphore>) -> i64;
+        fn waiters(sem: &SharedPtr<semaphore>) -> usize;
+        fn broken(sem: &SharedPtr<semaphore>);
+    }
+}
+
+// Must match the outcomes in semaphore.hh.
+const WAIT_OK: i32 = 0;
+const WAIT_TIMED_OUT: i32 = 1;
+
+/// Error returned when waiting on a [`Semaphore`] fails.
+#[derive(Error, Debug)]
+pub enum SemaphoreError {
+    /// The timeout passed to [`wait_for`](Semaphore::wait_for) has expired.
+    #[error("SemaphoreTimedOut: semaphore timed out")]
+    TimedOut,
+    /// The semaphore has been [`broken`](Semaphore::broken).
+    #[error("BrokenSemaphore: semaphore broken")]
+    Broken,
+}
+
+unsafe fn deliver_wait_outcome(raw_slot: *mut u8, outcome: i32) -> bool {
+    let slot = SlotRef::<(), i32>::borrow_raw(raw_slot);
+    if slot.is_abandoned() {
+        return false;
+    }
+    slot.set_result(outcome);
+    true
+}
+
+/// Counted resource guard.
+///
+/// This is a standard computer science semaphore, adapted for futures.
+/// You can deposit units into a counter, or take them away. Taking units
+/// from the counter may wait if not enough units are available.
+///
+/// Waiters are served in FIFO order: a waiter never overtakes an earlier one,
+/// even if enough units are available for it.
+///
+/// A name may be given to a semaphore to make its errors easier to trace
+/// (`seastar::named_semaphore`).
+pub struct Semaphore {
+    inner: SharedPtr<ffi::semaphore>,
+}
+
+impl Semaphore {
+    /// Creates a semaphore with `count` available units.
+    pub fn new(count: usize) -> Self {
+        Self::new_named(count, "")
+    }
+
+    /// Creates a named semaphore with `count` available units.
+    pub fn new_named(count: usize, name: &str) -> Self {
+        Semaphore {
+            inner: ffi::new_semaphore(count, name),
+        }
+    }
+
+    /// Waits until `units` are available and takes them away.
+    ///
+    /// If enough units are available and nobody is waiting, completes
+    /// immediately without crossing into C++ asynchronously.
+    pub async fn wait(&self, units: usize) -> Result<(), SemaphoreError> {
+        self.wait_impl(units, -1).await
+    }
+
+    /// Same as [`wait`](Semaphore::wait), but gives up with
+    /// [`SemaphoreError::TimedOut`] after `timeout`.
+    pub async fn wait_for(&self, units: usize, timeout: Duration) -> Result<(), SemaphoreError> {
+        let timeout_ns = timeout.as_nanos().min(i64::MAX as u128) as i64;
+        self.wait_impl(units, timeout_ns).await
+    }
+
+    fn wait_impl(
+        &self,
+        units: usize,
+        timeout_ns: i64,
+    ) -> impl Future<Output = Result<(), SemaphoreError>> {
+        let acquired = self.try_wait(units);
+        let waiting = (!acquired).then(|| {
+            crate::assert_runtime_is_running();
+            let (slot, cpp_slot) = SlotRef::<(), i32>::new(());
+            let completion = unsafe {
+                ffi::wait(
+                    &self.inner,
+                    units,
+                    timeout_ns,
+                    cpp_slot.into_raw(),
+                    deliver_wait_outcome,
+                    release_raw::<(), i32>,
+                )
+            };
+            SlotFuture::new(completion, slot)
+        });
+        async move {
+            match waiting {
+                None => Ok(()),
+                Some(waiting) => match waiting.await {
+                    WAIT_OK => Ok(()),
+                    WAIT_TIMED_OUT => Err(SemaphoreError::TimedOut),
+                    _ => Err(SemaphoreError::Broken),
+                },
+            }
+        }
+    }
+
+    /// Takes `units` away if they are available and nobody is waiting.
+    ///
+    /// Returns whether the units were taken.
+    pub fn try_wait(&self, units: usize) -> bool {
+        ffi::try_wait(&self.inner, units)
+    }
+
+    /// Deposits `units` into the counter, waking up waiters if possible.
+    pub fn signal(&self, units: usize) {
+        ffi::signal(&self.inner, units);
+    }
+
+    /// Takes `units` away without waiting, even if this makes the counter negative.
+    pub fn consume(&self, units: usize) {
+        ffi::consume(&self.inner, units);
+    }
+
+    /// Returns the number of available units. Can be negative after [`consume`](Semaphore::consume).
+    pub fn available_units(&self) -> i64 {
+        ffi::available_units(&self.inner)
+    }
+
+    /// Returns the number of waiters.
+    pub fn waiters(&self) -> usize {
+        ffi::waiters(&self.inner)
+    }
+
+    /// Signals to all current and future waiters that the semaphore is broken,
+    /// making them fail with [`SemaphoreError::Broken`].
+    pub fn broken(&self) {
+        ffi::broken(&self.inner);
+    }
+}
+
+impl Drop for Semaphore {
+    fn drop(&mut self) {
+        // Nobody could signal the semaphore anymore,
+        // so release whoever is still waiting.
+        self.broken();
+    }
+}
+
+/// Units taken from a [`Semaphore`], returned to it when dropped (RAII).
+///
+/// Obtained from [`get_units`] or [`try_get_units`].
+#[must_use]
+pub struct SemaphoreUnits<'a> {
+    sem: &'a Semaphore,
+    units: usize,
+}
+
+impl<'a> SemaphoreUnits<'a> {
+    /// Returns the number of units held.
+    pub fn count(&self) -> usize {
+        self.units
+    }
+
+    /// Returns `units` to the semaphore early.
+    ///
+    /// Panics if fewer units are held.
+    pub fn release(&mut self, units: usize) {
+        assert!(units <= self.units, "Releasing more units than held");
+        self.units -= units;
+        self.sem.signal(units);
+    }
+
+    /// Moves `units` into a new, separate holder.
+    ///
+    /// Panics if fewer units are held.
+    pub fn split(&mut self, units: usize) -> SemaphoreUnits<'a> {
+        assert!(units <= self.units, "Splitting more units than held");
+        self.units -= units;
+        SemaphoreUnits {
+            sem: self.sem,
+            units,
+        }
+    }
+}
+
+impl<'a> Drop for SemaphoreUnits<'a> {
+    fn drop(&mut self) {
+        if self.units > 0 {
+            self.sem.signal(self.units);
+        }
+    }
+}
+
+/// Takes `units` from `sem`, returning them when the resulting holder is dropped.
+pub async fn get_units(
+    sem: &Semaphore,
+    units: usize,
+) -> Result<SemaphoreUnits<'_>, SemaphoreError> {
+    sem.wait(units).await?;
+    Ok(SemaphoreUnits { sem, units })
+}
+
+/// Same as [`get_units`], but fails with [`SemaphoreError::TimedOut`] after `timeout`.
+pub async fn get_units_for(
+    sem: &Semaphore,
+    units: usize,
+    timeout: Duration,
+) -> Result<SemaphoreUnits<'_>, SemaphoreError> {
+    sem.wait_for(units, timeout).await?;
+    Ok(SemaphoreUnits { sem, units })
+}
+
+/// Takes `units` from `sem` if they are available right away.
+pub fn try_get_units(sem: &Semaphore, units: usize) -> Option<SemaphoreUnits<'_>> {
+    sem.try_wait(units).then_some(SemaphoreUnits { sem, units })
+}
+
+/// Runs `func` while holding `units` of `sem`.
+///
+/// # Example
+///
+/// ```rust
+/// #[seastar::test]
+/// async fn with_semaphore_example() {
+///     let disk_concurrency = Semaphore::new(8);
+///     let ret = with_semaphore(&disk_concurrency, 1, || async { 42 }).await;
+///     assert!(matches!(ret, Ok(42)));
+/// }
+/// ```
+pub async fn with_semaphore<Func, Fut, Ret>(
+    sem: &Semaphore,
+    units: usize,
+    func: Func,
+) -> Result<Ret, SemaphoreError>
+where
+    Func: FnOnce() -> Fut,
+    Fut: Future<Output = Ret>,
+{
+    let _units = get_units(sem, units).await?;
+    Ok(func().await)
+}
+
+#[cfg(test)]
+mod tests {
+    use super::*;
+    use crate as seastar;
+    use futures::join;
+    use std::{cell::RefCell, rc::Rc};
+
+    #[seastar::test(shared)]
+    async fn test_semaphore_try_wait_signal() {
+        let sem = Semaphore::new(2);
+        assert!(sem.try_wait(2));
+        assert!(!sem.try_wait(1));
+        sem.signal(1);
+        assert_eq!(sem.available_units(), 1);
+        sem.consume(3);
+        assert_eq!(sem.available_units(), -2);
+    }
+
+    #[seastar::test(shared)]
+    async fn test_semaphore_wait_until_signalled() {
+        let sem = Semaphore::new(0);
+        let waited = Rc::new(RefCell::new(false));
+
+        let wait_future = async {
+            sem.wait(1).await.unwrap();
+            *waited.borrow_mut() = true;
+        };
+        let signal_future = async {
+            assert!(!*waited.borrow());
+            assert_eq!(sem.waiters(), 1);
+            sem.signal(1);
+        };
+
+        join!(wait_future, signal_future);
+        assert!(*waited.borrow());
+    }
+
+    #[seastar::test(shared)]
+    async fn test_semaphore_wait_for_times_out() {
+        let sem = Semaphore::new_named(0, "test");
+        let ret = sem.wait_for(1, Duration::from_millis(10)).await;
+        assert!(matches!(ret, Err(SemaphoreError::TimedOut)));
+        assert_eq!(sem.waiters(), 0);
+    }
+
+    #[seastar::test(shared)]
+    async fn test_semaphore_broken() {
+        let sem = Semaphore::new(0);
+        let wait_future = async { sem.wait(1).await };
+        let break_future = async { sem.broken() };
+        let (ret, ()) = join!(wait_future, break_future);
+        assert!(matches!(ret, Err(SemaphoreError::Broken)));
+    }
+
+    #[seastar::test(shared)]
+    async fn test_semaphore_units() {
+        let sem = Semaphore::new(3);
+        {
+            let mut units = get_units(&sem, 3).await.unwrap();
+            assert_eq!(sem.available_units(), 0);
+            let split = units.split(1);
+            units.release(1);
+            assert_eq!(units.count(), 1);
+            assert_eq!(split.count(), 1);
+            assert_eq!(sem.available_units(), 1);
+            assert!(try_get_units(&sem, 2).is_none());
+        }
+        assert_eq!(sem.available_units(), 3);
+    }
+
+    #[seastar::test(shared)]
+    async fn test_with_semaphore() {
+        let sem = Semaphore::new(1);
+        let ret = with_semaphore(&sem, 1, || async {
+            assert_eq!(sem.available_units(), 0);
+            42
+        })
+        .await;
+        assert!(matches!(ret, Ok(42)));
+        assert_eq!(sem.available_units(), 1);
+    }
+}
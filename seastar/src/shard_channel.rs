@@ -0,0 +1,325 @@
+use crate::spawn_detached;
+use futures::Stream;
+use std::cell::{Cell, RefCell};
+use std::collections::VecDeque;
+use std::pin::Pin;
+use std::rc::Rc;
+use std::sync::atomic::{AtomicBool, Ordering};
+use std::sync::{Arc, Mutex};
+use std::task::{Context, Poll, Waker};
+
+/// Default number of values a [`ShardSender`] collects before handing them over.
+pub const DEFAULT_SHARD_CHANNEL_BATCH_SIZE: usize = 128;
+
+struct State<T> {
+    /// Batches handed over by the sender, oldest first.
+    batches: VecDeque<Vec<T>>,
+    /// Emptied batches handed back by the receiver, so that their memory
+    /// is reused on the sender's shard instead of being freed on the receiver's.
+    spares: Vec<Vec<T>>,
+    waker: Option<Waker>,
+    closed: bool,
+}
+
+struct Shared<T> {
+    state: Mutex<State<T>>,
+    // Set, under the lock, when the receiver is dropped. It is read on every
+    // send, which does not take the lock.
+    receiver_dropped: AtomicBool,
+}
+
+impl<T> Shared<T> {
+    fn lock(&self) -> std::sync::MutexGuard<'_, State<T>> {
+        self.state.lock().unwrap()
+    }
+}
+
+/// Sender-side state, shared with the task flushing it.
+struct SenderLocal<T> {
+    batch: RefCell<Vec<T>>,
+    batch_size: usize,
+    flush_scheduled: Cell<bool>,
+    shared: Arc<Shared<T>>,
+}
+
+impl<T> SenderLocal<T> {
+    fn flush(&self) {
+        let mut batch = self.batch.borrow_mut();
+        if batch.is_empty() {
+            return;
+        }
+        let waker = {
+            let mut state = self.shared.lock();
+            if self.shared.receiver_dropped.load(Ordering::Relaxed) {
+                // Nobody receives the values anymore. Drop them here, on the
+                // sender's shard, with those handed over but not received.
+                let stale = std::mem::take(&mut state.batches);
+                drop(state);
+                batch.clear();
+                drop(stale);
+                return;
+            }
+            let spare = state.spares.pop().unwrap_or_default();
+            state
+                .batches
+                .push_back(std::mem::replace(&mut *batch, spare));
+            state.waker.take()
+        };
+        if let Some(waker) = waker {
+            waker.wake();
+        }
+    }
+}
+
+impl<T> Drop for SenderLocal<T> {
+    fn drop(&mut self) {
+        self.flush();
+        let waker = {
+            let mut state = self.shared.lock();
+            state.closed = true;
+            state.waker.take()
+        };
+        if let Some(waker) = waker {
+            waker.wake();
+        }
+    }
+}
+
+/// Creates a channel for moving values from the current shard to another one,
+/// handing them over in batches of up to `batch_size` values.
+///
+/// Sending a value only appends it to a local batch. The batch is handed over
+/// to the receiver, with one synchronization and at most one wakeup, when it
+/// is full, when [`flush`](ShardSender::flush) is called, or when the sending
+/// task yields to the scheduler (e.g. when it waits or is preempted).
+/// The receiver takes whole batches at once too. This amortizes
+/// cross-shard cache traffic over the whole batch, instead of paying it
+/// per value as with a [`submit_to`](crate::submit_to) per message.
+///
+/// The [`ShardSender`] stays on the current shard; the [`ShardReceiver`]
+/// is moved to the receiving shard. The channel is unbounded.
+///
+/// # Example
+///
+/// ```rust
+/// #[seastar::test]
+/// async fn shard_channel_example() {
+///     let (tx, rx) = shard_channel(DEFAULT_SHARD_CHANNEL_BATCH_SIZE);
+///     let sum = submit_to(1, move || async move { rx.fold(0, |acc, x| async move { acc + x }).await });
+///     for i in 0..1000 {
+///         tx.send(i).unwrap();
+///     }
+///     drop(tx);
+///     assert_eq!(sum.await, 499500);
+/// }
+/// ```
+pub fn shard_channel<T: Send + 'static>(batch_size: usize) -> (ShardSender<T>, ShardReceiver<T>) {
+    assert!(batch_size > 0, "Batch size must be positive");
+    let shared = Arc::new(Shared {
+        state: Mutex::new(State {
+            batches: VecDeque::new(),
+            spares: Vec::new(),
+            waker: None,
+            closed: false,
+        }),
+        receiver_dropped: AtomicBool::new(false),
+    });
+    let sender = ShardSender {
+        local: Rc::new(SenderLocal {
+            batch: RefCell::new(Vec::with_capacity(batch_size)),
+            batch_size,
+            flush_scheduled: Cell::new(false),
+            shared: shared.clone(),
+        }),
+    };
+    let receiver = ShardReceiver {
+        shared,
+        current: Vec::new(),
+    };
+    (sender, receiver)
+}
+
+/// The sending half of a [`shard_channel`], bound to the shard that created it.
+///
+/// The channel is closed when the sender is dropped, after the values
+/// sent so far have been handed over.
+pub struct ShardSender<T: Send + 'static> {
+    local: Rc<SenderLocal<T>>,
+}
+
+impl<T: Send + 'static> ShardSender<T> {
+    /// Sends `value`. Never waits.
+    ///
+    /// Returns the value back if the receiver has been dropped.
+    pub fn send(&self, value: T) -> Result<(), T> {
+        if self.is_closed() {
+            return Err(value);
+        }
+        let full = {
+            let mut batch = self.local.batch.borrow_mut();
+            batch.push(value);
+            batch.len() >= self.local.batch_size
+        };
+        if full {
+            self.local.flush();
+        } else if !self.local.flush_scheduled.replace(true) {
+            // Runs once the current task yields.
+            let local = self.local.clone();
+            spawn_detached(async move {
+                local.flush_scheduled.set(false);
+                local.flush();
+            });
+        }
+        Ok(())
+    }
+
+    /// Hands the values sent so far over to the receiver right away.
+    pub fn flush(&self) {
+        self.local.flush();
+    }
+
+    /// Checks whether the receiver was dropped, in which case the values
+    /// sent are never received, and the sender may as well stop.
+    pub fn is_closed(&self) -> bool {
+        self.local.shared.receiver_dropped.load(Ordering::Relaxed)
+    }
+}
+
+/// The receiving half of a [`shard_channel`], a [`Stream`] of the sent values.
+///
+/// It can be moved to any shard. The stream ends when the sender is dropped
+/// and all values have been received.
+pub struct ShardReceiver<T> {
+    shared: Arc<Shared<T>>,
+    /// The batch being received, in reverse order.
+    current: Vec<T>,
+}
+
+impl<T> ShardReceiver<T> {
+    fn take_batch(&mut self, state: &mut State<T>) -> bool {
+        match state.batches.pop_front() {
+            Some(mut batch) => {
+                batch.reverse();
+                let empty = std::mem::replace(&mut self.current, batch);
+                if empty.capacity() > 0 {
+                    state.spares.push(empty);
+                }
+                true
+            }
+            None => false,
+        }
+    }
+
+    /// Returns the next value if one has been handed over already.
+    pub fn try_recv(&mut self) -> Option<T> {
+        if self.current.is_empty() {
+            let shared = self.shared.clone();
+            let mut state = shared.lock();
+            self.take_batch(&mut state);
+        }
+        self.current.pop()
+    }
+}
+
+impl<T> Stream for ShardReceiver<T> {
+    type Item = T;
+
+    fn poll_next(self: Pin<&mut Self>, cx: &mut Context<'_>) -> Poll<Option<T>> {
+        let this = self.get_mut();
+        if let Some(value) = this.current.pop() {
+            return Poll::Ready(Some(value));
+        }
+        let shared = this.shared.clone();
+        let mut state = shared.lock();
+        if this.take_batch(&mut state) {
+            return Poll::Ready(this.current.pop());
+        }
+        if state.closed {
+            return Poll::Ready(None);
+        }
+        match &state.waker {
+            Some(waker) if waker.will_wake(cx.waker()) => (),
+            _ => state.waker = Some(cx.waker().clone()),
+        }
+        Poll::Pending
+    }
+}
+
+impl<T> Drop for ShardReceiver<T> {
+    fn drop(&mut self) {
+        let _state = self.shared.lock();
+        self.shared.receiver_dropped.store(true, Ordering::Relaxed);
+    }
+}
+
+#[cfg(test)]
+mod tests {
+    use super::*;
+    use crate as seastar;
+    use crate::submit_to;
+    use futures::StreamExt;
+
+    #[seastar::test]
+    async fn test_shard_channel_across_shards() {
+        let (tx, rx) = shard_channel(16);
+        let received = submit_to(1, move || async move { rx.collect::<Vec<u32>>().await });
+        for i in 0..1000 {
+            tx.send(i).unwrap();
+        }
+        drop(tx);
+        assert_eq!(received.await, (0..1000).collect::<Vec<_>>());
+    }
+
+    #[seastar::test]
+    async fn test_shard_channel_flushes_on_yield() {
+        let (tx, mut rx) = shard_channel(DEFAULT_SHARD_CHANNEL_BATCH_SIZE);
+        tx.send(1).unwrap();
+        assert_eq!(rx.try_recv(), None);
+        crate::yield_now().await;
+        assert_eq!(rx.try_recv(), Some(1));
+        tx.send(2).unwrap();
+        tx.flush();
+        assert_eq!(rx.try_recv(), Some(2));
+    }
+
+    #[seastar::test]
+    async fn test_shard_channel_reuses_batches() {
+        let (tx, mut rx) = shard_channel(4);
+        for i in 0..4 {
+            tx.send(i).unwrap();
+        }
+        for i in 0..4 {
+            assert_eq!(rx.try_recv(), Some(i));
+        }
+        for i in 4..8 {
+            tx.send(i).unwrap();
+        }
+        assert_eq!(rx.try_recv(), Some(4));
+        assert!(!rx.shared.lock().spares.is_empty());
+        drop(tx);
+        assert_eq!(rx.collect::<Vec<_>>().await, [5, 6, 7]);
+    }
+
+    #[seastar::test]
+    async fn test_shard_channel_receiver_dropped() {
+        let (tx, rx) = shard_channel::<u32>(DEFAULT_SHARD_CHANNEL_BATCH_SIZE);
+        assert!(!tx.is_closed());
+        submit_to(1, move || async move { drop(rx) }).await;
+        assert!(tx.is_closed());
+        assert_eq!(tx.send(1), Err(1));
+    }
+
+    #[seastar::test]
+    async fn test_shard_channel_drops_unsent_values_locally() {
+        let counter = Arc::new(());
+        let (tx, rx) = shard_channel(DEFAULT_SHARD_CHANNEL_BATCH_SIZE);
+        tx.send(counter.clone()).unwrap();
+        tx.flush();
+        tx.send(counter.clone()).unwrap();
+        drop(rx);
+        // Both the value handed over and the batched one are dropped here.
+        tx.flush();
+        assert_eq!(Arc::strong_count(&counter), 1);
+        assert!(tx.send(counter.clone()).is_err());
+    }
+}
@@ -0,0 +1,375 @@
+use crate::{invoke_on_all, smp_count, submit_to, this_shard_id, Gate};
+use std::cell::RefCell;
+use std::future::Future;
+use std::rc::Rc;
+use std::sync::Arc;
+
+struct ShardState<T> {
+    service: RefCell<Option<Rc<T>>>,
+    gate: Gate,
+}
+
+/// One [`ShardState`] per shard.
+///
+/// The slots are shared by all shards, but the slot of a shard is only ever
+/// touched by the reactor thread of that shard, as `Slots::local` asserts.
+/// That thread creates the service, hands it out only to the code running
+/// on it, and destroys it, and `Slots::drop` never touches the services. So
+/// neither the `RefCell`s nor the services are accessed by more than one
+/// thread, and no service ever moves to another one, whether it is `Send`
+/// or not.
+struct Slots<T>(Box<[ShardState<T>]>);
+
+unsafe impl<T> Send for Slots<T> {}
+unsafe impl<T> Sync for Slots<T> {}
+
+impl<T> Slots<T> {
+    fn local(&self) -> &ShardState<T> {
+        // Off the reactor threads, the shard id would not name a slot owned
+        // by the current thread.
+        crate::assert_runtime_is_running();
+        &self.0[this_shard_id() as usize]
+    }
+}
+
+impl<T> Drop for Slots<T> {
+    fn drop(&mut self) {
+        for state in self.0.iter_mut() {
+            // The service must be destroyed on its own shard, which is what
+            // `Sharded::stop` does. There is no way to do that from here.
+            if let Some(service) = state.service.get_mut().take() {
+                std::mem::forget(service);
+            }
+        }
+    }
+}
+
+/// Template helper for distributed services.
+///
+/// `Sharded` creates one instance of `T` on each shard and provides access
+/// to the local instance without any locks or cross-core atomics. Each call
+/// delivered to an instance holds that shard's [`Gate`], so [`stop`](Sharded::stop)
+/// waits for in-flight calls before destroying the instances.
+///
+/// Cloning a `Sharded` creates another handle to the same set of instances.
+/// The instances must be stopped with [`stop`](Sharded::stop) before the last
+/// handle is dropped; otherwise they are leaked.
+///
+/// # Example
+///
+/// ```rust
+/// #[seastar::test]
+/// async fn sharded_example() {
+///     let counters = Sharded::start(|| Cell::new(0)).await;
+///     counters.invoke_on_all(|c| async move { c.set(c.get() + 1) }).await;
+///     assert_eq!(counters.local().get(), 1);
+///     counters.stop().await;
+/// }
+/// ```
+pub struct Sharded<T> {
+    slots: Arc<Slots<T>>,
+}
+
+impl<T> Clone for Sharded<T> {
+    fn clone(&self) -> Self {
+        Sharded {
+            slots: self.slots.clone(),
+        }
+    }
+}
+
+impl<T: 'static> Sharded<T> {
+    /// Starts the service by calling `factory` once on every shard.
+    pub async fn start<Factory>(factory: Factory) -> Self
+    where
+        Factory: FnOnce() -> T + Clone + Send + 'static,
+    {
+        let states = (0..smp_count())
+            .map(|_| ShardState {
+                service: RefCell::new(None),
+                gate: Gate::new(),
+            })
+            .collect();
+        let sharded = Sharded {
+            slots: Arc::new(Slots(states)),
+        };
+
+        let slots = sharded.slots.clone();
+        invoke_on_all(move || async move {
+            let service = Rc::new(factory());
+            *slots.local().service.borrow_mut() = Some(service);
+        })
+        .await;
+        sharded
+    }
+
+    /// Stops all instances.
+    ///
+    /// On every shard, waits for the calls delivered through [`invoke_on`](Sharded::invoke_on)
+    /// and [`invoke_on_all`](Sharded::invoke_on_all) to finish, then drops the instance.
+    /// Copies obtained from [`local`](Sharded::local) keep their instance alive
+    /// until they are dropped.
+    ///
+    /// It must be called at most once.
+    pub async fn stop(&self) {
+        let slots = self.slots.clone();
+        invoke_on_all(move || async move {
+            let state = slots.local();
+            state.gate.close().await;
+            let service = state.service.borrow_mut().take();
+            drop(service);
+        })
+        .await;
+    }
+
+    /// Returns the instance on the current shard.
+    ///
+    /// Panics if the service is not running.
+    pub fn local(&self) -> Rc<T> {
+        self.slots
+            .local()
+            .service
+            .borrow()
+            .clone()
+            .expect("Sharded service is not running")
+    }
+
+    /// Invokes `func` on the instance on `shard`.
+    ///
+    /// Panics if the service has been stopped.
+    pub fn invoke_on<Func, Fut, Ret>(&self, shard: u32, func: Func) -> impl Future<Output = Ret>
+    where
+        Func: FnOnce(Rc<T>) -> Fut + Send + 'static,
+        Fut: Future<Output = Ret> + 'static,
+        Ret: Send + 'static,
+    {
+        let slots = self.slots.clone();
+        submit_to(
+            shard,
+            move || async move { invoke_local(&slots, func).await },
+        )
+    }
+
+    /// Invokes `func` on the instances on all shards.
+    ///
+    /// Panics if the service has been stopped.
+    pub fn invoke_on_all<Func, Fut>(&self, func: Func) -> impl Future<Output = ()>
+    where
+        Func: FnOnce(Rc<T>) -> Fut + Clone + Send + 'static,
+        Fut: Future<Output = ()> + 'static,
+    {
+        let slots = self.slots.clone();
+        invoke_on_all(move || async move { invoke_local(&slots, func).await })
+    }
+}
+
+async fn invoke_local<T, Func, Fut, Ret>(slots: &Slots<T>, func: Func) -> Ret
+where
+    Func: FnOnce(Rc<T>) -> Fut,
+    Fut: Future<Output = Ret>,
+{
+    let state = slots.local();
+    let _holder = state
+        .gate
+        .try_enter()
+        .expect("Sharded service has been stopped");
+    let service = state.service.borrow().clone().unwrap();
+    func(service).await
+}
+
+/// A distributed service whose instances are created on first use.
+///
+/// Unlike [`Sharded`], which creates all instances up front, `LazySharded`
+/// creates the instance of a shard the first time it is accessed on that
+/// shard, so starting it costs nothing and shards that never use the
+/// service never pay for it. This is useful to keep the startup of the app
+/// short when the instances are expensive to create.
+///
+/// Cloning a `LazySharded` creates another handle to the same set of
+/// instances. As with [`Sharded`], the instances must be stopped with
+/// [`stop`](LazySharded::stop) before the last handle is dropped; otherwise
+/// they are leaked.
+///
+/// # Example
+///
+/// ```rust
+/// #[seastar::test]
+/// async fn lazy_sharded_example() {
+///     let caches = LazySharded::new(|| RefCell::new(HashMap::<u32, u32>::new()));
+///     caches.local().borrow_mut().insert(1, 2);
+///     caches.stop().await;
+/// }
+/// ```
+pub struct LazySharded<T> {
+    slots: Arc<Slots<T>>,
+    factory: Arc<dyn Fn() -> T + Send + Sync>,
+}
+
+impl<T> Clone for LazySharded<T> {
+    fn clone(&self) -> Self {
+        LazySharded {
+            slots: self.slots.clone(),
+            factory: self.factory.clone(),
+        }
+    }
+}
+
+impl<T: 'static> LazySharded<T> {
+    /// Creates the service. `factory` is called on a shard when its instance
+    /// is first needed.
+    ///
+    /// Must be called in a Seastar runtime.
+    pub fn new<Factory>(factory: Factory) -> Self
+    where
+        Factory: Fn() -> T + Send + Sync + 'static,
+    {
+        let states = (0..smp_count())
+            .map(|_| ShardState {
+                service: RefCell::new(None),
+                gate: Gate::new(),
+            })
+            .collect();
+        LazySharded {
+            slots: Arc::new(Slots(states)),
+            factory: Arc::new(factory),
+        }
+    }
+
+    /// Stops all instances.
+    ///
+    /// On every shard, waits for the calls delivered through
+    /// [`invoke_on`](LazySharded::invoke_on) to finish, then drops the
+    /// instance, if it was created. Copies obtained from
+    /// [`local`](LazySharded::local) keep their instance alive until they
+    /// are dropped.
+    ///
+    /// It must be called at most once.
+    pub async fn stop(&self) {
+        let slots = self.slots.clone();
+        invoke_on_all(move || async move {
+            let state = slots.local();
+            state.gate.close().await;
+            let service = state.service.borrow_mut().take();
+            drop(service);
+        })
+        .await;
+    }
+
+    /// Returns the instance on the current shard, creating it if needed.
+    ///
+    /// Panics if the service has been stopped.
+    pub fn local(&self) -> Rc<T> {
+        local_or_create(&self.slots, &*self.factory)
+    }
+
+    /// Returns the instance on the current shard, if it has been created.
+    pub fn try_local(&self) -> Option<Rc<T>> {
+        self.slots.local().service.borrow().clone()
+    }
+
+    /// Invokes `func` on the instance on `shard`, creating it if needed.
+    ///
+    /// Panics if the service has been stopped.
+    pub fn invoke_on<Func, Fut, Ret>(&self, shard: u32, func: Func) -> impl Future<Output = Ret>
+    where
+        Func: FnOnce(Rc<T>) -> Fut + Send + 'static,
+        Fut: Future<Output = Ret> + 'static,
+        Ret: Send + 'static,
+    {
+        let this = self.clone();
+        submit_to(shard, move || async move {
+            let state = this.slots.local();
+            let _holder = state
+                .gate
+                .try_enter()
+                .expect("Sharded service has been stopped");
+            func(this.local()).await
+        })
+    }
+}
+
+fn local_or_create<T>(slots: &Slots<T>, factory: &dyn Fn() -> T) -> Rc<T> {
+    let state = slots.local();
+    if state.gate.is_closed() {
+        panic!("Sharded service has been stopped");
+    }
+    if let Some(service) = &*state.service.borrow() {
+        return service.clone();
+    }
+    // The factory is called without holding the borrow, so that it may
+    // access other services.
+    let service = Rc::new(factory());
+    state.service.borrow_mut().get_or_insert(service).clone()
+}
+
+#[cfg(test)]
+mod tests {
+    use super::*;
+    use crate as seastar;
+    use std::cell::Cell;
+
+    #[seastar::test]
+    async fn test_sharded_start_stop() {
+        let sharded = Sharded::start(|| ()).await;
+        sharded.stop().await;
+    }
+
+    #[seastar::test]
+    async fn test_sharded_instance_per_shard() {
+        let sharded = Sharded::start(this_shard_id).await;
+        assert_eq!(*sharded.local(), 0);
+        assert_eq!(sharded.invoke_on(1, |id| async move { *id }).await, 1);
+        sharded.stop().await;
+    }
+
+    #[seastar::test]
+    async fn test_sharded_invoke_on_all() {
+        let counters = Sharded::start(|| Cell::new(0)).await;
+        counters
+            .invoke_on_all(|c| async move { c.set(c.get() + 1) })
+            .await;
+        counters
+            .invoke_on_all(|c| async move { c.set(c.get() + 1) })
+            .await;
+        assert_eq!(counters.local().get(), 2);
+        assert_eq!(counters.invoke_on(1, |c| async move { c.get() }).await, 2);
+        counters.stop().await;
+    }
+
+    #[seastar::test]
+    async fn test_sharded_local_outlives_stop() {
+        let sharded = Sharded::start(|| String::from("42")).await;
+        let local = sharded.local();
+        sharded.stop().await;
+        assert_eq!(*local, "42");
+    }
+
+    #[seastar::test]
+    async fn test_lazy_sharded_creates_on_first_use() {
+        let created = Arc::new(std::sync::atomic::AtomicU32::new(0));
+        let c = created.clone();
+        let sharded = LazySharded::new(move || {
+            c.fetch_add(1, std::sync::atomic::Ordering::Relaxed);
+            this_shard_id()
+        });
+        assert_eq!(created.load(std::sync::atomic::Ordering::Relaxed), 0);
+        assert!(sharded.try_local().is_none());
+
+        assert_eq!(*sharded.local(), 0);
+        assert_eq!(*sharded.local(), 0);
+        assert_eq!(created.load(std::sync::atomic::Ordering::Relaxed), 1);
+
+        assert_eq!(sharded.invoke_on(1, |id| async move { *id }).await, 1);
+        assert_eq!(created.load(std::sync::atomic::Ordering::Relaxed), 2);
+        sharded.stop().await;
+    }
+
+    #[seastar::test]
+    async fn test_lazy_sharded_local_outlives_stop() {
+        let sharded = LazySharded::new(|| String::from("42"));
+        let local = sharded.local();
+        sharded.stop().await;
+        assert_eq!(*local, "42");
+        assert!(sharded.try_local().is_none());
+    }
+}
@@ -0,0 +1,244 @@
+//! A shard-local promise whose value can be awaited by many tasks.
+//!
+//! Unlike a [`oneshot`](crate::oneshot) channel per waiter, all the waiters
+//! share one completion. Registering a waiter only stores its waker, and
+//! completing the promise wakes all of them with a single pass.
+
+use std::cell::{Cell, RefCell};
+use std::future::Future;
+use std::pin::Pin;
+use std::rc::Rc;
+use std::task::{Context, Poll, Waker};
+use thiserror::Error;
+
+/// Error returned by [`SharedFuture`] when its [`SharedPromise`] is dropped
+/// without a value.
+#[derive(Error, Debug, Clone, Copy, PartialEq, Eq)]
+#[error("BrokenPromise: shared promise dropped without a value")]
+pub struct BrokenPromise;
+
+struct Shared<T> {
+    value: RefCell<Option<T>>,
+    // One slot per waiting future. A pending future that is dropped empties
+    // its slot, which is reused by the next one.
+    wakers: RefCell<Vec<Option<Waker>>>,
+    free: RefCell<Vec<usize>>,
+    broken: Cell<bool>,
+}
+
+impl<T> Shared<T> {
+    fn complete(&self) {
+        let wakers = std::mem::take(&mut *self.wakers.borrow_mut());
+        self.free.borrow_mut().clear();
+        for waker in wakers.into_iter().flatten() {
+            waker.wake();
+        }
+    }
+}
+
+/// The producing side of a [`SharedFuture`] (`seastar::shared_promise`).
+///
+/// # Example
+///
+/// ```rust
+/// #[seastar::test]
+/// async fn shared_promise_example() {
+///     let promise = SharedPromise::new();
+///     let waiters: Vec<_> = (0..10)
+///         .map(|_| spawn(promise.get_shared_future()))
+///         .collect();
+///     promise.set_value(42);
+///     for waiter in waiters {
+///         assert_eq!(waiter.await, Ok(42));
+///     }
+/// }
+/// ```
+pub struct SharedPromise<T> {
+    shared: Rc<Shared<T>>,
+}
+
+impl<T: Clone> SharedPromise<T> {
+    /// Creates a promise without a value.
+    pub fn new() -> Self {
+        SharedPromise {
+            shared: Rc::new(Shared {
+                value: RefCell::new(None),
+                wakers: RefCell::new(Vec::new()),
+                free: RefCell::new(Vec::new()),
+                broken: Cell::new(false),
+            }),
+        }
+    }
+
+    /// Returns a future that resolves to a copy of the value of the promise.
+    ///
+    /// It can be called any number of times, before or after the value is set.
+    pub fn get_shared_future(&self) -> SharedFuture<T> {
+        SharedFuture {
+            shared: self.shared.clone(),
+            waker_index: None,
+        }
+    }
+
+    /// Sets the value of the promise and wakes all the tasks awaiting it.
+    ///
+    /// Panics if the value has already been set.
+    pub fn set_value(&self, value: T) {
+        let mut slot = self.shared.value.borrow_mut();
+        assert!(slot.is_none(), "SharedPromise value already set");
+        *slot = Some(value);
+        drop(slot);
+        self.shared.complete();
+    }
+
+    /// Returns whether the value has been set.
+    pub fn available(&self) -> bool {
+        self.shared.value.borrow().is_some()
+    }
+}
+
+impl<T: Clone> Default for SharedPromise<T> {
+    fn default() -> Self {
+        SharedPromise::new()
+    }
+}
+
+impl<T> Drop for SharedPromise<T> {
+    fn drop(&mut self) {
+        if self.shared.value.borrow().is_none() {
+            self.shared.broken.set(true);
+            self.shared.complete();
+        }
+    }
+}
+
+/// A future for the value of a [`SharedPromise`] (`seastar::shared_future`).
+///
+/// It can be cloned, and all the clones resolve to copies of the same value.
+pub struct SharedFuture<T> {
+    shared: Rc<Shared<T>>,
+    // Where this future's waker is in `Shared::wakers`, while it is waiting.
+    waker_index: Option<usize>,
+}
+
+impl<T> Clone for SharedFuture<T> {
+    fn clone(&self) -> Self {
+        SharedFuture {
+            shared: self.shared.clone(),
+            waker_index: None,
+        }
+    }
+}
+
+impl<T: Clone> SharedFuture<T> {
+    /// Returns whether the value has been set, i.e. awaiting the future
+    /// completes right away.
+    pub fn available(&self) -> bool {
+        self.shared.value.borrow().is_some()
+    }
+}
+
+impl<T: Clone> Future for SharedFuture<T> {
+    type Output = Result<T, BrokenPromise>;
+
+    fn poll(mut self: Pin<&mut Self>, cx: &mut Context<'_>) -> Poll<Self::Output> {
+        if let Some(value) = &*self.shared.value.borrow() {
+            return Poll::Ready(Ok(value.clone()));
+        }
+        if self.shared.broken.get() {
+            return Poll::Ready(Err(BrokenPromise));
+        }
+        let mut wakers = self.shared.wakers.borrow_mut();
+        match self.waker_index {
+            // The slots are only cleared when the promise completes, which
+            // resolves the future, so the slot is still this future's.
+            Some(i) => match &mut wakers[i] {
+                Some(waker) if waker.will_wake(cx.waker()) => (),
+                slot => *slot = Some(cx.waker().clone()),
+            },
+            None => {
+                let waker = Some(cx.waker().clone());
+                let i = match self.shared.free.borrow_mut().pop() {
+                    Some(i) => {
+                        wakers[i] = waker;
+                        i
+                    }
+                    None => {
+                        wakers.push(waker);
+                        wakers.len() - 1
+                    }
+                };
+                drop(wakers);
+                self.waker_index = Some(i);
+            }
+        }
+        Poll::Pending
+    }
+}
+
+impl<T> Drop for SharedFuture<T> {
+    fn drop(&mut self) {
+        let Some(i) = self.waker_index else {
+            return;
+        };
+        // The slot is gone if the promise completed.
+        if let Some(slot) = self.shared.wakers.borrow_mut().get_mut(i) {
+            *slot = None;
+            self.shared.free.borrow_mut().push(i);
+        }
+    }
+}
+
+#[cfg(test)]
+mod tests {
+    use super::*;
+    use crate as seastar;
+    use crate::{spawn, yield_now};
+
+    #[seastar::test(shared)]
+    async fn test_shared_future_fan_out() {
+        let promise = SharedPromise::new();
+        let future = promise.get_shared_future();
+        let waiters: Vec<_> = (0..10).map(|_| spawn(future.clone())).collect();
+        yield_now().await;
+        assert!(!future.available());
+        promise.set_value(String::from("42"));
+        assert!(promise.available());
+        for waiter in waiters {
+            assert_eq!(waiter.await.unwrap(), "42");
+        }
+        assert_eq!(promise.get_shared_future().await.unwrap(), "42");
+    }
+
+    #[seastar::test(shared)]
+    async fn test_shared_future_broken_promise() {
+        let promise = SharedPromise::<u32>::new();
+        let future = promise.get_shared_future();
+        let waiter = spawn(future.clone());
+        yield_now().await;
+        drop(promise);
+        assert_eq!(waiter.await, Err(BrokenPromise));
+        assert_eq!(future.await, Err(BrokenPromise));
+    }
+
+    #[seastar::test(shared)]
+    async fn test_dropped_shared_future_deregisters() {
+        let promise = SharedPromise::<u32>::new();
+        let waiting =
+            |promise: &SharedPromise<u32>| promise.shared.wakers.borrow().iter().flatten().count();
+        for _ in 0..3 {
+            let mut future = promise.get_shared_future();
+            assert!(futures::poll!(&mut future).is_pending());
+            assert_eq!(waiting(&promise), 1);
+            drop(future);
+            assert_eq!(waiting(&promise), 0);
+        }
+        // The slot is reused.
+        assert_eq!(promise.shared.wakers.borrow().len(), 1);
+
+        let waiter = spawn(promise.get_shared_future());
+        yield_now().await;
+        promise.set_value(7);
+        assert_eq!(waiter.await, Ok(7));
+    }
+}
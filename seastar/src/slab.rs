@@ -0,0 +1,128 @@
+//! Shard-local recycling of small heap blocks.
+//!
+//! Seastar shards never share threads, so a thread-local free list is a
+//! per-shard free list. Blocks allocated and freed on the same shard are
+//! reused without going back to the allocator, which keeps short-lived
+//! per-call state off the hot path.
+
+use std::alloc::{self, Layout};
+use std::cell::RefCell;
+use std::ptr::NonNull;
+
+const SIZE_CLASSES: [usize; 4] = [64, 128, 256, 512];
+const BLOCK_ALIGN: usize = 16;
+const MAX_CACHED_BLOCKS: usize = 256;
+
+struct FreeBlocks([Vec<NonNull<u8>>; SIZE_CLASSES.len()]);
+
+impl Drop for FreeBlocks {
+    fn drop(&mut self) {
+        for (class, blocks) in self.0.iter_mut().enumerate() {
+            for block in blocks.drain(..) {
+                unsafe { alloc::dealloc(block.as_ptr(), block_layout(class)) };
+            }
+        }
+    }
+}
+
+thread_local! {
+    static FREE_BLOCKS: RefCell<FreeBlocks> = RefCell::new(FreeBlocks(Default::default()));
+}
+
+fn size_class(layout: Layout) -> Option<usize> {
+    if layout.align() > BLOCK_ALIGN {
+        return None;
+    }
+    SIZE_CLASSES.iter().position(|&size| layout.size() <= size)
+}
+
+fn block_layout(class: usize) -> Layout {
+    Layout::from_size_align(SIZE_CLASSES[class], BLOCK_ALIGN).unwrap()
+}
+
+fn new_block(class: usize) -> NonNull<u8> {
+    let layout = block_layout(class);
+    NonNull::new(unsafe { alloc::alloc(layout) })
+        .unwrap_or_else(|| alloc::handle_alloc_error(layout))
+}
+
+/// Moves `value` to the heap, reusing a block cached on the current shard if possible.
+///
+/// The returned pointer must be released with [`free`].
+pub(crate) fn alloc<T>(value: T) -> NonNull<T> {
+    match size_class(Layout::new::<T>()) {
+        Some(class) => {
+            let block = FREE_BLOCKS
+                .try_with(|blocks| blocks.borrow_mut().0[class].pop())
+                .ok()
+                .flatten()
+                .unwrap_or_else(|| new_block(class));
+            let ptr = block.cast::<T>();
+            unsafe { ptr.as_ptr().write(value) };
+            ptr
+        }
+        None => NonNull::from(Box::leak(Box::new(value))),
+    }
+}
+
+/// Drops the value behind `ptr` and returns its block to the current shard's cache.
+///
+/// # Safety
+///
+/// `ptr` must come from [`alloc`] and must not be used afterwards.
+pub(crate) unsafe fn free<T>(ptr: NonNull<T>) {
+    match size_class(Layout::new::<T>()) {
+        Some(class) => {
+            ptr.as_ptr().drop_in_place();
+            let block = ptr.cast::<u8>();
+            let cached = FREE_BLOCKS
+                .try_with(|blocks| {
+                    let blocks = &mut blocks.borrow_mut().0[class];
+                    if blocks.len() < MAX_CACHED_BLOCKS {
+                        blocks.push(block);
+                        true
+                    } else {
+                        false
+                    }
+                })
+                .unwrap_or(false);
+            if !cached {
+                alloc::dealloc(block.as_ptr(), block_layout(class));
+            }
+        }
+        None => drop(Box::from_raw(ptr.as_ptr())),
+    }
+}
+
+#[cfg(test)]
+mod tests {
+    use super::*;
+    use std::rc::Rc;
+
+    #[test]
+    fn test_slab_reuses_freed_block() {
+        let first = alloc(42u64);
+        let addr = first.as_ptr() as usize;
+        unsafe { free(first) };
+        let second = alloc(17u64);
+        assert_eq!(second.as_ptr() as usize, addr);
+        assert_eq!(unsafe { *second.as_ptr() }, 17);
+        unsafe { free(second) };
+    }
+
+    #[test]
+    fn test_slab_drops_value_on_free() {
+        let rc = Rc::new(());
+        let ptr = alloc(rc.clone());
+        assert_eq!(Rc::strong_count(&rc), 2);
+        unsafe { free(ptr) };
+        assert_eq!(Rc::strong_count(&rc), 1);
+    }
+
+    #[test]
+    fn test_slab_large_values_fall_back_to_box() {
+        let ptr = alloc([7u8; 4096]);
+        assert!(unsafe { ptr.as_ref() }.iter().all(|&b| b == 7));
+        unsafe { free(ptr) };
+    }
+}
@@ -0,0 +1,11 @@
+#include "smp.hh"
+
+namespace seastar_ffi {
+namespace smp {
+
+uint32_t get_smp_count() {
+    return seastar::smp::count;
+}
+
+} // namespace smp
+} // namespace seastar_ffi
@@ -0,0 +1,11 @@
+#pragma once
+
+#include <seastar/core/smp.hh>
+
+namespace seastar_ffi {
+namespace smp {
+
+uint32_t get_smp_count();
+
+} // namespace smp
+} // namespace seastar_ffi
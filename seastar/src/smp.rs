@@ -0,0 +1,205 @@
+use crate::{spawn_detached, submit_to};
+use std::cell::{Cell, RefCell};
+use std::future::{poll_fn, Future};
+use std::rc::Rc;
+use std::task::{Poll, Waker};
+
+#[cxx::bridge]
+mod ffi {
+    #[namespace = "seastar"]
+    unsafe extern "C++" {
+        include!("seastar/core/smp.hh");
+
+        /// Returns the id of the shard the current thread belongs to.
+        fn this_shard_id() -> u32;
+    }
+
+    #[namespace = "seastar_ffi::smp"]
+    unsafe extern "C++" {
+        include!("seastar/src/smp.hh");
+
+        fn get_smp_count() -> u32;
+    }
+}
+
+pub use ffi::this_shard_id;
+
+/// Returns the number of shards in the runtime.
+pub fn smp_count() -> u32 {
+    crate::assert_runtime_is_running();
+    ffi::get_smp_count()
+}
+
+/// Results of a fan-out, folded on the calling shard as they arrive.
+struct FanIn<Acc, Reducer> {
+    acc: RefCell<Option<Acc>>,
+    reducer: RefCell<Reducer>,
+    pending: Cell<usize>,
+    waker: Cell<Option<Waker>>,
+}
+
+/// Runs `mapper` on each of `shards` and folds the results with `reducer`.
+///
+/// All calls are submitted at once. Every result is passed to `reducer` on
+/// the calling shard as soon as it arrives, so the whole operation takes as
+/// long as the slowest shard. The order in which results are reduced is
+/// unspecified.
+///
+/// # Example
+///
+/// ```rust
+/// #[seastar::test]
+/// async fn map_reduce_example() {
+///     let shards = smp_count();
+///     let sum = map_reduce(0..shards, || async { this_shard_id() }, 0, |acc, id| acc + id).await;
+///     assert_eq!(sum, shards * (shards - 1) / 2);
+/// }
+/// ```
+pub fn map_reduce<Shards, Mapper, Fut, Mapped, Acc, Reducer>(
+    shards: Shards,
+    mapper: Mapper,
+    initial: Acc,
+    reducer: Reducer,
+) -> impl Future<Output = Acc>
+where
+    Shards: IntoIterator<Item = u32>,
+    Mapper: FnOnce() -> Fut + Clone + Send + 'static,
+    Fut: Future<Output = Mapped> + 'static,
+    Mapped: Send + 'static,
+    Acc: 'static,
+    Reducer: FnMut(Acc, Mapped) -> Acc + 'static,
+{
+    crate::assert_runtime_is_running();
+
+    let fan_in = Rc::new(FanIn {
+        acc: RefCell::new(Some(initial)),
+        reducer: RefCell::new(reducer),
+        pending: Cell::new(0),
+        waker: Cell::new(None),
+    });
+
+    for shard in shards {
+        fan_in.pending.set(fan_in.pending.get() + 1);
+        let mapped = submit_to(shard, mapper.clone());
+        let fan_in = fan_in.clone();
+        spawn_detached(async move {
+            let mapped = mapped.await;
+            let acc = fan_in.acc.borrow_mut().take().unwrap();
+            let acc = (fan_in.reducer.borrow_mut())(acc, mapped);
+            *fan_in.acc.borrow_mut() = Some(acc);
+            fan_in.pending.set(fan_in.pending.get() - 1);
+            if fan_in.pending.get() == 0 {
+                if let Some(waker) = fan_in.waker.take() {
+                    waker.wake();
+                }
+            }
+        });
+    }
+
+    poll_fn(move |cx| {
+        if fan_in.pending.get() == 0 {
+            Poll::Ready(fan_in.acc.borrow_mut().take().unwrap())
+        } else {
+            fan_in.waker.set(Some(cx.waker().clone()));
+            Poll::Pending
+        }
+    })
+}
+
+/// Runs `func` on every shard, including the current one.
+///
+/// Resolves once all shards have finished.
+pub fn invoke_on_all<Func, Fut>(func: Func) -> impl Future<Output = ()>
+where
+    Func: FnOnce() -> Fut + Clone + Send + 'static,
+    Fut: Future<Output = ()> + 'static,
+{
+    map_reduce(0..smp_count(), func, (), |(), ()| ())
+}
+
+/// Runs `func` on every shard except the current one.
+///
+/// Resolves once all those shards have finished.
+pub fn invoke_on_others<Func, Fut>(func: Func) -> impl Future<Output = ()>
+where
+    Func: FnOnce() -> Fut + Clone + Send + 'static,
+    Fut: Future<Output = ()> + 'static,
+{
+    let current = this_shard_id();
+    let others = (0..smp_count()).filter(move |&shard| shard != current);
+    map_reduce(others, func, (), |(), ()| ())
+}
+
+#[cfg(test)]
+mod tests {
+    use super::*;
+    use crate as seastar;
+    use std::sync::atomic::{AtomicBool, Ordering};
+    use std::sync::Arc;
+
+    #[seastar::test]
+    async fn test_this_shard_id() {
+        assert_eq!(this_shard_id(), 0);
+        assert_eq!(submit_to(1, || async { this_shard_id() }).await, 1);
+    }
+
+    #[seastar::test]
+    async fn test_map_reduce() {
+        let shards = smp_count();
+        let sum = map_reduce(
+            0..shards,
+            || async { this_shard_id() },
+            0,
+            |acc, id| acc + id,
+        )
+        .await;
+        assert_eq!(sum, shards * (shards - 1) / 2);
+    }
+
+    #[seastar::test]
+    async fn test_map_reduce_no_shards() {
+        let ret = map_reduce(std::iter::empty(), || async { 1 }, 42, |acc, x| acc + x).await;
+        assert_eq!(ret, 42);
+    }
+
+    // One flag per shard, so that any number of shards fits.
+    fn visited_flags() -> Arc<Vec<AtomicBool>> {
+        Arc::new((0..smp_count()).map(|_| AtomicBool::new(false)).collect())
+    }
+
+    fn visited_shards(visited: &[AtomicBool]) -> Vec<u32> {
+        (0..)
+            .zip(visited)
+            .filter(|(_, flag)| flag.load(Ordering::Relaxed))
+            .map(|(shard, _)| shard)
+            .collect()
+    }
+
+    #[seastar::test]
+    async fn test_invoke_on_all() {
+        let visited = visited_flags();
+        let visited_clone = visited.clone();
+        invoke_on_all(move || async move {
+            visited_clone[this_shard_id() as usize].store(true, Ordering::Relaxed);
+        })
+        .await;
+        assert_eq!(
+            visited_shards(&visited),
+            (0..smp_count()).collect::<Vec<_>>()
+        );
+    }
+
+    #[seastar::test]
+    async fn test_invoke_on_others() {
+        let visited = visited_flags();
+        let visited_clone = visited.clone();
+        invoke_on_others(move || async move {
+            visited_clone[this_shard_id() as usize].store(true, Ordering::Relaxed);
+        })
+        .await;
+        assert_eq!(
+            visited_shards(&visited),
+            (1..smp_count()).collect::<Vec<_>>()
+        );
+    }
+}
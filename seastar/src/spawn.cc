@@ -1,24 +1,50 @@
-#include <seastar/core/task.hh>
-#include <seastar/core/future.hh>
-#include <seastar/core/make_task.hh>
-#include <seastar/core/coroutine.hh>
+#include <seastar/core/alien.hh>
+#include <seastar/core/reactor.hh>
+#include <seastar/core/smp.hh>
 
 #include "spawn.hh"
 
 namespace seastar_ffi {
 namespace spawn {
 
-VoidFuture cpp_spawn(VoidFuture future) {
-    seastar::promise<> p;
-    auto f = p.get_future();
-    auto t = seastar::make_task([&]() -> seastar::future<> {
-        auto local_p = std::move(p);
-        co_await std::move(future);
-        local_p.set_value(); 
-    });
-    seastar::schedule(t);
-    co_await std::move(f);
+static_assert(sizeof(rust_task) <= rust_task_size);
+static_assert(alignof(rust_task) <= rust_task_align);
+
+void rust_task::run_and_dispose() noexcept {
+    // Disposal is up to Rust: the block is freed with its last reference.
+    _poll(reinterpret_cast<uint8_t*>(this));
 }
 
+void construct_rust_task(uint8_t* storage, rust::Fn<void(uint8_t*)> poll) {
+    new (storage) rust_task(poll);
 }
+
+void construct_rust_task_in(uint8_t* storage, rust::Fn<void(uint8_t*)> poll, uint32_t group) {
+    new (storage) rust_task(seastar::internal::scheduling_group_from_index((unsigned)group), poll);
 }
+
+void destroy_rust_task(uint8_t* storage) {
+    std::destroy_at(reinterpret_cast<rust_task*>(storage));
+}
+
+void schedule_rust_task(uint8_t* storage) {
+    seastar::schedule(reinterpret_cast<rust_task*>(storage));
+}
+
+void schedule_rust_task_on(uint32_t shard, uint8_t* storage) {
+    auto t = reinterpret_cast<rust_task*>(storage);
+    if (seastar::engine_is_ready()) {
+        // Woken on another shard.
+        (void)seastar::smp::submit_to(shard, [t] {
+            seastar::schedule(t);
+        });
+    } else {
+        // Woken on a thread outside of the runtime.
+        seastar::alien::run_on(*seastar::alien::internal::default_instance, shard, [t] () noexcept {
+            seastar::schedule(t);
+        });
+    }
+}
+
+} // namespace spawn
+} // namespace seastar_ffi
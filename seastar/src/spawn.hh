@@ -1,13 +1,40 @@
 #pragma once
 
-#include "cxx-async/include/rust/cxx_async_seastar.h"
 #include "rust/cxx.h"
-#include "cxx_async_futures.hh"
+#include <seastar/core/task.hh>
 
 namespace seastar_ffi {
 namespace spawn {
 
-VoidFuture cpp_spawn(VoidFuture future);
+// Storage reserved for a rust_task at the start of every Rust task block.
+// Must be kept in sync with `CppTaskStorage` in spawn.rs.
+constexpr size_t rust_task_size = 64;
+constexpr size_t rust_task_align = 16;
+
+// A task that drives a Rust future.
+//
+// It lives inside a block allocated and freed by Rust, so spawning costs
+// a single allocation. Every run polls the future once; the Rust waker
+// reschedules this same object.
+class rust_task final : public seastar::task {
+    rust::Fn<void(uint8_t*)> _poll;
+public:
+    explicit rust_task(rust::Fn<void(uint8_t*)> poll) noexcept : _poll(poll) {}
+    rust_task(seastar::scheduling_group sg, rust::Fn<void(uint8_t*)> poll) noexcept
+        : seastar::task(sg), _poll(poll) {}
+    void run_and_dispose() noexcept override;
+    seastar::task* waiting_task() noexcept override { return nullptr; }
+};
+
+void construct_rust_task(uint8_t* storage, rust::Fn<void(uint8_t*)> poll);
+
+void construct_rust_task_in(uint8_t* storage, rust::Fn<void(uint8_t*)> poll, uint32_t group);
+
+void destroy_rust_task(uint8_t* storage);
+
+void schedule_rust_task(uint8_t* storage);
+
+void schedule_rust_task_on(uint32_t shard, uint8_t* storage);
 
 } // namespace spawn
 } // namespace seastar_ffi
@@ -1,22 +1,330 @@
 use crate as seastar;
-use crate::cxx_async_local_future::IntoCxxAsyncLocalFuture;
-use core::cell::Cell;
+use crate::{scheduling, slab, stall_detector, task_trace};
 use ffi::*;
+use std::cell::{Cell, UnsafeCell};
 use std::future::Future;
-use std::rc::Rc;
+use std::mem::{self, ManuallyDrop, MaybeUninit};
+use std::pin::Pin;
+use std::ptr::NonNull;
+use std::sync::atomic::{AtomicU8, AtomicUsize, Ordering};
+use std::task::{Context, Poll, RawWaker, RawWakerVTable, Waker};
+use std::time::Instant;
 
 #[cxx::bridge]
 mod ffi {
-    #[namespace = "seastar_ffi"]
-    unsafe extern "C++" {
-        type VoidFuture = crate::cxx_async_futures::VoidFuture;
-    }
-
     #[namespace = "seastar_ffi::spawn"]
     unsafe extern "C++" {
         include!("seastar/src/spawn.hh");
 
-        fn cpp_spawn(future: VoidFuture) -> VoidFuture;
+        unsafe fn construct_rust_task(storage: *mut u8, poll: unsafe fn(*mut u8));
+        unsafe fn construct_rust_task_in(storage: *mut u8, poll: unsafe fn(*mut u8), group: u32);
+        unsafe fn destroy_rust_task(storage: *mut u8);
+        unsafe fn schedule_rust_task(storage: *mut u8);
+        unsafe fn schedule_rust_task_on(shard: u32, storage: *mut u8);
+    }
+}
+
+/// Space for the C++ `rust_task` object (see spawn.hh), which is constructed
+/// in place at the start of every task block.
+#[repr(C, align(16))]
+struct CppTaskStorage([MaybeUninit<u8>; 64]);
+
+const SCHEDULED: u8 = 1;
+const COMPLETE: u8 = 2;
+
+/// The type-independent part of a task.
+///
+/// References are held by the scheduler (while the task is queued or running),
+/// by the join handle and by every waker. Wakers may travel to other threads,
+/// so the state and the reference count are atomic. Everything else is only
+/// touched on the task's home shard.
+#[repr(C)]
+struct Header {
+    cpp_task: CppTaskStorage,
+    state: AtomicU8,
+    refs: AtomicUsize,
+    home_thread: usize,
+    home_shard: u32,
+    // The scheduling group whose statistics the task is accounted in, if any.
+    stats_group: Option<u32>,
+    // The name the task is traced under, if any (see task_trace.rs).
+    name: Option<&'static str>,
+    dealloc: unsafe fn(NonNull<Header>),
+}
+
+enum Stage<F: Future> {
+    Running(F),
+    Finished(F::Output),
+    Taken,
+}
+
+#[repr(C)]
+pub(crate) struct Task<F: Future> {
+    header: Header,
+    stage: UnsafeCell<Stage<F>>,
+    has_handle: Cell<bool>,
+    join_waker: Cell<Option<Waker>>,
+}
+
+thread_local! {
+    static THREAD_MARKER: u8 = 0;
+}
+
+/// Identifies the current thread by the address of a thread-local.
+pub(crate) fn current_thread() -> usize {
+    THREAD_MARKER
+        .try_with(|marker| marker as *const u8 as usize)
+        .unwrap_or(0)
+}
+
+static WAKER_VTABLE: RawWakerVTable =
+    RawWakerVTable::new(clone_waker, wake_waker, wake_waker_by_ref, drop_waker);
+
+unsafe fn clone_waker(ptr: *const ()) -> RawWaker {
+    (*(ptr as *const Header))
+        .refs
+        .fetch_add(1, Ordering::Relaxed);
+    RawWaker::new(ptr, &WAKER_VTABLE)
+}
+
+unsafe fn wake_waker(ptr: *const ()) {
+    wake_waker_by_ref(ptr);
+    drop_waker(ptr);
+}
+
+unsafe fn wake_waker_by_ref(ptr: *const ()) {
+    schedule(NonNull::new_unchecked(ptr as *mut Header));
+}
+
+unsafe fn drop_waker(ptr: *const ()) {
+    release(NonNull::new_unchecked(ptr as *mut Header));
+}
+
+/// Queues the task unless it is already queued or has completed.
+///
+/// The caller must hold a reference to the task.
+unsafe fn schedule(task: NonNull<Header>) {
+    let header = task.as_ref();
+    let mut state = header.state.load(Ordering::Acquire);
+    loop {
+        if state & (SCHEDULED | COMPLETE) != 0 {
+            return;
+        }
+        match header.state.compare_exchange_weak(
+            state,
+            state | SCHEDULED,
+            Ordering::AcqRel,
+            Ordering::Acquire,
+        ) {
+            Ok(_) => break,
+            Err(current) => state = current,
+        }
+    }
+    header.refs.fetch_add(1, Ordering::Relaxed);
+    enqueue(task);
+}
+
+unsafe fn enqueue(task: NonNull<Header>) {
+    let header = task.as_ref();
+    if header.home_thread == current_thread() {
+        schedule_rust_task(task.as_ptr() as *mut u8);
+    } else {
+        schedule_rust_task_on(header.home_shard, task.as_ptr() as *mut u8);
+    }
+}
+
+unsafe fn release(task: NonNull<Header>) {
+    let header = task.as_ref();
+    if header.refs.fetch_sub(1, Ordering::AcqRel) != 1 {
+        return;
+    }
+    if header.home_thread == current_thread() {
+        (header.dealloc)(task);
+    } else {
+        // The future need not be `Send`, so it must be dropped at home.
+        // Turn the last reference into a scheduler reference and let
+        // the final run of the task free it there.
+        header.refs.store(1, Ordering::Relaxed);
+        header.state.fetch_or(SCHEDULED, Ordering::AcqRel);
+        enqueue(task);
+    }
+}
+
+/// Called by `rust_task::run_and_dispose()`. Polls the future once and
+/// drops the scheduler's reference.
+unsafe fn poll_task<F: Future>(raw_task: *mut u8) {
+    let task = &*(raw_task as *const Task<F>);
+    let state = task.header.state.fetch_and(!SCHEDULED, Ordering::AcqRel);
+    if state & COMPLETE == 0 {
+        // Borrows the scheduler's reference, so it must not be dropped.
+        let waker = ManuallyDrop::new(Waker::from_raw(RawWaker::new(
+            raw_task as *const (),
+            &WAKER_VTABLE,
+        )));
+        let mut cx = Context::from_waker(&waker);
+        let stage = &mut *task.stage.get();
+        let traced = task.header.name.filter(|_| task_trace::is_enabled());
+        let started = (task.header.stats_group.is_some() || traced.is_some()).then(Instant::now);
+        let poll = match stage {
+            Stage::Running(fut) => Pin::new_unchecked(fut).poll(&mut cx),
+            _ => unreachable!("incomplete task without a future"),
+        };
+        if let Some(started) = started {
+            let elapsed = started.elapsed();
+            if let Some(group) = task.header.stats_group {
+                scheduling::record_poll(group, elapsed);
+                if poll.is_ready() {
+                    scheduling::record_finish(group);
+                }
+            }
+            if let Some(name) = traced {
+                task_trace::record_poll(name, elapsed);
+            }
+        }
+        stall_detector::deliver_pending_report(task.header.name);
+        if let Poll::Ready(output) = poll {
+            *stage = if task.has_handle.get() {
+                Stage::Finished(output)
+            } else {
+                Stage::Taken
+            };
+            task.header.state.fetch_or(COMPLETE, Ordering::Release);
+            if let Some(waker) = task.join_waker.take() {
+                waker.wake();
+            }
+        }
+    }
+    release(NonNull::from(&task.header));
+}
+
+unsafe fn dealloc<F: Future>(task: NonNull<Header>) {
+    let header = task.as_ref();
+    if let Some(group) = header.stats_group {
+        if header.state.load(Ordering::Acquire) & COMPLETE == 0 {
+            scheduling::record_finish(group);
+        }
+    }
+    destroy_rust_task(task.as_ptr() as *mut u8);
+    slab::free(task.cast::<Task<F>>());
+}
+
+/// Allocates a task driving `future` and queues it for its first poll.
+///
+/// The task runs in the current scheduling group.
+fn new_task<F>(future: F, has_handle: bool) -> NonNull<Task<F>>
+where
+    F: Future + 'static,
+{
+    new_task_in(future, has_handle, None, None)
+}
+
+/// Allocates a task driving `future` and queues it for its first poll.
+///
+/// If `group` is given, the task runs in that scheduling group and is
+/// accounted in its statistics. Otherwise, it runs in the current group.
+/// If `name` is given, the task is traced under that name.
+pub(crate) fn new_task_in<F>(
+    future: F,
+    has_handle: bool,
+    group: Option<u32>,
+    name: Option<&'static str>,
+) -> NonNull<Task<F>>
+where
+    F: Future + 'static,
+{
+    seastar::assert_runtime_is_running();
+
+    let task = slab::alloc(Task {
+        header: Header {
+            cpp_task: CppTaskStorage([MaybeUninit::uninit(); 64]),
+            state: AtomicU8::new(SCHEDULED),
+            refs: AtomicUsize::new(1 + has_handle as usize),
+            home_thread: current_thread(),
+            home_shard: seastar::this_shard_id(),
+            stats_group: group,
+            name,
+            dealloc: dealloc::<F>,
+        },
+        stage: UnsafeCell::new(Stage::Running(future)),
+        has_handle: Cell::new(has_handle),
+        join_waker: Cell::new(None),
+    });
+    let raw_task = task.as_ptr() as *mut u8;
+    unsafe {
+        match group {
+            Some(group) => {
+                scheduling::record_spawn(group);
+                construct_rust_task_in(raw_task, poll_task::<F>, group);
+            }
+            None => construct_rust_task(raw_task, poll_task::<F>),
+        }
+        schedule_rust_task(raw_task);
+    }
+    task
+}
+
+/// The awaiting side of a task started with [`spawn`].
+pub(crate) struct JoinHandle<F: Future> {
+    task: NonNull<Task<F>>,
+}
+
+impl<F: Future> JoinHandle<F> {
+    /// `task` must have been created with a handle.
+    pub(crate) fn new(task: NonNull<Task<F>>) -> Self {
+        JoinHandle { task }
+    }
+
+    /// Checks whether the current thread is the one the task runs on.
+    pub(crate) fn is_home(&self) -> bool {
+        unsafe { self.task.as_ref() }.header.home_thread == current_thread()
+    }
+
+    /// Drops the future of the task, unless it has completed, so that it
+    /// is never polled again.
+    ///
+    /// Must be called on the home shard of the task, and not by the task itself.
+    pub(crate) fn cancel(&self) {
+        let task = unsafe { self.task.as_ref() };
+        let state = task.header.state.fetch_or(COMPLETE, Ordering::AcqRel);
+        if state & COMPLETE != 0 {
+            return;
+        }
+        // Wakers and queued runs see the task as complete from now on.
+        unsafe { *task.stage.get() = Stage::Taken };
+        if let Some(group) = task.header.stats_group {
+            scheduling::record_finish(group);
+        }
+    }
+}
+
+impl<F: Future> Future for JoinHandle<F> {
+    type Output = F::Output;
+
+    fn poll(self: Pin<&mut Self>, cx: &mut Context<'_>) -> Poll<Self::Output> {
+        let task = unsafe { self.task.as_ref() };
+        if task.header.state.load(Ordering::Acquire) & COMPLETE == 0 {
+            match task.join_waker.take() {
+                Some(waker) if waker.will_wake(cx.waker()) => task.join_waker.set(Some(waker)),
+                _ => task.join_waker.set(Some(cx.waker().clone())),
+            }
+            return Poll::Pending;
+        }
+        match mem::replace(unsafe { &mut *task.stage.get() }, Stage::Taken) {
+            Stage::Finished(output) => Poll::Ready(output),
+            _ => panic!("spawned task polled after completion"),
+        }
+    }
+}
+
+impl<F: Future> Drop for JoinHandle<F> {
+    fn drop(&mut self) {
+        let task = unsafe { self.task.as_ref() };
+        task.has_handle.set(false);
+        task.join_waker.take();
+        if task.header.state.load(Ordering::Acquire) & COMPLETE != 0 {
+            unsafe { *task.stage.get() = Stage::Taken };
+        }
+        unsafe { release(NonNull::from(&task.header)) };
     }
 }
 
@@ -26,40 +334,79 @@ mod ffi {
 /// when `spawn` is called.
 ///
 /// Spawning a task enables the task to execute concurrently to other tasks.
+/// The task is polled directly by the Seastar scheduler and costs a single
+/// allocation, which is recycled on the current shard.
 ///
 /// This function must be called from the context of a Seastar runtime.
 pub fn spawn<T, Ret: 'static>(future: T) -> impl Future<Output = Ret>
 where
     T: Future<Output = Ret> + 'static,
 {
-    seastar::assert_runtime_is_running();
+    JoinHandle::new(new_task(future, true))
+}
 
-    let x: Rc<Cell<Option<Ret>>> = Default::default();
+/// Spawns a new asynchronous task without a way to wait for its completion.
+///
+/// Same as [`spawn`], but nothing is allocated to hand the result back.
+///
+/// This function must be called from the context of a Seastar runtime.
+pub fn spawn_detached<T>(future: T)
+where
+    T: Future<Output = ()> + 'static,
+{
+    new_task(future, false);
+}
 
-    let x_clone = x.clone();
-    let fut = cpp_spawn(VoidFuture::infallible_local(async move {
-        x_clone.set(Some(future.await));
-    }));
+/// Spawns a new asynchronous task, traced under `name`.
+///
+/// Same as [`spawn`], but while task tracing is enabled on the shard
+/// (see [`set_task_tracing`](crate::set_task_tracing)), the polls of the task
+/// are accounted in [`task_stats`](crate::task_stats) under `name`.
+/// Stall reports (see [`set_stall_handler`](crate::set_stall_handler))
+/// also name the task.
+pub fn spawn_named<T, Ret: 'static>(name: &'static str, future: T) -> impl Future<Output = Ret>
+where
+    T: Future<Output = Ret> + 'static,
+{
+    JoinHandle::new(new_task_in(future, true, None, Some(name)))
+}
 
-    async move {
-        let result = fut.await;
-        match result {
-            Ok(_) => x.take().unwrap(),
-            Err(_) => panic!(),
-        }
-    }
+/// Spawns a new asynchronous task traced under `name`, without a way to wait for its completion.
+///
+/// Same as [`spawn_named`], but nothing is allocated to hand the result back.
+pub fn spawn_detached_named<T>(name: &'static str, future: T)
+where
+    T: Future<Output = ()> + 'static,
+{
+    new_task_in(future, false, None, Some(name));
+}
+
+/// Spawns a new asynchronous task that is cancelled when an abort is
+/// requested on `abort`.
+///
+/// Same as [`spawn`], but once the abort is requested the task drops its
+/// future without polling it again, releasing what it holds, and completes
+/// with [`AbortRequested`](crate::AbortRequested).
+pub fn spawn_abortable<T, Ret: 'static>(
+    abort: &seastar::AbortSource,
+    future: T,
+) -> impl Future<Output = Result<Ret, seastar::AbortRequested>>
+where
+    T: Future<Output = Ret> + 'static,
+{
+    spawn(abort.abortable(future))
 }
 
 #[cfg(test)]
 mod tests {
     use super::*;
 
-    #[seastar::test]
+    #[seastar::test(shared)]
     async fn test_empty_spawn_void() {
         assert!(matches!(spawn(async move {}).await, ()));
     }
 
-    #[seastar::test]
+    #[seastar::test(shared)]
     async fn test_chained_spawn_void() {
         let res = spawn(async move {
             let _ = spawn(async move {}).await;
@@ -68,13 +415,13 @@ mod tests {
         assert!(matches!(res, ()));
     }
 
-    #[seastar::test]
+    #[seastar::test(shared)]
     async fn test_spawn_int() {
         let res = spawn(async move { 0 }).await;
         assert!(matches!(res, 0));
     }
 
-    #[seastar::test]
+    #[seastar::test(shared)]
     async fn test_two_spawn_int_and_void() {
         let mut res = spawn(async move { 0 }).await;
         assert!(matches!(res, 0));
@@ -84,19 +431,70 @@ mod tests {
         assert!(matches!(spawn(async move {}).await, ()));
     }
 
-    #[seastar::test]
+    #[seastar::test(shared)]
     async fn test_chained_spawn_int() {
         let res = spawn(async move { spawn(async move { 2 }).await }).await;
         assert!(matches!(res, 2));
     }
 
-    #[seastar::test]
+    #[seastar::test(shared)]
     async fn test_spawn_without_await() {
-        let (tx, rx) = futures::channel::oneshot::channel::<i32>();
+        let (tx, rx) = crate::oneshot::channel::<i32>();
 
         let _ = spawn(async move {
             tx.send(2).ok();
         });
         assert!(matches!(rx.await.unwrap(), 2));
     }
+
+    #[seastar::test(shared)]
+    async fn test_spawn_detached() {
+        let (tx, rx) = crate::oneshot::channel::<i32>();
+
+        spawn_detached(async move {
+            tx.send(3).ok();
+        });
+        assert!(matches!(rx.await.unwrap(), 3));
+    }
+
+    #[seastar::test]
+    async fn test_spawn_woken_from_another_shard() {
+        let (tx, rx) = futures::channel::oneshot::channel::<i32>();
+
+        let handle = spawn(async move { rx.await.unwrap() });
+        seastar::submit_to(1, move || async move {
+            tx.send(4).ok();
+        })
+        .await;
+        assert!(matches!(handle.await, 4));
+    }
+
+    #[seastar::test(shared)]
+    async fn test_cancel_join_handle() {
+        let (tx, rx) = crate::oneshot::channel::<()>();
+        let handle = JoinHandle::new(new_task(
+            async move {
+                let _tx = tx;
+                futures::future::pending::<()>().await
+            },
+            true,
+        ));
+        assert!(handle.is_home());
+        seastar::yield_now().await;
+        handle.cancel();
+        // The future was dropped, with the sender it held.
+        assert!(rx.await.is_err());
+        drop(handle);
+    }
+
+    #[seastar::test(shared)]
+    async fn test_spawn_abortable() {
+        let abort = seastar::AbortSource::new();
+        let done = spawn_abortable(&abort, async { 5 });
+        assert_eq!(done.await, Ok(5));
+
+        let pending = spawn_abortable(&abort, futures::future::pending::<()>());
+        abort.request_abort();
+        assert_eq!(pending.await, Err(seastar::AbortRequested));
+    }
 }
@@ -0,0 +1,79 @@
+#include <cxxabi.h>
+#include <dlfcn.h>
+#include <fmt/format.h>
+#include <seastar/core/reactor.hh>
+#include <seastar/util/backtrace.hh>
+
+#include "stall_detector.hh"
+
+namespace seastar_ffi {
+namespace stall_detector {
+
+static_assert(std::atomic<bool>::is_always_lock_free);
+static_assert(std::atomic<uint32_t>::is_always_lock_free);
+static_assert(std::atomic<uint64_t>::is_always_lock_free);
+static_assert(std::atomic<size_t>::is_always_lock_free);
+static_assert(sizeof(std::atomic<size_t>) == sizeof(size_t));
+
+// The report function in place before `install_stall_handler`.
+static thread_local std::optional<std::function<void()>> previous_report;
+
+void install_stall_handler(uint8_t* state, uint8_t* pending_reports) {
+    auto s = reinterpret_cast<stall_state*>(state);
+    auto pending = reinterpret_cast<std::atomic<size_t>*>(pending_reports);
+    if (!previous_report) {
+        previous_report = seastar::engine().get_stall_detector_report_function();
+    }
+    seastar::engine().set_stall_detector_report_function([s, pending] {
+        // Runs in a signal handler: no allocations, no locks.
+        s->reported.fetch_add(1, std::memory_order_relaxed);
+        if (s->pending.load(std::memory_order_relaxed)) {
+            // The previous report has not been delivered yet.
+            return;
+        }
+        uint32_t n = 0;
+        seastar::backtrace([s, &n] (seastar::frame f) {
+            if (n < max_stall_frames) {
+                s->frames[n++] = f.so->begin + f.addr;
+            }
+        });
+        s->nr_frames.store(n, std::memory_order_relaxed);
+        s->pending.store(true, std::memory_order_release);
+        pending->fetch_add(1, std::memory_order_relaxed);
+    });
+}
+
+void uninstall_stall_handler() {
+    if (previous_report) {
+        seastar::engine().set_stall_detector_report_function(std::move(*previous_report));
+        previous_report.reset();
+    }
+}
+
+void set_blocked_reactor_notify_ms(uint64_t ms) {
+    seastar::engine().update_blocked_reactor_notify_ms(std::chrono::milliseconds(ms));
+}
+
+uint64_t get_blocked_reactor_notify_ms() {
+    return seastar::engine().get_blocked_reactor_notify_ms().count();
+}
+
+rust::String symbolize(size_t address) {
+    Dl_info info;
+    if (!dladdr(reinterpret_cast<void*>(address), &info)) {
+        return rust::String(fmt::format("{:#x}", address));
+    }
+    std::string object = info.dli_fname ? info.dli_fname : "?";
+    if (!info.dli_sname) {
+        return rust::String(fmt::format("{:#x} ({})", address, object));
+    }
+    int status = 0;
+    char* demangled = abi::__cxa_demangle(info.dli_sname, nullptr, nullptr, &status);
+    std::string name = status == 0 ? demangled : info.dli_sname;
+    free(demangled);
+    auto offset = address - reinterpret_cast<uintptr_t>(info.dli_saddr);
+    return rust::String(fmt::format("{}+{:#x} ({})", name, offset, object));
+}
+
+} // namespace stall_detector
+} // namespace seastar_ffi
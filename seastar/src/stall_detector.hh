@@ -0,0 +1,37 @@
+#pragma once
+
+#include "rust/cxx.h"
+#include <atomic>
+
+namespace seastar_ffi {
+namespace stall_detector {
+
+// Must be kept in sync with `MAX_STALL_FRAMES` in stall_detector.rs.
+constexpr size_t max_stall_frames = 64;
+
+// Filled in by the stall report function, which runs in a signal handler,
+// and read by Rust on the same shard once the stalling task has returned.
+// Must be kept in sync with `StallState` in stall_detector.rs.
+struct stall_state {
+    std::atomic<bool> pending;
+    std::atomic<uint32_t> nr_frames;
+    std::atomic<uint64_t> reported;
+    uintptr_t frames[max_stall_frames];
+};
+
+// Replaces the stall report function of the current shard, until
+// `uninstall_stall_handler` is called. `state` must outlive the installation.
+// `pending_reports`, a `std::atomic<size_t>` shared by all shards, is
+// incremented whenever `state` gets a report pending.
+void install_stall_handler(uint8_t* state, uint8_t* pending_reports);
+
+void uninstall_stall_handler();
+
+void set_blocked_reactor_notify_ms(uint64_t ms);
+
+uint64_t get_blocked_reactor_notify_ms();
+
+rust::String symbolize(size_t address);
+
+} // namespace stall_detector
+} // namespace seastar_ffi
@@ -0,0 +1,255 @@
+use std::cell::{Cell, RefCell, UnsafeCell};
+use std::fmt;
+use std::sync::atomic::{AtomicBool, AtomicU32, AtomicU64, AtomicUsize, Ordering};
+use std::time::Duration;
+
+#[cxx::bridge]
+mod ffi {
+    #[namespace = "seastar_ffi::stall_detector"]
+    unsafe extern "C++" {
+        include!("seastar/src/stall_detector.hh");
+
+        unsafe fn install_stall_handler(state: *mut u8, pending_reports: *mut u8);
+        fn uninstall_stall_handler();
+        fn set_blocked_reactor_notify_ms(ms: u64);
+        fn get_blocked_reactor_notify_ms() -> u64;
+        fn symbolize(address: usize) -> String;
+    }
+}
+
+/// Must be kept in sync with `max_stall_frames` in stall_detector.hh.
+const MAX_STALL_FRAMES: usize = 64;
+
+/// Must be kept in sync with `stall_state` in stall_detector.hh.
+///
+/// The signal handler writes to it asynchronously, hence the atomics,
+/// which have the same layout as the C++ ones.
+#[repr(C)]
+struct StallState {
+    pending: AtomicBool,
+    nr_frames: AtomicU32,
+    reported: AtomicU64,
+    // Only written while `pending` is false.
+    frames: UnsafeCell<[usize; MAX_STALL_FRAMES]>,
+}
+
+type StallHandler = Box<dyn Fn(&StallReport)>;
+
+/// The number of shards with an undelivered report, incremented by the
+/// signal handler. Checked after every task poll, before anything else, so
+/// that polls pay for a single load while no stall is pending.
+static PENDING_REPORTS: AtomicUsize = AtomicUsize::new(0);
+
+thread_local! {
+    // Allocated on the first installation and never freed, as the signal
+    // handler may still refer to it.
+    static STATE: Cell<Option<&'static StallState>> = Cell::new(None);
+    static HANDLER: RefCell<Option<StallHandler>> = RefCell::new(None);
+}
+
+/// A reactor stall: a task ran longer than the stall threshold
+/// (see [`set_stall_threshold`]) without yielding.
+pub struct StallReport {
+    frames: Vec<usize>,
+    task: Option<&'static str>,
+    reported: u64,
+}
+
+impl StallReport {
+    /// Returns the return addresses on the stack of the stalled shard,
+    /// captured while it was stalled, innermost first.
+    pub fn frames(&self) -> &[usize] {
+        &self.frames
+    }
+
+    /// Returns the name of the task that was running when the stall was
+    /// delivered, if it was spawned with a name (see [`spawn_named`](crate::spawn_named)).
+    ///
+    /// That is the task that stalled, unless the stall happened in C++ code
+    /// that ran between two polls of Rust tasks.
+    pub fn task(&self) -> Option<&'static str> {
+        self.task
+    }
+
+    /// Returns the number of stalls detected on the shard so far, including
+    /// the ones that were not reported because an earlier report was pending.
+    pub fn total_stalls(&self) -> u64 {
+        self.reported
+    }
+
+    /// Resolves the frames to symbol names, with `dladdr`.
+    ///
+    /// Unlike capturing the frames, this is slow, and allocates.
+    pub fn symbolize(&self) -> Vec<String> {
+        self.frames
+            .iter()
+            .map(|&frame| ffi::symbolize(frame))
+            .collect()
+    }
+}
+
+impl fmt::Display for StallReport {
+    fn fmt(&self, f: &mut fmt::Formatter<'_>) -> fmt::Result {
+        match self.task {
+            Some(task) => writeln!(f, "Reactor stalled in task {task}, backtrace:")?,
+            None => writeln!(f, "Reactor stalled, backtrace:")?,
+        }
+        for (i, frame) in self.symbolize().iter().enumerate() {
+            writeln!(f, "  {i:>2}: {frame}")?;
+        }
+        Ok(())
+    }
+}
+
+/// Sets the stall detection threshold of the current shard
+/// (Seastar's `--blocked-reactor-notify-ms`).
+pub fn set_stall_threshold(threshold: Duration) {
+    crate::assert_runtime_is_running();
+    ffi::set_blocked_reactor_notify_ms(threshold.as_millis() as u64);
+}
+
+/// Returns the stall detection threshold of the current shard.
+pub fn stall_threshold() -> Duration {
+    crate::assert_runtime_is_running();
+    Duration::from_millis(ffi::get_blocked_reactor_notify_ms())
+}
+
+/// Replaces Seastar's stall reports on the current shard by `handler`.
+///
+/// When the stall detector fires, the backtrace of the shard is captured
+/// right away, in the signal handler, without allocating. `handler` is called
+/// later on the shard, once the Rust task that was running returns from its
+/// poll, so it may allocate, log, etc. Only one stall is captured at a time:
+/// stalls detected before the pending one is handled are only counted.
+///
+/// Seastar rate-limits the reports (`--blocked-reactor-reports-per-minute`).
+///
+/// # Example
+///
+/// ```rust
+/// #[seastar::test]
+/// async fn stall_handler_example() {
+///     set_stall_threshold(Duration::from_millis(10));
+///     set_stall_handler(|report| eprintln!("{report}"));
+/// }
+/// ```
+pub fn set_stall_handler(handler: impl Fn(&StallReport) + 'static) {
+    crate::assert_runtime_is_running();
+    HANDLER.with(|h| *h.borrow_mut() = Some(Box::new(handler)));
+    let state = STATE.with(|state| match state.get() {
+        Some(existing) => existing,
+        None => {
+            let new = &*Box::leak(Box::new(StallState {
+                pending: AtomicBool::new(false),
+                nr_frames: AtomicU32::new(0),
+                reported: AtomicU64::new(0),
+                frames: UnsafeCell::new([0; MAX_STALL_FRAMES]),
+            }));
+            state.set(Some(new));
+            new
+        }
+    });
+    unsafe {
+        ffi::install_stall_handler(
+            state as *const StallState as *mut u8,
+            &PENDING_REPORTS as *const AtomicUsize as *mut u8,
+        )
+    };
+}
+
+/// Restores Seastar's own stall reports on the current shard.
+pub fn clear_stall_handler() {
+    crate::assert_runtime_is_running();
+    ffi::uninstall_stall_handler();
+    HANDLER.with(|h| h.borrow_mut().take());
+}
+
+/// Called by the scheduler after every poll of a Rust task.
+#[inline]
+pub(crate) fn deliver_pending_report(task: Option<&'static str>) {
+    if PENDING_REPORTS.load(Ordering::Relaxed) == 0 {
+        return;
+    }
+    let Ok(Some(state)) = STATE.try_with(Cell::get) else {
+        return;
+    };
+    if state.pending.load(Ordering::Acquire) {
+        deliver(state, task);
+    }
+}
+
+#[cold]
+fn deliver(state: &StallState, task: Option<&'static str>) {
+    let nr_frames = state.nr_frames.load(Ordering::Relaxed) as usize;
+    let report = StallReport {
+        frames: unsafe { (*state.frames.get())[..nr_frames].to_vec() },
+        task,
+        reported: state.reported.load(Ordering::Relaxed),
+    };
+    state.pending.store(false, Ordering::Release);
+    PENDING_REPORTS.fetch_sub(1, Ordering::Relaxed);
+    HANDLER.with(|handler| {
+        if let Some(handler) = &*handler.borrow() {
+            handler(&report);
+        }
+    });
+}
+
+#[cfg(test)]
+mod tests {
+    use super::*;
+    use crate as seastar;
+    use crate::{spawn_named, yield_now};
+    use std::rc::Rc;
+    use std::time::Instant;
+
+    /// Restores the stall threshold and Seastar's own reports when dropped,
+    /// so that the tests do not leak their settings to the shard.
+    struct RestoreStallDetector(Duration);
+
+    impl RestoreStallDetector {
+        fn new() -> Self {
+            RestoreStallDetector(stall_threshold())
+        }
+    }
+
+    impl Drop for RestoreStallDetector {
+        fn drop(&mut self) {
+            clear_stall_handler();
+            set_stall_threshold(self.0);
+        }
+    }
+
+    #[seastar::test]
+    async fn test_stall_threshold() {
+        let _restore = RestoreStallDetector::new();
+        set_stall_threshold(Duration::from_millis(42));
+        assert_eq!(stall_threshold(), Duration::from_millis(42));
+    }
+
+    #[seastar::test]
+    async fn test_stall_handler() {
+        let restore = RestoreStallDetector::new();
+        let reports = Rc::new(RefCell::new(Vec::new()));
+        let r = reports.clone();
+        set_stall_threshold(Duration::from_millis(10));
+        set_stall_handler(move |report| {
+            r.borrow_mut().push((report.task(), report.frames().len()));
+        });
+
+        spawn_named("hog", async {
+            let start = Instant::now();
+            while start.elapsed() < Duration::from_millis(200) {
+                std::hint::spin_loop();
+            }
+        })
+        .await;
+        yield_now().await;
+        drop(restore);
+
+        let reports = reports.borrow();
+        assert!(!reports.is_empty());
+        assert_eq!(reports[0].0, Some("hog"));
+        assert!(reports[0].1 > 0);
+    }
+}
@@ -1,13 +1,22 @@
 #include "submit_to.hh"
+#include "result_slot.hh"
 #include <seastar/core/smp.hh>
 
 namespace seastar_ffi {
 
 namespace submit_to {
 
-VoidFuture submit_to(const uint32_t shard_id, uint8_t* closure, rust::Fn<VoidFuture(uint8_t*)> caller) {
-    co_await ::seastar::smp::submit_to(shard_id, [&] () -> seastar::future<> {
-        co_await caller(closure);
+VoidFuture submit_to(
+        const uint32_t shard_id,
+        uint8_t* slot,
+        rust::Fn<VoidFuture(uint8_t*)> caller,
+        rust::Fn<void(uint8_t*)> releaser) {
+    // Released once the cross-shard message has returned, however the call completed.
+    slot_releaser release_on_return(slot, releaser);
+    // The slot pointer is all that crosses shards: the closure and its
+    // result live in the Rust-side slot, not in the message.
+    co_await ::seastar::smp::submit_to(shard_id, [slot, caller] () -> seastar::future<> {
+        co_await caller(slot);
     });
 }
 
@@ -8,9 +8,11 @@ namespace seastar_ffi {
 
 namespace submit_to {
 
-using fn_once_caller_t = VoidFuture (*)(const uint8_t*);
-
-VoidFuture submit_to(const uint32_t shard_id, uint8_t* closure, rust::Fn<VoidFuture(uint8_t*)> caller);
+VoidFuture submit_to(
+    const uint32_t shard_id,
+    uint8_t* slot,
+    rust::Fn<VoidFuture(uint8_t*)> caller,
+    rust::Fn<void(uint8_t*)> releaser);
 
 } // submit_to
 
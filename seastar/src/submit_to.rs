@@ -1,8 +1,14 @@
-use crate::ffi_utils::{get_dropper, get_fn_once_caller};
+use crate::cxx_async_local_future::IntoCxxAsyncLocalFuture;
+use crate::result_slot::{release_raw, SlotFuture, SlotRef};
+use crate::{AbortRequested, AbortSource, Abortable};
 use ffi::*;
+use futures::task::AtomicWaker;
+use pin_project::pin_project;
 use std::future::Future;
-
-use crate::cxx_async_local_future::IntoCxxAsyncLocalFuture;
+use std::pin::Pin;
+use std::sync::atomic::{AtomicBool, Ordering};
+use std::sync::Arc;
+use std::task::{Context, Poll};
 
 #[cxx::bridge]
 mod ffi {
@@ -17,12 +23,33 @@ mod ffi {
 
         unsafe fn submit_to(
             shard_id: u32,
-            closure: *mut u8,
+            slot: *mut u8,
             caller: unsafe fn(*mut u8) -> VoidFuture,
+            releaser: unsafe fn(*mut u8),
         ) -> VoidFuture;
     }
 }
 
+/// Runs on the target shard: takes the closure out of the slot, calls it
+/// and stores the result back in place.
+///
+/// Only the slot's contents are touched here. Its references belong to the
+/// submitting shard: one is held by the returned future, the other one by
+/// the C++ side, which releases it once the cross-shard message has returned.
+unsafe fn run_on_target<Func, Fut, Ret>(raw_slot: *mut u8) -> VoidFuture
+where
+    Func: FnOnce() -> Fut,
+    Fut: Future<Output = Ret> + 'static,
+    Ret: 'static,
+{
+    let slot = SlotRef::<Func, Ret>::borrow_raw(raw_slot);
+    let fut = slot.take_input()();
+    VoidFuture::infallible_local(async move {
+        let ret = fut.await;
+        unsafe { slot.set_result(ret) };
+    })
+}
+
 /// Runs a function `func` on a `shard_id` shard.
 ///
 /// # Example
@@ -42,36 +69,124 @@ where
 {
     crate::assert_runtime_is_running();
 
-    let (tx, rx) = futures::channel::oneshot::channel::<Ret>();
+    let (slot, remote_slot) = SlotRef::new(func);
 
-    let closure = move || {
-        VoidFuture::infallible_local(async {
-            tx.send(func().await).ok();
-        })
+    let completion = unsafe {
+        ffi::submit_to(
+            shard_id,
+            remote_slot.into_raw(),
+            run_on_target::<Func, Fut, Ret>,
+            release_raw::<Func, Ret>,
+        )
     };
+    SlotFuture::new(completion, slot)
+}
 
-    let closure_caller = get_fn_once_caller(&closure);
-    let dropper = get_dropper(&closure);
-    let boxed_closure = Box::into_raw(Box::new(closure)) as *mut u8;
-
-    unsafe {
-        let fut = ffi::submit_to(shard_id, boxed_closure, closure_caller);
-        async move {
-            match fut.await {
-                Ok(_) => rx.await.unwrap(),
-                Err(_) => {
-                    dropper(boxed_closure);
-                    panic!()
-                }
-            }
+/// How the submitting shard tells the target shard of a
+/// [`submit_to_abortable`] to abort.
+#[derive(Default)]
+struct RemoteAbort {
+    requested: AtomicBool,
+    waker: AtomicWaker,
+}
+
+impl RemoteAbort {
+    fn request(&self) {
+        self.requested.store(true, Ordering::Release);
+        self.waker.wake();
+    }
+}
+
+/// Aborts the target side when the submitting future is dropped, whether
+/// it completed, was aborted, or was abandoned.
+struct AbortOnDrop(Arc<RemoteAbort>);
+
+impl Drop for AbortOnDrop {
+    fn drop(&mut self) {
+        self.0.request();
+    }
+}
+
+/// Runs on the target shard: forwards the abort to the target's own
+/// [`AbortSource`], which drops the future.
+#[pin_project]
+struct RemoteAbortable<Fut> {
+    remote: Arc<RemoteAbort>,
+    abort: AbortSource,
+    #[pin]
+    future: Abortable<Fut>,
+}
+
+impl<Fut: Future> Future for RemoteAbortable<Fut> {
+    type Output = Result<Fut::Output, AbortRequested>;
+
+    fn poll(self: Pin<&mut Self>, cx: &mut Context<'_>) -> Poll<Self::Output> {
+        let this = self.project();
+        this.remote.waker.register(cx.waker());
+        if this.remote.requested.load(Ordering::Acquire) {
+            this.abort.request_abort();
         }
+        let ret = this.future.poll(cx);
+        if ret.is_ready() {
+            // Later requests need not wake this task.
+            this.remote.waker.take();
+        }
+        ret
     }
 }
 
+/// Runs a function `func` on a `shard_id` shard, cancelling it when an
+/// abort is requested on `abort` or when the returned future is dropped.
+///
+/// `func` gets an [`AbortSource`] of the target shard, on which the abort
+/// is requested then, e.g. to pass it to [`sleep_abortable`](crate::sleep_abortable)
+/// or to subscribe to it. Its future is dropped on the target shard as
+/// soon as it gets there, so abandoned work stops using CPU and memory
+/// there, instead of running to completion like with [`submit_to`].
+///
+/// # Example
+///
+/// ```rust
+/// #[seastar::test]
+/// async fn submit_to_abortable_example() {
+///     let expiry = AbortOnExpiry::new(Duration::from_millis(10));
+///     let ret = submit_to_abortable(1, expiry.abort_source(), |abort| async move {
+///         sleep_abortable(Duration::from_secs(3600), &abort).await
+///     })
+///     .await;
+///     assert_eq!(ret, Err(AbortRequested));
+/// }
+/// ```
+pub async fn submit_to_abortable<Func, Fut, Ret>(
+    shard_id: u32,
+    abort: &AbortSource,
+    func: Func,
+) -> Result<Ret, AbortRequested>
+where
+    Func: FnOnce(AbortSource) -> Fut + Send + 'static,
+    Fut: Future<Output = Ret> + 'static,
+    Ret: Send + 'static,
+{
+    abort.check()?;
+    let remote = Arc::new(RemoteAbort::default());
+    let _on_drop = AbortOnDrop(remote.clone());
+    let call = submit_to(shard_id, move || {
+        let abort = AbortSource::new();
+        let future = abort.abortable(func(abort.clone()));
+        RemoteAbortable {
+            remote,
+            abort,
+            future,
+        }
+    });
+    abort.abortable(call).await?
+}
+
 #[cfg(test)]
 mod tests {
     use super::*;
     use crate as seastar;
+    use std::time::Duration;
 
     #[seastar::test]
     async fn test_submit_to() {
@@ -107,4 +222,75 @@ mod tests {
         });
         assert!(matches!(rx.await.unwrap(), 42));
     }
+
+    #[seastar::test]
+    async fn test_submit_to_non_trivial_result() {
+        let ret = submit_to(1, || async { String::from("42") }).await;
+        assert_eq!(ret, "42");
+    }
+
+    #[seastar::test]
+    async fn test_submit_to_large_closure() {
+        let payload = [42u8; 4096];
+        let ret = submit_to(1, move || async move {
+            payload.iter().map(|&b| b as u32).sum::<u32>()
+        })
+        .await;
+        assert_eq!(ret, 42 * 4096);
+    }
+
+    struct SetOnDrop(Arc<AtomicBool>);
+
+    impl Drop for SetOnDrop {
+        fn drop(&mut self) {
+            self.0.store(true, Ordering::Release);
+        }
+    }
+
+    async fn wait_for(flag: &AtomicBool) {
+        let wait = async {
+            while !flag.load(Ordering::Acquire) {
+                crate::sleep(Duration::from_millis(1)).await;
+            }
+        };
+        crate::timeout(wait, Duration::from_secs(10)).await.unwrap();
+    }
+
+    #[seastar::test]
+    async fn test_submit_to_abortable() {
+        let abort = AbortSource::new();
+        let ret = submit_to_abortable(1, &abort, |_| async { 42 }).await;
+        assert_eq!(ret, Ok(42));
+
+        let dropped = Arc::new(AtomicBool::new(false));
+        let guard = SetOnDrop(dropped.clone());
+        let call = submit_to_abortable(1, &abort, move |_| async move {
+            let _guard = guard;
+            futures::future::pending::<()>().await
+        });
+        let request = async {
+            crate::sleep(Duration::from_millis(1)).await;
+            abort.request_abort();
+        };
+        let (ret, ()) = futures::join!(call, request);
+        assert_eq!(ret, Err(AbortRequested));
+        wait_for(&dropped).await;
+
+        let ret = submit_to_abortable(1, &abort, |_| async { 42 }).await;
+        assert_eq!(ret, Err(AbortRequested));
+    }
+
+    #[seastar::test]
+    async fn test_submit_to_abortable_dropped() {
+        let dropped = Arc::new(AtomicBool::new(false));
+        let guard = SetOnDrop(dropped.clone());
+        let abort = AbortSource::new();
+        let mut call = Box::pin(submit_to_abortable(1, &abort, move |abort| async move {
+            let _guard = guard;
+            crate::sleep_abortable(Duration::from_secs(3600), &abort).await
+        }));
+        assert!(futures::poll!(call.as_mut()).is_pending());
+        drop(call);
+        wait_for(&dropped).await;
+    }
 }
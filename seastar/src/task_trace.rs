@@ -0,0 +1,119 @@
+//! Per-task poll statistics of named tasks (see [`spawn_named`](crate::spawn_named)).
+
+use std::cell::{Cell, RefCell};
+use std::collections::HashMap;
+use std::time::Duration;
+
+/// Poll statistics of the tasks spawned under a name, on a single shard.
+#[derive(Clone, Copy, Debug, Default, PartialEq, Eq)]
+pub struct TaskStats {
+    /// Number of polls.
+    pub polls: u64,
+    /// Total time spent polling.
+    pub total_poll_time: Duration,
+    /// The longest single poll.
+    pub max_poll_time: Duration,
+}
+
+thread_local! {
+    static ENABLED: Cell<bool> = Cell::new(false);
+    static TASK_STATS: RefCell<HashMap<&'static str, TaskStats>> = RefCell::new(HashMap::new());
+}
+
+pub(crate) fn is_enabled() -> bool {
+    ENABLED.try_with(Cell::get).unwrap_or(false)
+}
+
+pub(crate) fn record_poll(name: &'static str, elapsed: Duration) {
+    let _ = TASK_STATS.try_with(|stats| {
+        let mut stats = stats.borrow_mut();
+        let stats = stats.entry(name).or_default();
+        stats.polls += 1;
+        stats.total_poll_time += elapsed;
+        stats.max_poll_time = stats.max_poll_time.max(elapsed);
+    });
+}
+
+/// Enables or disables task tracing on the current shard. It is disabled by default.
+///
+/// While it is enabled, every poll of a task started with
+/// [`spawn_named`](crate::spawn_named) or
+/// [`spawn_detached_named`](crate::spawn_detached_named) is timed and
+/// accounted under the task's name. While it is disabled, or for unnamed
+/// tasks, polling costs nothing more than a branch.
+///
+/// # Example
+///
+/// ```rust
+/// #[seastar::test]
+/// async fn task_tracing_example() {
+///     set_task_tracing(true);
+///     spawn_named("compaction", async { /* ... */ }).await;
+///     for (name, stats) in task_stats() {
+///         println!("{name}: {} polls, longest {:?}", stats.polls, stats.max_poll_time);
+///     }
+/// }
+/// ```
+pub fn set_task_tracing(enabled: bool) {
+    ENABLED.with(|e| e.set(enabled));
+}
+
+/// Returns the statistics of the named tasks on the current shard,
+/// the ones with the longest total poll time first.
+pub fn task_stats() -> Vec<(&'static str, TaskStats)> {
+    let mut ret: Vec<_> = TASK_STATS.with(|stats| {
+        stats
+            .borrow()
+            .iter()
+            .map(|(&name, &stats)| (name, stats))
+            .collect()
+    });
+    ret.sort_by(|a, b| b.1.total_poll_time.cmp(&a.1.total_poll_time));
+    ret
+}
+
+/// Clears the statistics of the named tasks on the current shard.
+pub fn reset_task_stats() {
+    TASK_STATS.with(|stats| stats.borrow_mut().clear());
+}
+
+#[cfg(test)]
+mod tests {
+    use super::*;
+    use crate as seastar;
+    use crate::{spawn_named, yield_now};
+
+    /// Restores the tracing setting and clears the statistics when dropped,
+    /// so that the test does not leak them to the shard.
+    struct RestoreTracing(bool);
+
+    impl Drop for RestoreTracing {
+        fn drop(&mut self) {
+            set_task_tracing(self.0);
+            reset_task_stats();
+        }
+    }
+
+    #[seastar::test]
+    async fn test_task_tracing() {
+        let _restore = RestoreTracing(is_enabled());
+        set_task_tracing(false);
+        spawn_named("disabled", async {}).await;
+        assert!(task_stats().is_empty());
+
+        set_task_tracing(true);
+        spawn_named("traced", async {
+            yield_now().await;
+        })
+        .await;
+        crate::spawn(async {}).await;
+        let stats = task_stats();
+        assert_eq!(stats.len(), 1);
+        assert_eq!(stats[0].0, "traced");
+        assert_eq!(stats[0].1.polls, 2);
+        assert!(stats[0].1.max_poll_time <= stats[0].1.total_poll_time);
+
+        reset_task_stats();
+        assert!(task_stats().is_empty());
+    }
+}
@@ -0,0 +1,51 @@
+#include "temporary_buffer.hh"
+#include <cstring>
+
+namespace seastar_ffi {
+namespace temporary_buffer {
+
+// The contents are zeroed: Rust reads them through `&[u8]`, which must
+// never see uninitialized memory.
+static std::unique_ptr<buffer> zeroed(buffer buf) {
+    std::memset(buf.get_write(), 0, buf.size());
+    return std::make_unique<buffer>(std::move(buf));
+}
+
+std::unique_ptr<buffer> new_buffer(size_t size) {
+    return zeroed(buffer(size));
+}
+
+std::unique_ptr<buffer> new_aligned_buffer(size_t alignment, size_t size) {
+    return zeroed(buffer::aligned(alignment, size));
+}
+
+std::unique_ptr<buffer> copy_of(rust::Slice<const uint8_t> data) {
+    return std::make_unique<buffer>(reinterpret_cast<const char*>(data.data()), data.size());
+}
+
+rust::Slice<const uint8_t> get_data(const buffer& buf) {
+    return {reinterpret_cast<const uint8_t*>(buf.get()), buf.size()};
+}
+
+rust::Slice<uint8_t> get_data_mut(buffer& buf) {
+    return {reinterpret_cast<uint8_t*>(buf.get_write()), buf.size()};
+}
+
+std::unique_ptr<buffer> share(const buffer& buf) {
+    return std::make_unique<buffer>(const_cast<buffer&>(buf).share());
+}
+
+std::unique_ptr<buffer> share_range(const buffer& buf, size_t pos, size_t len) {
+    return std::make_unique<buffer>(const_cast<buffer&>(buf).share(pos, len));
+}
+
+void trim(buffer& buf, size_t pos) {
+    buf.trim(pos);
+}
+
+void trim_front(buffer& buf, size_t pos) {
+    buf.trim_front(pos);
+}
+
+} // namespace temporary_buffer
+} // namespace seastar_ffi
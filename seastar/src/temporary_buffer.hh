@@ -0,0 +1,31 @@
+#pragma once
+
+#include "rust/cxx.h"
+#include <seastar/core/temporary_buffer.hh>
+
+namespace seastar_ffi {
+namespace temporary_buffer {
+
+using buffer = seastar::temporary_buffer<char>;
+
+std::unique_ptr<buffer> new_buffer(size_t size);
+
+std::unique_ptr<buffer> new_aligned_buffer(size_t alignment, size_t size);
+
+std::unique_ptr<buffer> copy_of(rust::Slice<const uint8_t> data);
+
+rust::Slice<const uint8_t> get_data(const buffer& buf);
+
+rust::Slice<uint8_t> get_data_mut(buffer& buf);
+
+// Sharing only touches the buffer's deleter, never its contents.
+std::unique_ptr<buffer> share(const buffer& buf);
+
+std::unique_ptr<buffer> share_range(const buffer& buf, size_t pos, size_t len);
+
+void trim(buffer& buf, size_t pos);
+
+void trim_front(buffer& buf, size_t pos);
+
+} // namespace temporary_buffer
+} // namespace seastar_ffi
@@ -0,0 +1,244 @@
+use cxx::UniquePtr;
+use std::cell::Cell;
+use std::ops::{Deref, DerefMut};
+use std::rc::Rc;
+
+#[cxx::bridge(namespace = "seastar_ffi::temporary_buffer")]
+mod ffi {
+    unsafe extern "C++" {
+        include!("seastar/src/temporary_buffer.hh");
+
+        type buffer;
+
+        fn new_buffer(size: usize) -> UniquePtr<buffer>;
+        fn new_aligned_buffer(alignment: usize, size: usize) -> UniquePtr<buffer>;
+        fn copy_of(data: &[u8]) -> UniquePtr<buffer>;
+        fn get_data(buf: &buffer) -> &[u8];
+        fn get_data_mut(buf: Pin<&mut buffer>) -> &mut [u8];
+        fn share(buf: &buffer) -> UniquePtr<buffer>;
+        fn share_range(buf: &buffer, pos: usize, len: usize) -> UniquePtr<buffer>;
+        fn trim(buf: Pin<&mut buffer>, pos: usize);
+        fn trim_front(buf: Pin<&mut buffer>, pos: usize);
+    }
+}
+
+pub(crate) use ffi::buffer;
+
+/// Token held by every Rust view of a shared allocation, so that
+/// a view can tell whether it is the only one.
+pub(crate) type ShareToken = Rc<()>;
+
+/// A buffer of bytes owned by Seastar (`seastar::temporary_buffer<char>`).
+///
+/// It derefs to `[u8]`, so its contents can be read and written
+/// in place, without copying them across the FFI.
+///
+/// [`share`](TemporaryBuffer::share) and [`share_range`](TemporaryBuffer::share_range)
+/// create more views of the same memory, which is freed when the last one
+/// is dropped. While a buffer is shared, its contents can only be read:
+/// [`get_mut`](TemporaryBuffer::get_mut) returns `None` and `deref_mut` panics.
+/// Buffers received from Seastar, e.g. from an [`InputStream`](crate::InputStream),
+/// may share their memory with views held by C++, so they are always
+/// read-only.
+///
+/// A `TemporaryBuffer` must stay on the shard that created it.
+pub struct TemporaryBuffer {
+    inner: UniquePtr<buffer>,
+    // Created on first share, so that unshared buffers don't allocate it.
+    token: Cell<Option<ShareToken>>,
+    // Whether C++ may hold views of the memory, which the token cannot count.
+    shared_with_cpp: bool,
+}
+
+impl TemporaryBuffer {
+    /// Creates a buffer of `size` zeroed bytes.
+    pub fn new(size: usize) -> Self {
+        Self::from_cpp(ffi::new_buffer(size), None)
+    }
+
+    /// Creates a buffer of `size` bytes whose start is aligned to `alignment`,
+    /// which must be a power of two. The contents are zeroed.
+    pub fn aligned(alignment: usize, size: usize) -> Self {
+        assert!(
+            alignment.is_power_of_two(),
+            "Alignment must be a power of two"
+        );
+        Self::from_cpp(ffi::new_aligned_buffer(alignment, size), None)
+    }
+
+    /// Creates a buffer holding a copy of `data`.
+    pub fn copy_of(data: &[u8]) -> Self {
+        Self::from_cpp(ffi::copy_of(data), None)
+    }
+
+    pub(crate) fn from_cpp(inner: UniquePtr<buffer>, token: Option<ShareToken>) -> Self {
+        TemporaryBuffer {
+            inner,
+            token: Cell::new(token),
+            shared_with_cpp: false,
+        }
+    }
+
+    /// Wraps a buffer handed over by C++ code that may keep views of it.
+    pub(crate) fn from_cpp_shared(inner: UniquePtr<buffer>) -> Self {
+        TemporaryBuffer {
+            shared_with_cpp: true,
+            ..Self::from_cpp(inner, None)
+        }
+    }
+
+    pub(crate) fn into_cpp(self) -> (UniquePtr<buffer>, Option<ShareToken>) {
+        (self.inner, self.token.into_inner())
+    }
+
+    pub(crate) fn as_cpp(&self) -> &UniquePtr<buffer> {
+        &self.inner
+    }
+
+    fn share_token(&self) -> ShareToken {
+        let token = self.token.take().unwrap_or_default();
+        self.token.set(Some(token.clone()));
+        token
+    }
+
+    /// Checks whether other views of the same memory exist.
+    pub fn is_shared(&self) -> bool {
+        if self.shared_with_cpp {
+            return true;
+        }
+        let token = self.token.take();
+        let shared = token.as_ref().is_some_and(|t| Rc::strong_count(t) > 1);
+        self.token.set(token);
+        shared
+    }
+
+    /// Returns the contents for writing, unless the buffer is shared.
+    pub fn get_mut(&mut self) -> Option<&mut [u8]> {
+        match self.is_shared() {
+            true => None,
+            false => Some(ffi::get_data_mut(self.inner.pin_mut())),
+        }
+    }
+
+    /// Creates another view of the whole buffer, without copying.
+    pub fn share(&self) -> TemporaryBuffer {
+        self.view(ffi::share(&self.inner))
+    }
+
+    fn view(&self, inner: UniquePtr<buffer>) -> TemporaryBuffer {
+        TemporaryBuffer {
+            shared_with_cpp: self.shared_with_cpp,
+            ..Self::from_cpp(inner, Some(self.share_token()))
+        }
+    }
+
+    /// Creates a view of `len` bytes starting at `pos`, without copying.
+    ///
+    /// Panics if the range is out of bounds.
+    pub fn share_range(&self, pos: usize, len: usize) -> TemporaryBuffer {
+        assert!(
+            pos.checked_add(len).is_some_and(|end| end <= self.len()),
+            "Shared range out of bounds"
+        );
+        self.view(ffi::share_range(&self.inner, pos, len))
+    }
+
+    /// Shortens the view to its first `len` bytes.
+    ///
+    /// Panics if `len` is larger than the buffer.
+    pub fn trim(&mut self, len: usize) {
+        assert!(len <= self.len(), "Trimming beyond the end of the buffer");
+        ffi::trim(self.inner.pin_mut(), len);
+    }
+
+    /// Drops the first `pos` bytes from the view.
+    ///
+    /// Panics if `pos` is larger than the buffer.
+    pub fn trim_front(&mut self, pos: usize) {
+        assert!(pos <= self.len(), "Trimming beyond the end of the buffer");
+        ffi::trim_front(self.inner.pin_mut(), pos);
+    }
+
+    /// Returns the view shortened to its first `len` bytes.
+    ///
+    /// Panics if `len` is larger than the buffer.
+    pub fn prefix(mut self, len: usize) -> TemporaryBuffer {
+        self.trim(len);
+        self
+    }
+}
+
+/// Creates a buffer suitable for DMA, i.e. aligned to `alignment`
+/// (see [`File::memory_dma_alignment`](crate::File::memory_dma_alignment)).
+pub fn allocate_aligned_buffer(size: usize, alignment: usize) -> TemporaryBuffer {
+    TemporaryBuffer::aligned(alignment, size)
+}
+
+impl Deref for TemporaryBuffer {
+    type Target = [u8];
+
+    fn deref(&self) -> &[u8] {
+        ffi::get_data(&self.inner)
+    }
+}
+
+impl DerefMut for TemporaryBuffer {
+    fn deref_mut(&mut self) -> &mut [u8] {
+        self.get_mut()
+            .expect("Cannot write to a shared TemporaryBuffer")
+    }
+}
+
+impl std::fmt::Debug for TemporaryBuffer {
+    fn fmt(&self, f: &mut std::fmt::Formatter<'_>) -> std::fmt::Result {
+        f.debug_struct("TemporaryBuffer")
+            .field("len", &self.len())
+            .finish()
+    }
+}
+
+#[cfg(test)]
+mod tests {
+    use super::*;
+    use crate as seastar;
+
+    #[seastar::test(shared)]
+    async fn test_temporary_buffer_read_write() {
+        let mut buf = TemporaryBuffer::new(4);
+        assert_eq!(&*buf, &[0; 4]);
+        buf.copy_from_slice(b"abcd");
+        assert_eq!(&*buf, b"abcd");
+        assert!(TemporaryBuffer::new(0).is_empty());
+    }
+
+    #[seastar::test(shared)]
+    async fn test_temporary_buffer_aligned() {
+        let buf = allocate_aligned_buffer(4096, 4096);
+        assert_eq!(buf.len(), 4096);
+        assert_eq!(buf.as_ptr() as usize % 4096, 0);
+        assert!(buf.iter().all(|&b| b == 0));
+    }
+
+    #[seastar::test(shared)]
+    async fn test_temporary_buffer_share() {
+        let mut buf = TemporaryBuffer::copy_of(b"hello world");
+        let world = buf.share_range(6, 5);
+        assert_eq!(&*world, b"world");
+        assert_eq!(world.as_ptr(), buf[6..].as_ptr());
+        assert!(buf.is_shared());
+        assert!(buf.get_mut().is_none());
+        drop(world);
+        assert!(!buf.is_shared());
+        assert!(buf.get_mut().is_some());
+    }
+
+    #[seastar::test(shared)]
+    async fn test_temporary_buffer_trim_prefix() {
+        let mut buf = TemporaryBuffer::copy_of(b"hello world");
+        buf.trim_front(6);
+        assert_eq!(&*buf, b"world");
+        buf.trim(3);
+        assert_eq!(&*buf, b"wor");
+        assert_eq!(&*buf.prefix(1), b"w");
+    }
+}
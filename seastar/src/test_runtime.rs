@@ -0,0 +1,147 @@
+//! A Seastar runtime shared by the tests of a test binary
+//! (see `#[seastar::test(shared)]`).
+//!
+//! Starting a runtime for every test dominates the run time of the suite.
+//! Instead, tests marked as shared are submitted to a single runtime, which
+//! runs them concurrently, as tasks. The runtime runs on a thread of its own
+//! and holds the test guard (see seastar_test_guard.rs) while it is up, so it
+//! never overlaps with the runtimes of the remaining tests. It is stopped
+//! when no shared test has been submitted for a while, which lets those
+//! tests run, and started again on demand.
+
+use crate::{smp_count, submit_to, timeout, AppTemplate, Gate, Options};
+use futures::channel::mpsc;
+use futures::{FutureExt, StreamExt};
+use std::future::Future;
+use std::panic::{self, AssertUnwindSafe};
+use std::pin::Pin;
+use std::sync::Mutex;
+use std::thread;
+use std::time::Duration;
+
+/// How long the runtime waits for a test before stopping.
+const IDLE_TIMEOUT: Duration = Duration::from_millis(100);
+
+type TestFuture = Pin<Box<dyn Future<Output = ()>>>;
+type TestResult = thread::Result<()>;
+
+struct Submission {
+    test: Box<dyn FnOnce() -> TestFuture + Send>,
+    parallel: bool,
+    done: std::sync::mpsc::Sender<TestResult>,
+}
+
+// The submission queue of the running runtime, if any.
+static RUNTIME: Mutex<Option<mpsc::UnboundedSender<Submission>>> = Mutex::new(None);
+
+/// Runs the test returned by `test` in the shared runtime, and resumes its panic, if any.
+///
+/// The test runs on shard 0, unless `parallel` is set, in which case tests
+/// are spread over all shards.
+pub fn run_test_in_shared_runtime<F>(parallel: bool, test: F)
+where
+    F: FnOnce() -> TestFuture + Send + 'static,
+{
+    let (done, result) = std::sync::mpsc::channel();
+    let mut submission = Submission {
+        test: Box::new(test),
+        parallel,
+        done,
+    };
+    {
+        let mut runtime = RUNTIME.lock().unwrap_or_else(|err| err.into_inner());
+        loop {
+            if let Some(queue) = &*runtime {
+                match queue.unbounded_send(submission) {
+                    Ok(()) => break,
+                    // The runtime is stopping.
+                    Err(err) => submission = err.into_inner(),
+                }
+            }
+            *runtime = Some(start_runtime());
+        }
+    }
+    if let Err(panic) = result.recv().expect("shared test runtime exited") {
+        panic::resume_unwind(panic);
+    }
+}
+
+fn start_runtime() -> mpsc::UnboundedSender<Submission> {
+    let (queue, submissions) = mpsc::unbounded();
+    thread::spawn(move || {
+        let _guard = crate::acquire_guard_for_seastar_test();
+        let mut opts = Options::default();
+        if let Some(smp) = std::env::var("SEASTAR_TEST_SMP")
+            .ok()
+            .and_then(|smp| smp.parse().ok())
+        {
+            opts.set_smp(smp);
+        }
+        let mut app = AppTemplate::new_from_options(opts);
+        app.run_void(std::env::args().take(1), async move {
+            serve(submissions).await;
+            Ok(())
+        });
+    });
+    queue
+}
+
+async fn serve(mut submissions: mpsc::UnboundedReceiver<Submission>) {
+    let tests = Gate::new();
+    let mut next_shard = 0;
+    loop {
+        let submission = match timeout(submissions.next(), IDLE_TIMEOUT).await {
+            Ok(Some(submission)) => submission,
+            Ok(None) => break,
+            Err(_) => {
+                // New tests start another runtime from now on; run the ones
+                // that have been submitted in the meantime.
+                submissions.close();
+                continue;
+            }
+        };
+        let shard = match submission.parallel {
+            true => {
+                next_shard = (next_shard + 1) % smp_count();
+                next_shard
+            }
+            false => 0,
+        };
+        let Submission { test, done, .. } = submission;
+        tests
+            .spawn(async move {
+                let result = submit_to(shard, move || {
+                    AssertUnwindSafe(async move { test().await }).catch_unwind()
+                })
+                .await;
+                let _ = done.send(result);
+            })
+            .unwrap();
+    }
+    tests.close().await;
+}
+
+#[cfg(test)]
+mod tests {
+    use super::*;
+    use crate as seastar;
+    use crate::this_shard_id;
+
+    #[seastar::test(smp = 3)]
+    async fn test_smp_argument() {
+        assert_eq!(smp_count(), 3);
+    }
+
+    #[seastar::test(shared)]
+    async fn test_shared_runs_on_shard_0() {
+        assert_eq!(this_shard_id(), 0);
+    }
+
+    #[test]
+    fn test_shared_resumes_panics() {
+        let result = panic::catch_unwind(|| {
+            run_test_in_shared_runtime(false, || Box::pin(async { panic!("expected") }))
+        });
+        assert!(result.is_err());
+    }
+}
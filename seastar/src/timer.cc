@@ -0,0 +1,64 @@
+#include "timer.hh"
+
+namespace seastar_ffi {
+namespace timer {
+
+static_assert(sizeof(steady_timer) <= timer_storage_size);
+static_assert(sizeof(lowres_timer) <= timer_storage_size);
+static_assert(alignof(steady_timer) <= timer_storage_align);
+static_assert(alignof(lowres_timer) <= timer_storage_align);
+
+template <typename Clock>
+static typename Clock::time_point to_time_point(int64_t ns) {
+    return typename Clock::time_point(std::chrono::duration_cast<typename Clock::duration>(std::chrono::nanoseconds(ns)));
+}
+
+template <typename Clock>
+static int64_t to_ns(typename Clock::time_point tp) {
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(tp.time_since_epoch()).count();
+}
+
+int64_t now_ns(bool lowres) {
+    if (lowres) {
+        return to_ns<seastar::lowres_clock>(seastar::lowres_clock::now());
+    }
+    return to_ns<seastar::steady_clock_type>(seastar::steady_clock_type::now());
+}
+
+void construct_timer(uint8_t* storage, bool lowres, rust::Fn<void(uint8_t*)> callback, uint8_t* data) {
+    auto cb = [callback, data] {
+        callback(data);
+    };
+    if (lowres) {
+        new (storage) lowres_timer(std::move(cb));
+    } else {
+        new (storage) steady_timer(std::move(cb));
+    }
+}
+
+void destroy_timer(uint8_t* storage, bool lowres) {
+    if (lowres) {
+        std::destroy_at(reinterpret_cast<lowres_timer*>(storage));
+    } else {
+        std::destroy_at(reinterpret_cast<steady_timer*>(storage));
+    }
+}
+
+void arm_timer_at(uint8_t* storage, bool lowres, int64_t deadline_ns) {
+    if (lowres) {
+        reinterpret_cast<lowres_timer*>(storage)->rearm(to_time_point<seastar::lowres_clock>(deadline_ns));
+    } else {
+        reinterpret_cast<steady_timer*>(storage)->rearm(to_time_point<seastar::steady_clock_type>(deadline_ns));
+    }
+}
+
+void cancel_timer(uint8_t* storage, bool lowres) {
+    if (lowres) {
+        reinterpret_cast<lowres_timer*>(storage)->cancel();
+    } else {
+        reinterpret_cast<steady_timer*>(storage)->cancel();
+    }
+}
+
+} // namespace timer
+} // namespace seastar_ffi
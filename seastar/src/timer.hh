@@ -0,0 +1,29 @@
+#pragma once
+
+#include "rust/cxx.h"
+#include <seastar/core/lowres_clock.hh>
+#include <seastar/core/timer.hh>
+
+namespace seastar_ffi {
+namespace timer {
+
+using steady_timer = seastar::timer<seastar::steady_clock_type>;
+using lowres_timer = seastar::timer<seastar::lowres_clock>;
+
+// Storage reserved for a timer inside every Rust `Timer`.
+// Must be kept in sync with `CppTimerStorage` in timer.rs.
+constexpr size_t timer_storage_size = 128;
+constexpr size_t timer_storage_align = 16;
+
+int64_t now_ns(bool lowres);
+
+void construct_timer(uint8_t* storage, bool lowres, rust::Fn<void(uint8_t*)> callback, uint8_t* data);
+
+void destroy_timer(uint8_t* storage, bool lowres);
+
+void arm_timer_at(uint8_t* storage, bool lowres, int64_t deadline_ns);
+
+void cancel_timer(uint8_t* storage, bool lowres);
+
+} // namespace timer
+} // namespace seastar_ffi
@@ -0,0 +1,310 @@
+use crate::{AbortRequested, AbortSource};
+use pin_project::pin_project;
+use std::cell::Cell;
+use std::future::Future;
+use std::marker::{PhantomData, PhantomPinned};
+use std::mem::MaybeUninit;
+use std::pin::Pin;
+use std::task::{Context, Poll, Waker};
+use std::time::Duration;
+use thiserror::Error;
+
+#[cxx::bridge]
+mod ffi {
+    #[namespace = "seastar_ffi::timer"]
+    unsafe extern "C++" {
+        include!("seastar/src/timer.hh");
+
+        fn now_ns(lowres: bool) -> i64;
+        unsafe fn construct_timer(
+            storage: *mut u8,
+            lowres: bool,
+            callback: unsafe fn(*mut u8),
+            data: *mut u8,
+        );
+        unsafe fn destroy_timer(storage: *mut u8, lowres: bool);
+        unsafe fn arm_timer_at(storage: *mut u8, lowres: bool, deadline_ns: i64);
+        unsafe fn cancel_timer(storage: *mut u8, lowres: bool);
+    }
+}
+
+use ffi::*;
+
+/// Space for the C++ `seastar::timer` object (see timer.hh), which is
+/// constructed in place when the [`Timer`] is first polled.
+#[repr(C, align(16))]
+struct CppTimerStorage([MaybeUninit<u8>; 128]);
+
+/// Part of the [`Timer`] that is touched by the timer callback.
+struct Fired {
+    fired: Cell<bool>,
+    waker: Cell<Option<Waker>>,
+}
+
+unsafe fn on_timer_fired(data: *mut u8) {
+    let fired = &*(data as *const Fired);
+    fired.fired.set(true);
+    if let Some(waker) = fired.waker.take() {
+        waker.wake();
+    }
+}
+
+fn duration_ns(duration: Duration) -> i64 {
+    duration.as_nanos().min(i64::MAX as u128) as i64
+}
+
+/// A future that completes at a deadline, backed by the reactor's timers.
+///
+/// The underlying `seastar::timer` lives inside the `Timer` itself, so
+/// creating and arming a timer does not allocate. It is only registered
+/// with the reactor when first polled.
+///
+/// Created by [`sleep`] and [`sleep_lowres`]. Can be rearmed with
+/// [`reset`](Timer::reset) and disarmed with [`cancel`](Timer::cancel).
+///
+/// A `Timer` must stay on the shard that created it.
+pub struct Timer {
+    cpp_timer: CppTimerStorage,
+    fired: Fired,
+    deadline_ns: i64,
+    lowres: bool,
+    armed: bool,
+    constructed: bool,
+    _pinned: PhantomPinned,
+    _not_send: PhantomData<*const ()>,
+}
+
+impl Timer {
+    fn new(after: Duration, lowres: bool) -> Self {
+        crate::assert_runtime_is_running();
+        Timer {
+            cpp_timer: CppTimerStorage([MaybeUninit::uninit(); 128]),
+            fired: Fired {
+                fired: Cell::new(false),
+                waker: Cell::new(None),
+            },
+            deadline_ns: now_ns(lowres).saturating_add(duration_ns(after)),
+            lowres,
+            armed: true,
+            constructed: false,
+            _pinned: PhantomPinned,
+            _not_send: PhantomData,
+        }
+    }
+
+    fn storage(&mut self) -> *mut u8 {
+        self.cpp_timer.0.as_mut_ptr() as *mut u8
+    }
+
+    /// Rearms the timer to complete `after` from now, even if it has already completed.
+    pub fn reset(self: Pin<&mut Self>, after: Duration) {
+        let this = unsafe { self.get_unchecked_mut() };
+        this.deadline_ns = now_ns(this.lowres).saturating_add(duration_ns(after));
+        this.armed = true;
+        this.fired.fired.set(false);
+        if this.constructed {
+            unsafe { arm_timer_at(this.storage(), this.lowres, this.deadline_ns) };
+        }
+    }
+
+    /// Disarms the timer. It will not complete until it is [`reset`](Timer::reset).
+    pub fn cancel(self: Pin<&mut Self>) {
+        let this = unsafe { self.get_unchecked_mut() };
+        this.armed = false;
+        if this.constructed {
+            unsafe { cancel_timer(this.storage(), this.lowres) };
+        }
+    }
+
+    /// Checks whether the timer has completed.
+    pub fn is_elapsed(&self) -> bool {
+        self.fired.fired.get()
+    }
+}
+
+impl Future for Timer {
+    type Output = ();
+
+    fn poll(self: Pin<&mut Self>, cx: &mut Context<'_>) -> Poll<Self::Output> {
+        let this = unsafe { self.get_unchecked_mut() };
+        if this.fired.fired.get() {
+            return Poll::Ready(());
+        }
+        match this.fired.waker.take() {
+            Some(waker) if waker.will_wake(cx.waker()) => this.fired.waker.set(Some(waker)),
+            _ => this.fired.waker.set(Some(cx.waker().clone())),
+        }
+        if !this.constructed {
+            // The timer is pinned now, so the callback can point into it.
+            let data = &this.fired as *const Fired as *mut u8;
+            unsafe {
+                construct_timer(this.storage(), this.lowres, on_timer_fired, data);
+                if this.armed {
+                    arm_timer_at(this.storage(), this.lowres, this.deadline_ns);
+                }
+            }
+            this.constructed = true;
+        }
+        Poll::Pending
+    }
+}
+
+impl Drop for Timer {
+    fn drop(&mut self) {
+        if self.constructed {
+            unsafe { destroy_timer(self.storage(), self.lowres) };
+        }
+    }
+}
+
+/// Waits until `duration` has elapsed, measured with the high resolution `steady_clock`.
+///
+/// # Example
+///
+/// ```rust
+/// #[seastar::test]
+/// async fn sleep_example() {
+///     sleep(Duration::from_millis(10)).await;
+/// }
+/// ```
+pub fn sleep(duration: Duration) -> Timer {
+    Timer::new(duration, false)
+}
+
+/// Waits until `duration` has elapsed, measured with `lowres_clock`.
+///
+/// `lowres_clock` is updated by the reactor every few milliseconds, which
+/// makes it much cheaper to read and arm, at the cost of precision.
+/// It is the right choice for timeouts that are usually cancelled.
+pub fn sleep_lowres(duration: Duration) -> Timer {
+    Timer::new(duration, true)
+}
+
+/// Waits until `duration` has elapsed, like [`sleep`], or until an abort
+/// is requested on `abort`, in which case the timer is cancelled right away
+/// (`seastar::sleep_abortable`).
+pub async fn sleep_abortable(
+    duration: Duration,
+    abort: &AbortSource,
+) -> Result<(), AbortRequested> {
+    abort.abortable(sleep(duration)).await
+}
+
+/// Error returned by [`timeout`] when the deadline passes before the future completes.
+#[derive(Error, Debug)]
+#[error("TimeoutError: timed out")]
+pub struct TimeoutError;
+
+/// Future returned by [`timeout`] and [`timeout_lowres`].
+#[pin_project]
+pub struct Timeout<F> {
+    #[pin]
+    future: F,
+    #[pin]
+    timer: Timer,
+}
+
+impl<F: Future> Future for Timeout<F> {
+    type Output = Result<F::Output, TimeoutError>;
+
+    fn poll(self: Pin<&mut Self>, cx: &mut Context<'_>) -> Poll<Self::Output> {
+        let this = self.project();
+        if let Poll::Ready(output) = this.future.poll(cx) {
+            return Poll::Ready(Ok(output));
+        }
+        match this.timer.poll(cx) {
+            Poll::Ready(()) => Poll::Ready(Err(TimeoutError)),
+            Poll::Pending => Poll::Pending,
+        }
+    }
+}
+
+/// Runs `future`, giving up with [`TimeoutError`] if it does not complete
+/// within `duration`, measured with the high resolution `steady_clock`.
+///
+/// The future is dropped when the time runs out.
+pub fn timeout<F: Future>(future: F, duration: Duration) -> Timeout<F> {
+    Timeout {
+        future,
+        timer: sleep(duration),
+    }
+}
+
+/// Same as [`timeout`], but measured with `lowres_clock` (see [`sleep_lowres`]).
+pub fn timeout_lowres<F: Future>(future: F, duration: Duration) -> Timeout<F> {
+    Timeout {
+        future,
+        timer: sleep_lowres(duration),
+    }
+}
+
+#[cfg(test)]
+mod tests {
+    use super::*;
+    use crate as seastar;
+    use std::time::Instant;
+
+    #[seastar::test(shared)]
+    async fn test_sleep() {
+        let start = Instant::now();
+        sleep(Duration::from_millis(20)).await;
+        assert!(start.elapsed() >= Duration::from_millis(20));
+    }
+
+    #[seastar::test(shared)]
+    async fn test_sleep_lowres() {
+        let start = Instant::now();
+        sleep_lowres(Duration::from_millis(20)).await;
+        assert!(start.elapsed() >= Duration::from_millis(10));
+    }
+
+    #[seastar::test(shared)]
+    async fn test_timeout_completes() {
+        let ret = timeout(async { 42 }, Duration::from_secs(10)).await;
+        assert!(matches!(ret, Ok(42)));
+    }
+
+    #[seastar::test(shared)]
+    async fn test_timeout_expires() {
+        let ret = timeout(sleep(Duration::from_secs(10)), Duration::from_millis(10)).await;
+        assert!(matches!(ret, Err(TimeoutError)));
+    }
+
+    #[seastar::test(shared)]
+    async fn test_timer_reset() {
+        let mut timer = Box::pin(sleep(Duration::from_secs(10)));
+        let ret = timeout(timer.as_mut(), Duration::from_millis(10)).await;
+        assert!(ret.is_err());
+        timer.as_mut().reset(Duration::from_millis(10));
+        timer.as_mut().await;
+        assert!(timer.is_elapsed());
+    }
+
+    #[seastar::test(shared)]
+    async fn test_timer_cancel() {
+        let mut timer = Box::pin(sleep(Duration::from_millis(10)));
+        timer.as_mut().cancel();
+        let ret = timeout(timer.as_mut(), Duration::from_millis(30)).await;
+        assert!(ret.is_err());
+        assert!(!timer.is_elapsed());
+    }
+
+    #[seastar::test(shared)]
+    async fn test_sleep_abortable() {
+        let abort = AbortSource::new();
+        assert_eq!(
+            sleep_abortable(Duration::from_millis(1), &abort).await,
+            Ok(())
+        );
+
+        let start = Instant::now();
+        let sleeper = crate::spawn({
+            let abort = abort.clone();
+            async move { sleep_abortable(Duration::from_secs(3600), &abort).await }
+        });
+        sleep(Duration::from_millis(1)).await;
+        abort.request_abort();
+        assert_eq!(sleeper.await, Err(AbortRequested));
+        assert!(start.elapsed() < Duration::from_secs(60));
+    }
+}